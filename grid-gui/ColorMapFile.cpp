@@ -57,6 +57,8 @@ ColorMapFile::ColorMapFile(const ColorMapFile& colorMapFile)
     mNames = colorMapFile.mNames;
     mFilename = colorMapFile.mFilename;
     mColorMap = colorMapFile.mColorMap;
+    mThresholds = colorMapFile.mThresholds;
+    mColors = colorMapFile.mColors;
     mLastModified = colorMapFile.mLastModified;
   }
   catch (...)
@@ -227,70 +229,127 @@ uint ColorMapFile::getSmoothColor(double value)
 
     // NOTICE: Lock thread before usage
 
-    auto it = mColorMap.find(value);
-    if (it != mColorMap.end())
-      return it->second;
+    return smoothColor(value);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
 
-    double lowerValue = 0;
-    double upperValue = 0;
-    uint lowerColor = 0;
-    uint upperColor = 0;
 
-    uchar *a = (uchar*)&lowerColor;
-    uchar *b = (uchar*)&upperColor;
 
-    it = mColorMap.lower_bound(value);
-    if (it != mColorMap.end())
-    {
-      if (it->first > value)
-      {
-        upperValue = it->first;
-        upperColor = it->second;
-        if (it != mColorMap.begin())
-          it--;
 
-        lowerValue = it->first;
-        lowerColor = it->second;
-      }
 
-      if (it->first < value)
-      {
-        lowerValue = it->first;
-        lowerColor = it->second;
-        if (it != mColorMap.end())
-          it++;
+/*! \brief GridGui: Get smooth colors for an array of values. */
 
-        upperValue = it->first;
-        upperColor = it->second;
-      }
+void ColorMapFile::getSmoothColors(const float *values,uint count,uint *colors)
+{
+  try
+  {
+    // NOTICE: Lock thread before usage
 
-      double dv = upperValue - lowerValue;
-      if (dv != 0)
-      {
-        double vv = value - lowerValue;
-        double p = vv / dv;
+    for (uint t=0; t<count; t++)
+    {
+      if (values[t] == ParamValueMissing)
+        colors[t] = 0x00FFFFFF;
+      else
+        colors[t] = smoothColor(values[t]);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
 
-        for (uint t=0; t<4; t++)
-        {
-          int d = ((int)b[t] - (int)a[t]) * p;
-          a[t] = a[t] + d;
-        }
-      }
 
-      return lowerColor;
-    }
 
-    if (value > mColorMap.rbegin()->first)
-      return mColorMap.rbegin()->second;
 
-    if (value < mColorMap.begin()->first)
-      return mColorMap.begin()->second;
 
+/*! \brief GridGui: Interpolate the color of the value from the threshold tables. The
+ *  thresholds are floats, so the value is searched as a float (like in mColorMap)
+ *  but interpolated as a double. This is the inner loop of the image painting, so the
+ *  exceptions are handled by the callers (getSmoothColor() and getSmoothColors()). */
+
+uint ColorMapFile::smoothColor(double value)
+{
+  uint n = mThresholds.size();
+  if (n == 0)
     return 0x00FFFFFF;
+
+  if (value != value)
+    return 0;
+
+  float fvalue = (float)value;
+  const float *thresholds = mThresholds.data();
+
+  // Branch-free binary search. The number of iterations depends only on the table
+  // size, and the comparison compiles into a conditional move.
+
+  const float *base = thresholds;
+  uint len = n;
+  while (len > 1)
+  {
+    uint half = len / 2;
+    base = (base[half] <= fvalue) ? base + half : base;
+    len -= half;
+  }
+
+  // Index of the first threshold above the value.
+  uint idx = C_UINT(base - thresholds) + (*base <= fvalue);
+
+  if (idx > 0  &&  thresholds[idx-1] == fvalue)
+    return mColors[idx-1];
+
+  if (idx == 0)
+    return mColors[0];
+
+  if (idx == n)
+    return mColors[n-1];
+
+  double lowerValue = thresholds[idx-1];
+  double upperValue = thresholds[idx];
+  uint lowerColor = mColors[idx-1];
+  uint upperColor = mColors[idx];
+
+  double p = (value - lowerValue) / (upperValue - lowerValue);
+
+  uint col = 0;
+  for (uint t=0; t<32; t+=8)
+  {
+    int a = (lowerColor >> t) & 0xFF;
+    int b = (upperColor >> t) & 0xFF;
+    int d = (b - a) * p;
+    col |= C_UINT((a + d) & 0xFF) << t;
+  }
+  return col;
+}
+
+
+
+
+
+/*! \brief GridGui: Build the flat threshold and color tables from mColorMap. */
+
+void ColorMapFile::buildTables()
+{
+  try
+  {
+    mThresholds.clear();
+    mColors.clear();
+    mThresholds.reserve(mColorMap.size());
+    mColors.reserve(mColorMap.size());
+
+    for (auto it = mColorMap.begin(); it != mColorMap.end(); ++it)
+    {
+      mThresholds.emplace_back(it->first);
+      mColors.emplace_back(it->second);
+    }
   }
   catch (...)
   {
-    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
   }
 }
 
@@ -489,6 +548,8 @@ void ColorMapFile::loadFile()
     }
     fclose(file);
 
+    buildTables();
+
     mLastModified = getFileModificationTime(mFilename.c_str());
   }
   catch (...)
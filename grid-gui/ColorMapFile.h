@@ -20,7 +20,8 @@ typedef std::map<float,unsigned int> ColorMap;  //!< Maps parameter value thresh
  *
  *  A single file can define several named color maps (e.g. one per parameter or
  *  physical scale).  getColor() does exact threshold lookup; getSmoothColor() linearly
- *  interpolates between adjacent thresholds.  The file is hot-reloaded on modification
+ *  interpolates between adjacent thresholds using flat threshold and color arrays that are
+ *  built whenever the file is (re)loaded.  The file is hot-reloaded on modification
  *  so that color schemes can be adjusted without restarting the server. */
 // ====================================================================================
 
@@ -37,6 +38,7 @@ class ColorMapFile
     bool              checkUpdates();
     uint              getColor(double value);
     uint              getSmoothColor(double value);
+    void              getSmoothColors(const float *values,uint count,uint *colors);
     void              getValuesAndColors(std::vector<float>& values,std::vector<unsigned int>& colors);
     std::string       getFilename();
     time_t            getLastModificationTime();
@@ -50,10 +52,14 @@ class ColorMapFile
   protected:
 
     void              loadFile();
+    void              buildTables();
+    uint              smoothColor(double value);
 
     string_vec        mNames;           //!< Named color maps defined in this file (e.g. "Dali Temperature (Celsius)").
     std::string       mFilename;        //!< Path to the CSV color map file on disk.
     ColorMap          mColorMap;        //!< Loaded threshold → color mapping for the active color map.
+    std::vector<float> mThresholds;     //!< Thresholds of mColorMap in ascending order (flat copy for fast lookups).
+    std::vector<uint> mColors;          //!< Colors of the thresholds in mThresholds.
     time_t            mLastModified;    //!< Last-modified time of the file; used to detect when a reload is needed.
     ModificationLock  mModificationLock;//!< Lock protecting concurrent access to mColorMap during hot-reload.
 };
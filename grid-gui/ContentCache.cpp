@@ -0,0 +1,381 @@
+#include "ContentCache.h"
+#include <grid-files/common/GeneralFunctions.h>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Constructor. */
+
+ContentCache::ContentCache()
+{
+  try
+  {
+    mServerTime = 0;
+    mEventId = 0;
+    mVersion = 0;
+    mMaxAge = 0;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+ContentCache::~ContentCache()
+{
+  try
+  {
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Set the maximum age of the entries (in seconds, 0 = no age limit)
+ *  and the maximum number of entries (0 disables the cache). */
+
+void ContentCache::setLimits(uint maxAge,std::size_t maxEntries)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+    mMaxAge = maxAge;
+    mEntries.setMaxSize(maxEntries);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Set the last event of the content server. The cache is cleared if
+ *  the event or the start time of the content server has changed since the previous
+ *  call. Returns true if the cache was cleared. */
+
+bool ContentCache::setLastEvent(time_t serverTime,unsigned long long eventId)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+
+    if (serverTime == mServerTime  &&  eventId == mEventId)
+      return false;
+
+    mServerTime = serverTime;
+    mEventId = eventId;
+    mVersion++;
+    mEntries.clear();
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the version of the cache. The version changes every time the
+ *  cache is cleared. A listing is fetched after reading the version and added with
+ *  it, so a listing that was fetched before the cache was cleared is not added. */
+
+uint ContentCache::getVersion()
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+    return mVersion;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the producer listing. Returns false if it is not cached. */
+
+bool ContentCache::getProducerInfoList(T::ProducerInfoList& producerInfoList)
+{
+  try
+  {
+    Entry entry;
+    if (!getEntry("P",entry)  ||  !entry.producerInfoList)
+      return false;
+
+    producerInfoList = *entry.producerInfoList;
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add the producer listing. */
+
+void ContentCache::addProducerInfoList(uint version,const T::ProducerInfoList& producerInfoList)
+{
+  try
+  {
+    Entry entry;
+    entry.producerInfoList.reset(new T::ProducerInfoList(producerInfoList));
+
+    addEntry(version,"P",entry);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the generation listing of the producer. Returns false if it is
+ *  not cached. */
+
+bool ContentCache::getGenerationInfoList(T::ProducerId producerId,T::GenerationInfoList& generationInfoList)
+{
+  try
+  {
+    Entry entry;
+    if (!getEntry("G:" + std::to_string(producerId),entry)  ||  !entry.generationInfoList)
+      return false;
+
+    generationInfoList = *entry.generationInfoList;
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add the generation listing of the producer. */
+
+void ContentCache::addGenerationInfoList(uint version,T::ProducerId producerId,const T::GenerationInfoList& generationInfoList)
+{
+  try
+  {
+    Entry entry;
+    entry.generationInfoList.reset(new T::GenerationInfoList(generationInfoList));
+
+    addEntry(version,"G:" + std::to_string(producerId),entry);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the parameter listing of the generation. Returns false if it
+ *  is not cached. */
+
+bool ContentCache::getParamKeyList(T::GenerationId generationId,std::set<std::string>& paramKeyList)
+{
+  try
+  {
+    Entry entry;
+    if (!getEntry("K:" + std::to_string(generationId),entry)  ||  !entry.paramKeyList)
+      return false;
+
+    paramKeyList = *entry.paramKeyList;
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add the parameter listing of the generation. */
+
+void ContentCache::addParamKeyList(uint version,T::GenerationId generationId,const std::set<std::string>& paramKeyList)
+{
+  try
+  {
+    Entry entry;
+    entry.paramKeyList.reset(new std::set<std::string>(paramKeyList));
+
+    addEntry(version,"K:" + std::to_string(generationId),entry);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the content index of the parameter in the generation. Returns
+ *  false if it is not cached. */
+
+bool ContentCache::getContentIndex(T::GenerationId generationId,const std::string& parameterId,ContentIndex_sptr& contentIndex)
+{
+  try
+  {
+    Entry entry;
+    if (!getEntry("C:" + std::to_string(generationId) + ":" + parameterId,entry)  ||  !entry.contentIndex)
+      return false;
+
+    contentIndex = entry.contentIndex;
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add the content index of the parameter in the generation. */
+
+void ContentCache::addContentIndex(uint version,T::GenerationId generationId,const std::string& parameterId,const ContentIndex_sptr& contentIndex)
+{
+  try
+  {
+    if (!contentIndex)
+      return;
+
+    Entry entry;
+    entry.contentIndex = contentIndex;
+
+    addEntry(version,"C:" + std::to_string(generationId) + ":" + parameterId,entry);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Clear. */
+
+void ContentCache::clear()
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+
+    mVersion++;
+    mEntries.clear();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get an entry and mark it as the most recently used. Expired
+ *  entries are removed. Returns false if the key is not cached. */
+
+bool ContentCache::getEntry(const std::string& key,Entry& entry)
+{
+  try
+  {
+    if (!mEntries.get(key,entry))
+      return false;
+
+    AutoThreadLock lock(&mThreadLock);
+
+    if (mMaxAge > 0  &&  (entry.updateTime + static_cast<time_t>(mMaxAge)) < time(nullptr))
+    {
+      mEntries.remove(key);
+      return false;
+    }
+
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add an entry. The entry is not added if the cache has been cleared
+ *  after the given version was read. */
+
+void ContentCache::addEntry(uint version,const std::string& key,Entry& entry)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+
+    if (version != mVersion)
+      return;
+
+    entry.updateTime = time(nullptr);
+    mEntries.add(key,entry);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
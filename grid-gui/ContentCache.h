@@ -0,0 +1,83 @@
+#pragma once
+
+#include "ContentIndex.h"
+#include "LruCache.h"
+#include <grid-files/common/AutoThreadLock.h>
+#include <grid-files/common/Typedefs.h>
+#include <memory>
+#include <set>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ====================================================================================
+/*! \brief In-memory cache of the content server listings used by the main page.
+ *
+ *  The main page lists the producers, the generations of the selected producer, the
+ *  parameters of the selected generation and the contents of the selected parameter
+ *  on every request. The listings are cached here by producer, generation and
+ *  parameter (the contents as a facet index), so clicking through the dropdowns does
+ *  not repeat the remote calls.
+ *
+ *  The listings change only when the content of the content server changes, so the
+ *  whole cache is cleared when the last event of the content server changes (or the
+ *  content server is restarted). The entries older than the maximum age are ignored
+ *  in case the events are not available. */
+// ====================================================================================
+
+class ContentCache
+{
+  public:
+                      ContentCache();
+    virtual           ~ContentCache();
+
+    void              setLimits(uint maxAge,std::size_t maxEntries);
+    bool              setLastEvent(time_t serverTime,unsigned long long eventId);
+    uint              getVersion();
+
+    bool              getProducerInfoList(T::ProducerInfoList& producerInfoList);
+    void              addProducerInfoList(uint version,const T::ProducerInfoList& producerInfoList);
+
+    bool              getGenerationInfoList(T::ProducerId producerId,T::GenerationInfoList& generationInfoList);
+    void              addGenerationInfoList(uint version,T::ProducerId producerId,const T::GenerationInfoList& generationInfoList);
+
+    bool              getParamKeyList(T::GenerationId generationId,std::set<std::string>& paramKeyList);
+    void              addParamKeyList(uint version,T::GenerationId generationId,const std::set<std::string>& paramKeyList);
+
+    bool              getContentIndex(T::GenerationId generationId,const std::string& parameterId,ContentIndex_sptr& contentIndex);
+    void              addContentIndex(uint version,T::GenerationId generationId,const std::string& parameterId,const ContentIndex_sptr& contentIndex);
+
+    void              clear();
+
+  protected:
+
+    struct Entry
+    {
+      time_t                            updateTime;   //!< Time when the listing was fetched.
+      std::shared_ptr<const T::ProducerInfoList>   producerInfoList;    //!< Producer listing ("P").
+      std::shared_ptr<const T::GenerationInfoList> generationInfoList;  //!< Generation listing ("G:producerId").
+      std::shared_ptr<const std::set<std::string>> paramKeyList;        //!< Parameter listing ("K:generationId").
+      ContentIndex_sptr                            contentIndex;        //!< Content index ("C:generationId:parameterId").
+    };
+
+    bool              getEntry(const std::string& key,Entry& entry);
+    void              addEntry(uint version,const std::string& key,Entry& entry);
+
+    LruCache<Entry,LruEntryCount> mEntries;  //!< The listings by type and query.
+    time_t            mServerTime;      //!< Start time of the content server at the last event check.
+    unsigned long long mEventId;        //!< Last event of the content server at the last event check.
+    uint              mVersion;         //!< Incremented every time the cache is cleared.
+    uint              mMaxAge;          //!< Maximum age of an entry in seconds; 0 = no age limit.
+    ThreadLock        mThreadLock;      //!< Lock protecting the above (except mEntries).
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
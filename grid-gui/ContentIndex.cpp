@@ -0,0 +1,104 @@
+#include "ContentIndex.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <algorithm>
+#include <cstring>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Build the facet index of the contents in index.contentInfoList.
+ *  The contents are visited once; the contents of each path are sorted by forecast
+ *  time afterwards. */
+
+void createContentIndex(ContentIndex& index)
+{
+  try
+  {
+    index.levelIds.clear();
+
+    uint len = index.contentInfoList.getLength();
+    for (uint t=0; t<len; t++)
+    {
+      T::ContentInfo *g = index.contentInfoList.getContentInfoByIndex(t);
+      if (g == nullptr  ||  g->mFmiParameterLevelId < 0)
+        continue;
+
+      index.levelIds[g->mFmiParameterLevelId][g->mParameterLevel][g->mForecastType][g->mForecastNumber][g->mGeometryId].push_back(g);
+    }
+
+    for (auto& levelId : index.levelIds)
+    {
+      for (auto& level : levelId.second)
+      {
+        for (auto& forecastType : level.second)
+        {
+          for (auto& forecastNumber : forecastType.second)
+          {
+            for (auto& geometry : forecastNumber.second)
+            {
+              std::stable_sort(geometry.second.begin(),geometry.second.end(),[](T::ContentInfo *a,T::ContentInfo *b)
+              {
+                return strcmp(a->getForecastTime(),b->getForecastTime()) < 0;
+              });
+            }
+          }
+        }
+      }
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the contents of the forecast time on the levels minLevel..maxLevel
+ *  of a level type (in the order of the levels). */
+
+void getContentsByTime(const ContentLevel_map *levels,int forecastType,int forecastNumber,T::GeometryId geometryId,const std::string& forecastTime,int minLevel,int maxLevel,ContentInfoPtr_vec& contents)
+{
+  try
+  {
+    if (levels == nullptr)
+      return;
+
+    for (auto it = levels->lower_bound(minLevel); it != levels->end()  &&  it->first <= maxLevel; ++it)
+    {
+      const ContentInfoPtr_vec *times = findContentFacet(findContentFacet(findContentFacet(&it->second,forecastType),forecastNumber),geometryId);
+      if (times == nullptr)
+        continue;
+
+      auto first = std::lower_bound(times->begin(),times->end(),forecastTime,[](T::ContentInfo *a,const std::string& b)
+      {
+        return strcmp(a->getForecastTime(),b.c_str()) < 0;
+      });
+
+      auto last = std::upper_bound(first,times->end(),forecastTime,[](const std::string& a,T::ContentInfo *b)
+      {
+        return strcmp(a.c_str(),b->getForecastTime()) < 0;
+      });
+
+      contents.insert(contents.end(),first,last);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
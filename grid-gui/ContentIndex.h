@@ -0,0 +1,82 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+typedef std::vector<T::ContentInfo*> ContentInfoPtr_vec;                   //!< Contents sorted by forecast time.
+typedef std::map<T::GeometryId,ContentInfoPtr_vec> ContentGeometry_map;     //!< Geometry → contents.
+typedef std::map<int,ContentGeometry_map> ContentForecastNumber_map;        //!< Forecast number → geometries.
+typedef std::map<int,ContentForecastNumber_map> ContentForecastType_map;    //!< Forecast type → forecast numbers.
+typedef std::map<int,ContentForecastType_map> ContentLevel_map;             //!< Level → forecast types.
+typedef std::map<int,ContentLevel_map> ContentLevelId_map;                  //!< FMI level type → levels.
+
+
+
+/*! \brief Facet index of the contents of one parameter in one generation.
+ *
+ *  The main page selects the level type, the level, the forecast type, the forecast
+ *  number, the geometry and the time of the parameter in this order. The contents are
+ *  indexed in a single pass into nested maps in the same order, so every dropdown is
+ *  the key set of one map and the time list is the vector at the end of the path. The
+ *  contents without an FMI level type are not indexed. */
+
+struct ContentIndex
+{
+  T::ContentInfoList    contentInfoList;        //!< The indexed contents (owned by the index).
+  ContentLevelId_map    levelIds;               //!< Level type → level → forecast type → forecast number → geometry → contents.
+};
+
+typedef std::shared_ptr<const ContentIndex> ContentIndex_sptr;
+
+
+void createContentIndex(ContentIndex& index);
+void getContentsByTime(const ContentLevel_map *levels,int forecastType,int forecastNumber,T::GeometryId geometryId,const std::string& forecastTime,int minLevel,int maxLevel,ContentInfoPtr_vec& contents);
+
+
+
+/*! \brief Find the facet of the key in the map. Returns nullptr if the map is nullptr
+ *  or the key is not found, so the lookups can be chained. */
+
+template <class MAP>
+const typename MAP::mapped_type* findContentFacet(const MAP *map,typename MAP::key_type key)
+{
+  if (map == nullptr)
+    return nullptr;
+
+  auto it = map->find(key);
+  if (it == map->end())
+    return nullptr;
+
+  return &it->second;
+}
+
+
+
+/*! \brief Get the keys of the map (nullptr = no keys). */
+
+template <class MAP>
+void getContentFacetKeys(const MAP *map,std::set<int>& keys)
+{
+  if (map == nullptr)
+    return;
+
+  for (auto it = map->begin(); it != map->end(); ++it)
+    keys.insert(keys.end(),it->first);
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
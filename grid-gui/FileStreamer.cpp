@@ -0,0 +1,476 @@
+#include "FileStreamer.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+#define FILE_RANGE_CHUNK_SIZE  (256*1024)
+
+
+
+/*! \brief GridGui: Read bytes from the given position of an open file. Returns false
+ *  on a read error or if the file ends before all the bytes have been read. */
+
+static bool readBytes(int fd,std::size_t offset,std::size_t length,char *buffer)
+{
+  while (length > 0)
+  {
+    ssize_t n = pread(fd,buffer,length,offset);
+    if (n < 0  &&  errno == EINTR)
+      continue;
+
+    if (n <= 0)
+      return false;
+
+    buffer += n;
+    offset += n;
+    length -= n;
+  }
+  return true;
+}
+
+
+
+
+
+/*! \brief GridGui: Read bytes from the given position of a file. Returns false if the
+ *  file cannot be opened or it does not contain all the bytes. */
+
+bool readFileBytes(const char *fileName,std::size_t offset,std::size_t length,char *buffer)
+{
+  try
+  {
+    int fd = ::open(fileName,O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+
+    bool ok = readBytes(fd,offset,length,buffer);
+    ::close(fd);
+    return ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check that a GRIB message starts at the given position of a file.
+ *  The trailer is set to the GRIB end section "7777" if the message does not end
+ *  with it, otherwise it is cleared. Returns false if the file cannot be read or
+ *  there is no GRIB message at the position. */
+
+bool checkGribMessage(const char *fileName,std::size_t position,std::size_t size,std::string& trailer)
+{
+  try
+  {
+    trailer.clear();
+    if (size < 8)
+      return false;
+
+    char signature[4];
+    char tail[4];
+    if (!readFileBytes(fileName,position,4,signature)  ||  memcmp(signature,"GRIB",4) != 0)
+      return false;
+
+    if (!readFileBytes(fileName,position + size - 4,4,tail))
+      return false;
+
+    if (memcmp(tail,"7777",4) != 0)
+      trailer = "7777";
+
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Read the start offsets of the sections of a GRIB1 or GRIB2 message
+ *  (relative to the start of the message). Only the section headers are read from
+ *  the file. Returns false if the file cannot be read or the message is not a GRIB
+ *  message. */
+
+bool readGribSections(const char *fileName,std::size_t position,std::size_t size,std::vector<uint>& sections)
+{
+  try
+  {
+    sections.clear();
+
+    int fd = ::open(fileName,O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+
+    unsigned char h[16];
+    if (size < 16  ||  !readBytes(fd,position,16,reinterpret_cast<char*>(h))  ||  memcmp(h,"GRIB",4) != 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    sections.push_back(0);
+
+    if (h[7] == 2)
+    {
+      // ### GRIB2: the sections start with a 4-byte length and the section number.
+
+      std::size_t offset = 16;
+      while (offset + 4 <= size  &&  readBytes(fd,position + offset,std::min<std::size_t>(5,size - offset),reinterpret_cast<char*>(h)))
+      {
+        sections.push_back(offset);
+        if (memcmp(h,"7777",4) == 0)
+          break;
+
+        std::size_t len = (C_UINT(h[0]) << 24) | (C_UINT(h[1]) << 16) | (C_UINT(h[2]) << 8) | h[3];
+        if (len < 5)
+          break;
+
+        offset += len;
+      }
+    }
+    else
+    {
+      // ### GRIB1: the sections 2 (grid) and 3 (bitmap) exist only if the flags of
+      // ### the section 1 say so.
+
+      std::size_t offset = 8;
+      bool hasGrid = true;
+      bool hasBitmap = true;
+      for (uint section=1; section<=5  &&  offset + 4 <= size; section++)
+      {
+        if (!readBytes(fd,position + offset,std::min<std::size_t>(8,size - offset),reinterpret_cast<char*>(h)))
+          break;
+
+        if (section == 1)
+        {
+          hasGrid = (h[7] & 0x80) != 0;
+          hasBitmap = (h[7] & 0x40) != 0;
+        }
+
+        if ((section == 2 && !hasGrid) || (section == 3 && !hasBitmap))
+          continue;
+
+        sections.push_back(offset);
+        if (memcmp(h,"7777",4) == 0)
+          break;
+
+        std::size_t len = (C_UINT(h[0]) << 16) | (C_UINT(h[1]) << 8) | h[2];
+        if (len < 4)
+          break;
+
+        offset += len;
+      }
+    }
+
+    ::close(fd);
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Constructor. */
+
+FileRangeStreamer::FileRangeStreamer()
+{
+  try
+  {
+    mFileHandle = -1;
+    mPosition = 0;
+    mEnd = 0;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+FileRangeStreamer::~FileRangeStreamer()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Open the file and select the byte range. The streamer can be
+ *  reopened after the previous range has been sent. Returns false if the file
+ *  cannot be opened. */
+
+bool FileRangeStreamer::open(const char *fileName,std::size_t offset,std::size_t length,const std::string& trailer)
+{
+  try
+  {
+    close();
+
+    if (length > 0)
+    {
+      mFileHandle = ::open(fileName,O_RDONLY | O_CLOEXEC);
+      if (mFileHandle < 0)
+        return false;
+
+      posix_fadvise(mFileHandle,offset,length,POSIX_FADV_SEQUENTIAL);
+    }
+
+    mPosition = offset;
+    mEnd = offset + length;
+    mTrailer = trailer;
+    setStatus(StreamerStatus::OK);
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Close the file. */
+
+void FileRangeStreamer::close()
+{
+  try
+  {
+    if (mFileHandle >= 0)
+      ::close(mFileHandle);
+
+    mFileHandle = -1;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the next chunk of the range. The trailer is sent with the last
+ *  chunk. */
+
+std::string FileRangeStreamer::getChunk()
+{
+  try
+  {
+    std::string chunk;
+
+    if (mPosition < mEnd)
+    {
+      std::size_t len = mEnd - mPosition;
+      if (len > FILE_RANGE_CHUNK_SIZE)
+        len = FILE_RANGE_CHUNK_SIZE;
+
+      chunk.resize(len);
+      if (mFileHandle < 0  ||  !readBytes(mFileHandle,mPosition,len,&chunk[0]))
+      {
+        // ### The file has been truncated or removed while it was being sent.
+
+        close();
+        setStatus(StreamerStatus::EXIT_ERROR);
+        return std::string();
+      }
+
+      mPosition += len;
+    }
+
+    if (mPosition >= mEnd)
+    {
+      chunk += mTrailer;
+      close();
+      setStatus(StreamerStatus::EXIT_OK);
+    }
+
+    return chunk;
+  }
+  catch (...)
+  {
+    setStatus(StreamerStatus::EXIT_ERROR);
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+    return std::string();
+  }
+}
+
+
+
+
+
+
+/*! \brief GridGui: Constructor. */
+
+BufferRangeStreamer::BufferRangeStreamer()
+{
+  try
+  {
+    mPosition = 0;
+    mEnd = 0;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+BufferRangeStreamer::~BufferRangeStreamer()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Select the buffer and its byte range. The streamer can be reopened
+ *  after the previous range has been sent. Returns false if the range is not inside
+ *  the buffer. */
+
+bool BufferRangeStreamer::open(const ByteBuffer_sptr& buffer,std::size_t offset,std::size_t length,const std::string& trailer)
+{
+  try
+  {
+    close();
+
+    if (length > 0  &&  (!buffer  ||  offset + length > buffer->size()))
+      return false;
+
+    mBuffer = buffer;
+    mPosition = offset;
+    mEnd = offset + length;
+    mTrailer = trailer;
+    setStatus(StreamerStatus::OK);
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Release the buffer. */
+
+void BufferRangeStreamer::close()
+{
+  try
+  {
+    mBuffer.reset();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the next chunk of the range. The trailer is sent with the last
+ *  chunk. */
+
+std::string BufferRangeStreamer::getChunk()
+{
+  try
+  {
+    std::string chunk;
+
+    if (mPosition < mEnd)
+    {
+      std::size_t len = mEnd - mPosition;
+      if (len > FILE_RANGE_CHUNK_SIZE)
+        len = FILE_RANGE_CHUNK_SIZE;
+
+      chunk.assign(reinterpret_cast<const char*>(mBuffer->data()) + mPosition,len);
+      mPosition += len;
+    }
+
+    if (mPosition >= mEnd)
+    {
+      chunk += mTrailer;
+      close();
+      setStatus(StreamerStatus::EXIT_OK);
+    }
+
+    return chunk;
+  }
+  catch (...)
+  {
+    setStatus(StreamerStatus::EXIT_ERROR);
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+    return std::string();
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <spine/HTTP.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+bool readFileBytes(const char *fileName,std::size_t offset,std::size_t length,char *buffer);
+bool checkGribMessage(const char *fileName,std::size_t position,std::size_t size,std::string& trailer);
+bool readGribSections(const char *fileName,std::size_t position,std::size_t size,std::vector<uint>& sections);
+
+
+
+// ====================================================================================
+/*! \brief Streams a byte range of a file to the HTTP response in fixed size chunks.
+ *
+ *  The chunks are read from the file only when the server asks for them, so the
+ *  memory used by a download does not depend on the size of the range.  An optional
+ *  trailer is sent after the range (for example, a missing GRIB end section). */
+// ====================================================================================
+
+class FileRangeStreamer : public Spine::HTTP::ContentStreamer
+{
+  public:
+                      FileRangeStreamer();
+                      FileRangeStreamer(const FileRangeStreamer&) = delete;
+    virtual           ~FileRangeStreamer();
+
+    FileRangeStreamer& operator=(const FileRangeStreamer&) = delete;
+
+    bool              open(const char *fileName,std::size_t offset,std::size_t length,const std::string& trailer);
+    void              close();
+
+    std::string       getChunk() override;
+
+  protected:
+
+    int               mFileHandle;      //!< Open file (-1 = closed).
+    std::size_t       mPosition;        //!< File offset of the next chunk.
+    std::size_t       mEnd;             //!< File offset of the end of the range.
+    std::string       mTrailer;         //!< Bytes sent after the range.
+};
+
+
+
+typedef std::shared_ptr<const std::vector<uchar>> ByteBuffer_sptr;
+
+
+
+// ====================================================================================
+/*! \brief Streams a byte range of a shared memory buffer to the HTTP response in
+ *  fixed size chunks.
+ *
+ *  The buffer is shared with the streamer instead of being copied into the response,
+ *  so a message fetched from the data server is kept in the memory only once.  An
+ *  optional trailer is sent after the range like in FileRangeStreamer. */
+// ====================================================================================
+
+class BufferRangeStreamer : public Spine::HTTP::ContentStreamer
+{
+  public:
+                      BufferRangeStreamer();
+                      BufferRangeStreamer(const BufferRangeStreamer&) = delete;
+    virtual           ~BufferRangeStreamer();
+
+    BufferRangeStreamer& operator=(const BufferRangeStreamer&) = delete;
+
+    bool              open(const ByteBuffer_sptr& buffer,std::size_t offset,std::size_t length,const std::string& trailer);
+    void              close();
+
+    std::string       getChunk() override;
+
+  protected:
+
+    ByteBuffer_sptr   mBuffer;          //!< The buffer (released when the range has been sent).
+    std::size_t       mPosition;        //!< Buffer offset of the next chunk.
+    std::size_t       mEnd;             //!< Buffer offset of the end of the range.
+    std::string       mTrailer;         //!< Bytes sent after the range.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
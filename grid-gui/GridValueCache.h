@@ -0,0 +1,48 @@
+#pragma once
+
+#include "LruCache.h"
+#include <grid-files/common/Typedefs.h>
+#include <memory>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+/*! \brief Decoded values of a grid message in the given geometry. */
+
+struct GridValues
+{
+  uint              columns = 0;                //!< Number of grid columns.
+  uint              rows = 0;                   //!< Number of grid rows.
+  T::GeometryId     geometryId = 0;             //!< Geometry of the values.
+  T::ParamValue_vec values;                     //!< Grid values (rows * columns).
+
+  std::size_t       getSize() const
+  {
+    return values.size() * sizeof(T::ParamValue) + sizeof(GridValues);
+  }
+};
+
+typedef std::shared_ptr<const GridValues> GridValues_sptr;
+
+
+
+// ====================================================================================
+/*! \brief Byte-budgeted in-memory cache of the decoded grid values.
+ *
+ *  The same message is typically painted several times (image, streams, map,
+ *  table, different colors and overlays), so the values are fetched from the data
+ *  server once per (message, geometry) key and shared by all the pages. */
+// ====================================================================================
+
+typedef LruCache<GridValues_sptr,LruObjectSize> GridValueCache;
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
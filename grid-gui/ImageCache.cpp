@@ -0,0 +1,245 @@
+#include "ImageCache.h"
+#include <grid-files/common/GeneralFunctions.h>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Constructor. */
+
+ImageCache::ImageCache()
+{
+  try
+  {
+    mImages.setRemoveCallback([this](const std::string& key,const ImageData& image) { removeMapping(key,image); });
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+ImageCache::~ImageCache()
+{
+  try
+  {
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Set the byte budget of the cache. Zero disables caching. */
+
+void ImageCache::setMaxSize(std::size_t maxSize)
+{
+  try
+  {
+    mImages.setMaxSize(maxSize);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the byte budget of the cache. */
+
+std::size_t ImageCache::getMaxSize()
+{
+  try
+  {
+    return mImages.getMaxSize();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the number of bytes currently cached. */
+
+std::size_t ImageCache::getSize()
+{
+  try
+  {
+    return mImages.getSize();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get image. Returns false if the key is not cached. */
+
+bool ImageCache::getImage(const std::string& key,ImageData& image)
+{
+  try
+  {
+    return mImages.get(key,image);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add image. Replaces an earlier image with the same key. The mapped
+ *  file of the image is recorded after the image has been added, because replacing
+ *  the earlier image drops the record of its file. */
+
+void ImageCache::addImage(const std::string& key,const ImageData& image)
+{
+  try
+  {
+    if (image.empty())
+      return;
+
+    if (!mImages.add(key,image)  ||  !image.mappedFile)
+      return;
+
+    AutoThreadLock lock(&mThreadLock);
+    mMappedFiles[image.mappedFile->getFileName()] = key;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Remove image. */
+
+void ImageCache::removeImage(const std::string& key)
+{
+  try
+  {
+    mImages.remove(key);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Remove the image that is mapped from the given file. Called when
+ *  the file is removed from the image cache directory: the mapping would keep the
+ *  disk space of the removed file reserved for as long as the image is cached. */
+
+void ImageCache::removeMappedFile(const std::string& fileName)
+{
+  try
+  {
+    std::string key;
+    {
+      AutoThreadLock lock(&mThreadLock);
+
+      auto mf = mMappedFiles.find(fileName);
+      if (mf == mMappedFiles.end())
+        return;
+
+      key = mf->second;
+      mMappedFiles.erase(mf);
+    }
+
+    mImages.remove(key);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Clear. */
+
+void ImageCache::clear()
+{
+  try
+  {
+    mImages.clear();
+
+    AutoThreadLock lock(&mThreadLock);
+    mMappedFiles.clear();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Drop the mapped file record of an image that is removed from the
+ *  cache. Called by the LRU cache with its lock held. */
+
+void ImageCache::removeMapping(const std::string& key,const ImageData& image)
+{
+  try
+  {
+    if (!image.mappedFile)
+      return;
+
+    AutoThreadLock lock(&mThreadLock);
+
+    auto mf = mMappedFiles.find(image.mappedFile->getFileName());
+    if (mf != mMappedFiles.end()  &&  mf->second == key)
+      mMappedFiles.erase(mf);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
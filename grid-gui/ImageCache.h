@@ -0,0 +1,87 @@
+#pragma once
+
+#include "LruCache.h"
+#include "MappedFile.h"
+#include <grid-files/common/AutoThreadLock.h>
+#include <grid-files/common/Typedefs.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+typedef std::shared_ptr<std::vector<char>> ImageContent_sptr;  //!< Encoded image blob (PNG / WebP) shared with HTTP responses.
+
+
+/*! \brief An encoded image together with its MIME type. The bytes are either in the
+ *  heap or in a memory-mapped image file. */
+
+struct ImageData
+{
+  ImageContent_sptr content;                    //!< Encoded image bytes in the heap.
+  MappedFile_sptr   mappedFile;                 //!< Memory-mapped image file (used instead of content).
+  std::string       contentType;                //!< MIME type of the encoded bytes.
+
+  bool              empty() const  { return !content && !mappedFile; }
+  std::size_t       size() const   { return mappedFile ? mappedFile->getSize() : (content ? content->size() : 0); }
+  const char*       data() const   { return mappedFile ? mappedFile->getData() : (content ? content->data() : nullptr); }
+};
+
+
+/*! \brief Size of a cached image in bytes. */
+
+struct ImageDataSize
+{
+  std::size_t operator()(const ImageData& image) const  { return image.size(); }
+};
+
+
+
+// ====================================================================================
+/*! \brief Byte-budgeted in-memory cache of encoded images.
+ *
+ *  Sits in front of the on-disk image cache.  Entries are keyed by the same hash
+ *  strings that the page handlers use for the disk cache, and the images are handed
+ *  to the HTTP response as they are, so a hit costs neither a file read nor a copy
+ *  into the heap (memory-mapped images are backed by the page cache).  The least
+ *  recently used images are dropped when the byte budget is exceeded (see LruCache).
+ *
+ *  The cache also records which image is mapped from which image file, so that the
+ *  mapping can be released when the file is removed from the image cache directory. */
+// ====================================================================================
+
+class ImageCache
+{
+  public:
+                      ImageCache();
+    virtual           ~ImageCache();
+
+    void              setMaxSize(std::size_t maxSize);
+    std::size_t       getMaxSize();
+    std::size_t       getSize();
+
+    bool              getImage(const std::string& key,ImageData& image);
+    void              addImage(const std::string& key,const ImageData& image);
+    void              removeImage(const std::string& key);
+    void              removeMappedFile(const std::string& fileName);
+    void              clear();
+
+  protected:
+
+    void              removeMapping(const std::string& key,const ImageData& image);
+
+    LruCache<ImageData,ImageDataSize> mImages;  //!< The images by key.
+    std::unordered_map<std::string,std::string> mMappedFiles;  //!< Mapped file name → key.
+    ThreadLock        mThreadLock;      //!< Lock protecting mMappedFiles.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,368 @@
+#include "ImageEncoder.h"
+#include "ValueStats.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <png.h>
+#include <webp/encode.h>
+#include <webp/mux.h>
+#include <csetjmp>
+#include <cmath>
+#include <cstring>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: libpng write callback. Appends the bytes to the output buffer. */
+
+static void png_write_buffer(png_structp png,png_bytep data,png_size_t length)
+{
+  auto output = static_cast<std::vector<char>*>(png_get_io_ptr(png));
+  output->insert(output->end(),reinterpret_cast<char*>(data),reinterpret_cast<char*>(data) + length);
+}
+
+
+
+
+
+/*! \brief GridGui: libpng flush callback. Nothing to flush in the memory. */
+
+static void png_flush_buffer(png_structp png)
+{
+}
+
+
+
+
+
+/*! \brief GridGui: Encode an ARGB image (0xAARRGGBB per pixel) into a PNG image in
+ *  the memory. */
+
+void png_encode(const uint *image,int width,int height,uint compressionLevel,std::vector<char>& output)
+{
+  try
+  {
+    output.clear();
+    if (image == nullptr || width <= 0 || height <= 0)
+      return;
+
+    std::vector<png_byte> row(width*4);
+
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING,nullptr,nullptr,nullptr);
+    if (png == nullptr)
+      throw Fmi::Exception(BCP,"Cannot create the PNG write structure!");
+
+    png_infop info = png_create_info_struct(png);
+    if (info == nullptr)
+    {
+      png_destroy_write_struct(&png,nullptr);
+      throw Fmi::Exception(BCP,"Cannot create the PNG info structure!");
+    }
+
+    // ### libpng reports the errors with longjmp(). No objects with destructors are
+    // ### created between here and the end of the encoding.
+
+    if (setjmp(png_jmpbuf(png)))
+    {
+      png_destroy_write_struct(&png,&info);
+      output.clear();
+      throw Fmi::Exception(BCP,"PNG encoding failed!");
+    }
+
+    png_set_write_fn(png,&output,png_write_buffer,png_flush_buffer);
+    png_set_compression_level(png,compressionLevel);
+    png_set_IHDR(png,info,width,height,8,PNG_COLOR_TYPE_RGB_ALPHA,PNG_INTERLACE_NONE,PNG_COMPRESSION_TYPE_DEFAULT,PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png,info);
+
+    const uint *p = image;
+    for (int y=0; y<height; y++)
+    {
+      png_byte *r = row.data();
+      for (int x=0; x<width; x++)
+      {
+        uint col = *p++;
+        r[0] = (col >> 16) & 0xFF;
+        r[1] = (col >> 8) & 0xFF;
+        r[2] = col & 0xFF;
+        r[3] = (col >> 24) & 0xFF;
+        r += 4;
+      }
+      png_write_row(png,row.data());
+    }
+
+    png_write_end(png,nullptr);
+    png_destroy_write_struct(&png,&info);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Encode an animation into a WebP image in the memory. The frames
+ *  are RGBA images (R in the lowest byte) and the frame times are in milliseconds. */
+
+void webp_anim_encode(uint **image,int width,int height,int frames,const std::vector<int>& frameTimes,std::vector<char>& output)
+{
+  try
+  {
+    output.clear();
+    if (image == nullptr || width <= 0 || height <= 0 || frames <= 0)
+      return;
+
+    WebPAnimEncoderOptions options;
+    if (!WebPAnimEncoderOptionsInit(&options))
+      throw Fmi::Exception(BCP,"WebP version mismatch!");
+
+    WebPConfig config;
+    if (!WebPConfigInit(&config))
+      throw Fmi::Exception(BCP,"WebP version mismatch!");
+
+    config.lossless = 1;
+
+    WebPAnimEncoder *encoder = WebPAnimEncoderNew(width,height,&options);
+    if (encoder == nullptr)
+      throw Fmi::Exception(BCP,"Cannot create the WebP animation encoder!");
+
+    int timestamp = 0;
+    for (int t=0; t<frames; t++)
+    {
+      WebPPicture picture;
+      if (!WebPPictureInit(&picture))
+      {
+        WebPAnimEncoderDelete(encoder);
+        throw Fmi::Exception(BCP,"WebP version mismatch!");
+      }
+
+      picture.use_argb = 1;
+      picture.width = width;
+      picture.height = height;
+
+      bool ok = WebPPictureImportRGBA(&picture,reinterpret_cast<const uint8_t*>(image[t]),width*4)  &&
+                WebPAnimEncoderAdd(encoder,&picture,timestamp,&config);
+
+      WebPPictureFree(&picture);
+
+      if (!ok)
+      {
+        WebPAnimEncoderDelete(encoder);
+        Fmi::Exception exception(BCP,"Cannot add a frame to the WebP animation!");
+        exception.addParameter("Frame",std::to_string(t));
+        throw exception;
+      }
+
+      if (C_UINT(t) < frameTimes.size())
+        timestamp += frameTimes[t];
+    }
+
+    WebPData data;
+    WebPDataInit(&data);
+
+    if (!WebPAnimEncoderAdd(encoder,nullptr,timestamp,nullptr) || !WebPAnimEncoderAssemble(encoder,&data))
+    {
+      WebPAnimEncoderDelete(encoder);
+      throw Fmi::Exception(BCP,"Cannot assemble the WebP animation!");
+    }
+
+    output.assign(reinterpret_cast<const char*>(data.bytes),reinterpret_cast<const char*>(data.bytes) + data.size);
+
+    WebPDataClear(&data);
+    WebPAnimEncoderDelete(encoder);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+/*! \brief GridGui: Append a 32-bit value to the output buffer in the little-endian
+ *  byte order. */
+
+static void raster_put32(std::vector<char>& output,std::uint32_t value)
+{
+  output.push_back(static_cast<char>(value & 0xFF));
+  output.push_back(static_cast<char>((value >> 8) & 0xFF));
+  output.push_back(static_cast<char>((value >> 16) & 0xFF));
+  output.push_back(static_cast<char>((value >> 24) & 0xFF));
+}
+
+
+
+
+
+/*! \brief GridGui: Append a float to the output buffer in the little-endian byte order. */
+
+static void raster_putFloat(std::vector<char>& output,float value)
+{
+  std::uint32_t bits = 0;
+  memcpy(&bits,&value,sizeof(bits));
+  raster_put32(output,bits);
+}
+
+
+
+
+
+/*! \brief GridGui: Convert a float into a half precision float (round to nearest even).
+ *  Too large values become infinite and too small values become zero. */
+
+static std::uint16_t raster_half(float value)
+{
+  std::uint32_t f = 0;
+  memcpy(&f,&value,sizeof(f));
+
+  std::uint32_t sign = (f >> 16) & 0x8000;
+  int exponent = C_INT((f >> 23) & 0xFF);
+  std::uint32_t mantissa = f & 0x7FFFFF;
+
+  if (exponent == 0xFF)
+    return static_cast<std::uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0));
+
+  int e = exponent - 127 + 15;
+  if (e >= 31)
+    return static_cast<std::uint16_t>(sign | 0x7C00);
+
+  if (e <= 0)
+  {
+    // ### Subnormal half precision value.
+
+    if (e < -10)
+      return static_cast<std::uint16_t>(sign);
+
+    mantissa |= 0x800000;
+    std::uint32_t shift = 14 - e;
+    std::uint32_t half = mantissa >> shift;
+    std::uint32_t rest = mantissa & ((1U << shift) - 1);
+    std::uint32_t middle = 1U << (shift - 1);
+    if (rest > middle || (rest == middle && (half & 1)))
+      half++;
+
+    return static_cast<std::uint16_t>(sign | half);
+  }
+
+  // ### A rounding carry moves correctly into the exponent.
+
+  std::uint32_t half = (C_UINT(e) << 10) | (mantissa >> 13);
+  std::uint32_t rest = mantissa & 0x1FFF;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+    half++;
+
+  return static_cast<std::uint16_t>(sign | half);
+}
+
+
+
+
+
+/*! \brief GridGui: Encode grid values into a binary value raster in the memory. The
+ *  rows are written in the reverse order if flip is set, so the first row is always
+ *  the top row of the image. The quantized format spreads the value range of the
+ *  raster over 0..0xFFFE. */
+
+void value_raster_encode(const T::ParamValue *values,int width,int height,bool flip,uint format,std::vector<char>& output)
+{
+  try
+  {
+    output.clear();
+    if (values == nullptr || width <= 0 || height <= 0)
+      return;
+
+    if (format > VALUE_RASTER_QUANTIZED16)
+      format = VALUE_RASTER_FLOAT32;
+
+    std::size_t size = C_UINT(width) * C_UINT(height);
+
+    float scale = 1;
+    float offset = 0;
+
+    if (format == VALUE_RASTER_QUANTIZED16)
+    {
+      ValueStats stats;
+      computeValueStats(values,size,stats);
+      if (stats.count > 0)
+      {
+        offset = static_cast<float>(stats.minValue);
+        if (stats.maxValue > stats.minValue)
+          scale = static_cast<float>((stats.maxValue - stats.minValue) / (VALUE_RASTER_MISSING16 - 1));
+      }
+    }
+
+    std::size_t valueSize = (format == VALUE_RASTER_FLOAT32) ? 4 : 2;
+    output.reserve(VALUE_RASTER_HEADER_SIZE + size * valueSize);
+
+    output.push_back('G');
+    output.push_back('V');
+    output.push_back('R');
+    output.push_back('1');
+    raster_put32(output,C_UINT(width));
+    raster_put32(output,C_UINT(height));
+    raster_put32(output,format);
+    raster_putFloat(output,scale);
+    raster_putFloat(output,offset);
+
+    output.resize(VALUE_RASTER_HEADER_SIZE + size * valueSize);
+    unsigned char *p = reinterpret_cast<unsigned char*>(output.data() + VALUE_RASTER_HEADER_SIZE);
+
+    for (int y=0; y<height; y++)
+    {
+      const T::ParamValue *row = values + C_UINT(flip ? height - y - 1 : y) * width;
+      for (int x=0; x<width; x++)
+      {
+        T::ParamValue v = row[x];
+        bool missing = (v == ParamValueMissing || std::isnan(v));
+
+        if (format == VALUE_RASTER_FLOAT32)
+        {
+          std::uint32_t bits = 0;
+          float f = missing ? NAN : static_cast<float>(v);
+          memcpy(&bits,&f,sizeof(bits));
+          *p++ = bits & 0xFF;
+          *p++ = (bits >> 8) & 0xFF;
+          *p++ = (bits >> 16) & 0xFF;
+          *p++ = (bits >> 24) & 0xFF;
+          continue;
+        }
+
+        std::uint32_t raw = 0;
+        if (format == VALUE_RASTER_FLOAT16)
+        {
+          raw = missing ? 0x7E00 : raster_half(static_cast<float>(v));
+        }
+        else
+        if (missing)
+        {
+          raw = VALUE_RASTER_MISSING16;
+        }
+        else
+        {
+          double q = std::round((v - offset) / scale);
+          raw = C_UINT(std::max(0.0,std::min(q,C_DOUBLE(VALUE_RASTER_MISSING16 - 1))));
+        }
+
+        *p++ = raw & 0xFF;
+        *p++ = (raw >> 8) & 0xFF;
+      }
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
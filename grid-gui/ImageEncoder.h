@@ -0,0 +1,38 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+// ### Image encoders that write the encoded bytes into a memory buffer instead of
+// ### a file. The pixels are in the same format as with png_save() and webp_anim_save().
+
+void png_encode(const uint *image,int width,int height,uint compressionLevel,std::vector<char>& output);
+void webp_anim_encode(uint **image,int width,int height,int frames,const std::vector<int>& frameTimes,std::vector<char>& output);
+
+
+// ### Binary value raster: a 24-byte little-endian header (magic "GVR1", width,
+// ### height, format, scale, offset) followed by the values row by row from the top
+// ### of the image. A value is offset + scale * raw value. The missing values are
+// ### NaN in the float formats and 0xFFFF in the quantized format.
+
+#define VALUE_RASTER_FLOAT32        0
+#define VALUE_RASTER_FLOAT16        1
+#define VALUE_RASTER_QUANTIZED16    2
+
+#define VALUE_RASTER_HEADER_SIZE    24
+#define VALUE_RASTER_MISSING16      0xFFFF
+
+void value_raster_encode(const T::ParamValue *values,int width,int height,bool flip,uint format,std::vector<char>& output);
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
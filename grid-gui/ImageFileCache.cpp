@@ -0,0 +1,710 @@
+#include "ImageFileCache.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Constructor. */
+
+ImageFileCache::ImageFileCache()
+{
+  try
+  {
+    mSize = 0;
+    mProtectedSize = 0;
+    mMaxSize = 0;
+    mMaxImages = 1000;
+    mMinImages = 500;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+ImageFileCache::~ImageFileCache()
+{
+  try
+  {
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Set the limits of the cache. A zero maxSize means that only the
+ *  image count is limited. */
+
+void ImageFileCache::setLimits(std::size_t maxSize,uint maxImages,uint minImages)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+    mMaxSize = maxSize;
+    mMaxImages = maxImages;
+    mMinImages = minImages;
+    if (mMinImages > mMaxImages)
+      mMinImages = mMaxImages;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Record a hit of an indexed image file. Returns false if the file
+ *  is not in the index. */
+
+bool ImageFileCache::touchFile(const std::string& fileName)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+
+    auto it = mEntries.find(fileName);
+    if (it == mEntries.end())
+      return false;
+
+    access(it->second);
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Set the function that is called for every evicted file after it
+ *  has been removed from the disk (outside of the lock). Must be set before the cache
+ *  is used. */
+
+void ImageFileCache::setRemoveCallback(const std::function<void(const std::string&)>& removeCallback)
+{
+  try
+  {
+    mRemoveCallback = removeCallback;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add a new (or re-rendered) image file into the index. Evicted files
+ *  are removed from the disk after the lock has been released. */
+
+void ImageFileCache::addFile(const std::string& fileName,std::size_t fileSize)
+{
+  try
+  {
+    std::vector<std::string> removedFiles;
+    {
+      AutoThreadLock lock(&mThreadLock);
+
+      auto it = mEntries.find(fileName);
+      if (it != mEntries.end())
+        removeEntry(it->second);
+
+      Entry entry;
+      entry.fileName = fileName;
+      entry.fileSize = fileSize;
+      entry.lastAccess = time(nullptr);
+      entry.hitCount = 0;
+      entry.isProtected = false;
+
+      mProbationList.emplace_front(entry);
+      mEntries.insert(std::make_pair(fileName,mProbationList.begin()));
+      mSize += fileSize;
+
+      // ### The new file is not evicted, otherwise the next request would render it again.
+
+      evict(removedFiles,&mProbationList.front());
+    }
+
+    removeFiles(removedFiles);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Register an image file that was found from the cache directory
+ *  (i.e. it was rendered before the restart). The file is placed behind the files
+ *  that have been used after the restart, so the caller should register the found
+ *  files from the newest to the oldest. Returns false if the file is already indexed. */
+
+bool ImageFileCache::registerFile(const std::string& fileName,std::size_t fileSize,time_t lastAccess)
+{
+  try
+  {
+    std::vector<std::string> removedFiles;
+    {
+      AutoThreadLock lock(&mThreadLock);
+
+      if (mEntries.find(fileName) != mEntries.end())
+        return false;
+
+      Entry entry;
+      entry.fileName = fileName;
+      entry.fileSize = fileSize;
+      entry.lastAccess = lastAccess;
+      entry.hitCount = 0;
+      entry.isProtected = false;
+
+      mProbationList.emplace_back(entry);
+      mEntries.insert(std::make_pair(fileName,std::prev(mProbationList.end())));
+      mSize += fileSize;
+
+      evict(removedFiles,nullptr);
+    }
+
+    removeFiles(removedFiles);
+    return true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check if the image file is in the index. */
+
+bool ImageFileCache::containsFile(const std::string& fileName)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+    return (mEntries.find(fileName) != mEntries.end());
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Remove an image file from the index. The file itself is not touched. */
+
+void ImageFileCache::removeFile(const std::string& fileName)
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+
+    auto it = mEntries.find(fileName);
+    if (it != mEntries.end())
+      removeEntry(it->second);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the total size of the indexed files. */
+
+std::size_t ImageFileCache::getSize()
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+    return mSize;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the number of indexed files. */
+
+uint ImageFileCache::getCount()
+{
+  try
+  {
+    AutoThreadLock lock(&mThreadLock);
+    return mEntries.size();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check that an encoded image is complete, i.e. it was not truncated
+ *  by a crash or by a full disk while it was being written. */
+
+bool ImageFileCache::isCompleteImage(const char *data,std::size_t size)
+{
+  try
+  {
+    if (data == nullptr  ||  size < 16)
+      return false;
+
+    return checkImage(reinterpret_cast<const uchar*>(data),reinterpret_cast<const uchar*>(data + size - 8),size);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check that an image file is complete. Only the header and the
+ *  trailer of the file are read. */
+
+bool ImageFileCache::isCompleteImageFile(const char *fileName)
+{
+  try
+  {
+    FILE *file = fopen(fileName,"re");
+    if (file == nullptr)
+      return false;
+
+    uchar head[12];
+    uchar tail[8];
+    bool ok = false;
+
+    if (fseek(file,0,SEEK_END) == 0)
+    {
+      long size = ftell(file);
+      if (size >= 16  &&
+          fseek(file,0,SEEK_SET) == 0  &&  fread(head,1,12,file) == 12  &&
+          fseek(file,size-8,SEEK_SET) == 0  &&  fread(tail,1,8,file) == 8)
+      {
+        ok = checkImage(head,tail,size);
+      }
+    }
+
+    fclose(file);
+    return ok;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check the first 12 and the last 8 bytes of a PNG or WebP image.
+ *  A PNG image must end with the IEND chunk and the RIFF size of a WebP image must
+ *  match the size of the data. */
+
+bool ImageFileCache::checkImage(const uchar *head,const uchar *tail,std::size_t size)
+{
+  try
+  {
+    static const uchar pngSignature[8] = {0x89,'P','N','G',0x0D,0x0A,0x1A,0x0A};
+
+    if (memcmp(head,pngSignature,8) == 0)
+      return (memcmp(tail,"IEND",4) == 0);
+
+    if (memcmp(head,"RIFF",4) == 0  &&  memcmp(head+8,"WEBP",4) == 0)
+    {
+      std::size_t riffSize = C_UINT(head[4]) | (C_UINT(head[5]) << 8) | (C_UINT(head[6]) << 16) | (C_UINT(head[7]) << 24);
+      return (riffSize + 8 == size);
+    }
+
+    return false;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the owner line written into the lock files of this process
+ *  ("host pid"). */
+
+std::string ImageFileCache::getLockOwner()
+{
+  try
+  {
+    char hostName[256] = "";
+    gethostname(hostName,sizeof(hostName)-1);
+
+    char tmp[300];
+    snprintf(tmp,sizeof(tmp),"%s %d\n",hostName,getpid());
+    return tmp;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Create the lock file of an image file. The lock tells the other
+ *  processes sharing the cache directory that the image is being rendered. A lock
+ *  file that is older than staleTime seconds is considered abandoned (i.e. its owner
+ *  has crashed) and it is taken over, so the stale time must be clearly longer than a
+ *  render. Returns LOCK_ACQUIRED, LOCK_BUSY if another process holds the lock, or
+ *  LOCK_FAILED if the lock file cannot be created at all (for example, the directory
+ *  is not writable or it is full). */
+
+ImageFileCache::LockResult ImageFileCache::lockFile(const std::string& fileName,uint staleTime)
+{
+  try
+  {
+    std::string lockName = fileName + ".lock";
+
+    for (uint t=0; t<2; t++)
+    {
+      int fd = open(lockName.c_str(),O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC,0644);
+      if (fd >= 0)
+      {
+        // The owner of the lock is recorded, so that only the owner removes it.
+
+        std::string owner = getLockOwner();
+        ssize_t n = write(fd,owner.c_str(),owner.length());
+        close(fd);
+
+        if (n != static_cast<ssize_t>(owner.length()))
+        {
+          remove(lockName.c_str());
+          return LOCK_FAILED;
+        }
+        return LOCK_ACQUIRED;
+      }
+
+      if (errno != EEXIST)
+        return LOCK_FAILED;
+
+      time_t modificationTime = getFileModificationTime(lockName.c_str());
+      if (modificationTime == 0  ||  (modificationTime + static_cast<time_t>(staleTime)) >= time(nullptr))
+        return LOCK_BUSY;
+
+      // ### The stale lock is moved away atomically. If another process took it over
+      // ### first, the lock that was moved may be its fresh lock, which is put back.
+
+      std::string staleName = getTemporaryFileName(lockName);
+      if (rename(lockName.c_str(),staleName.c_str()) != 0)
+        continue;
+
+      modificationTime = getFileModificationTime(staleName.c_str());
+      if (modificationTime != 0  &&  (modificationTime + static_cast<time_t>(staleTime)) >= time(nullptr))
+      {
+        if (link(staleName.c_str(),lockName.c_str()) != 0  &&  errno != EEXIST)
+        {
+          remove(staleName.c_str());
+          return LOCK_FAILED;
+        }
+        remove(staleName.c_str());
+        return LOCK_BUSY;
+      }
+
+      remove(staleName.c_str());
+    }
+    return LOCK_BUSY;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Remove the lock file of an image file. The lock file is removed
+ *  only if this process owns it. If the lock was considered stale and taken over by
+ *  another process, it is left to its new owner. */
+
+void ImageFileCache::unlockFile(const std::string& fileName)
+{
+  try
+  {
+    std::string lockName = fileName + ".lock";
+
+    int fd = open(lockName.c_str(),O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return;
+
+    char tmp[300];
+    ssize_t n = read(fd,tmp,sizeof(tmp)-1);
+    close(fd);
+
+    if (n < 0)
+      return;
+
+    tmp[n] = '\0';
+    if (getLockOwner() == tmp)
+      remove(lockName.c_str());
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get a temporary name for an image file that is being written. The
+ *  name is unique over the processes and the nodes sharing the cache directory. */
+
+std::string ImageFileCache::getTemporaryFileName(const std::string& fileName)
+{
+  try
+  {
+    static std::atomic<uint> counter(0);
+
+    char hostName[256] = "";
+    gethostname(hostName,sizeof(hostName)-1);
+
+    char tmp[300];
+    snprintf(tmp,sizeof(tmp),".tmp.%s.%d.%u",hostName,getpid(),counter++);
+    return fileName + tmp;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check if the file is a temporary file or a lock file. */
+
+bool ImageFileCache::isWorkFile(const std::string& fileName)
+{
+  try
+  {
+    if (fileName.find(".tmp.") != std::string::npos)
+      return true;
+
+    return (fileName.length() > 5  &&  fileName.compare(fileName.length()-5,5,".lock") == 0);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Record a hit. The first hit moves the entry to the front of the
+ *  probation segment, later hits move it into the protected segment. The protected
+ *  segment may hold at most 80% of the budget; its least recently used entries are
+ *  demoted back to probation. The caller must hold the lock. */
+
+void ImageFileCache::access(Entry_list::iterator it)
+{
+  try
+  {
+    it->lastAccess = time(nullptr);
+    it->hitCount++;
+
+    if (it->isProtected)
+    {
+      mProtectedList.splice(mProtectedList.begin(),mProtectedList,it);
+      return;
+    }
+
+    if (it->hitCount < 2)
+    {
+      mProbationList.splice(mProbationList.begin(),mProbationList,it);
+      return;
+    }
+
+    it->isProtected = true;
+    mProtectedSize += it->fileSize;
+    mProtectedList.splice(mProtectedList.begin(),mProbationList,it);
+
+    std::size_t maxProtectedSize = mMaxSize / 10 * 8;
+    std::size_t maxProtectedCount = mMaxImages / 10 * 8;
+
+    while (mProtectedList.size() > 1  &&
+           ((mMaxSize > 0  &&  mProtectedSize > maxProtectedSize) || mProtectedList.size() > maxProtectedCount))
+    {
+      auto last = std::prev(mProtectedList.end());
+      last->isProtected = false;
+      mProtectedSize -= last->fileSize;
+      mProbationList.splice(mProbationList.begin(),mProtectedList,last);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Evict entries (probation segment first) until the limits are met.
+ *  The keep entry (if not nullptr) is never evicted. The caller must hold the lock. */
+
+void ImageFileCache::evict(std::vector<std::string>& removedFiles,const Entry *keepEntry)
+{
+  try
+  {
+    bool countExceeded = mEntries.size() > mMaxImages;
+
+    while (!mEntries.empty())
+    {
+      bool overSize = (mMaxSize > 0  &&  mSize > mMaxSize);
+      bool overCount = (countExceeded  &&  mEntries.size() > mMinImages);
+
+      if (!overSize && !overCount)
+        return;
+
+      Entry_list::iterator it;
+      if (!mProbationList.empty()  &&  &mProbationList.back() != keepEntry)
+        it = std::prev(mProbationList.end());
+      else
+      if (!mProtectedList.empty())
+        it = std::prev(mProtectedList.end());
+      else
+        return;
+
+      removedFiles.emplace_back(it->fileName);
+      removeEntry(it);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Remove evicted files from the disk. The lock must not be held. */
+
+void ImageFileCache::removeFiles(const std::vector<std::string>& removedFiles)
+{
+  try
+  {
+    for (auto it = removedFiles.begin(); it != removedFiles.end(); ++it)
+    {
+      remove(it->c_str());
+      if (mRemoveCallback)
+        mRemoveCallback(*it);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Remove an entry from its list and from the file name index. The caller
+ *  must hold the lock. */
+
+void ImageFileCache::removeEntry(Entry_list::iterator it)
+{
+  try
+  {
+    mSize -= it->fileSize;
+    mEntries.erase(it->fileName);
+
+    if (it->isProtected)
+    {
+      mProtectedSize -= it->fileSize;
+      mProtectedList.erase(it);
+    }
+    else
+    {
+      mProbationList.erase(it);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <grid-files/common/AutoThreadLock.h>
+#include <grid-files/common/Typedefs.h>
+#include <functional>
+#include <list>
+#include <unordered_map>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ====================================================================================
+/*! \brief Index of the image files stored in the image cache directory.
+ *
+ *  The image files are content-addressed (the file name is derived from the render
+ *  key), so the index is keyed by the file name and it can be rebuilt from the
+ *  directory listing after a restart.  Every entry records the file size, the last
+ *  access time and the hit count of the image.  Eviction uses a segmented LRU: new images enter a probation segment
+ *  and are promoted to a protected segment on their second hit, so a heavily used
+ *  image survives a burst of one-off renders.  The limits are a byte budget and an
+ *  image count (with minImages as the low-water mark).  All operations are O(1)
+ *  except the eviction itself, which is O(number of evicted files).
+ *
+ *  The directory can be shared by several server processes (or nodes).  An image
+ *  is written into a temporary file that is renamed to its final name when it is
+ *  complete, and a "<file>.lock" file tells the other processes that the image is
+ *  being rendered.  Each process indexes the shared files independently. */
+// ====================================================================================
+
+class ImageFileCache
+{
+  public:
+
+    /*! \brief Result of lockFile(). */
+    enum LockResult
+    {
+      LOCK_ACQUIRED,                    //!< The lock was created; the caller renders the image.
+      LOCK_BUSY,                        //!< Another process is rendering the image.
+      LOCK_FAILED                       //!< The lock file cannot be created (e.g. unwritable or full directory).
+    };
+
+                      ImageFileCache();
+    virtual           ~ImageFileCache();
+
+    void              setLimits(std::size_t maxSize,uint maxImages,uint minImages);
+    void              setRemoveCallback(const std::function<void(const std::string&)>& removeCallback);
+
+    bool              touchFile(const std::string& fileName);
+    void              addFile(const std::string& fileName,std::size_t fileSize);
+    bool              registerFile(const std::string& fileName,std::size_t fileSize,time_t lastAccess);
+    bool              containsFile(const std::string& fileName);
+    void              removeFile(const std::string& fileName);
+
+    std::size_t       getSize();
+    uint              getCount();
+
+    static bool       isCompleteImage(const char *data,std::size_t size);
+    static bool       isCompleteImageFile(const char *fileName);
+
+    static LockResult lockFile(const std::string& fileName,uint staleTime);
+    static void       unlockFile(const std::string& fileName);
+    static std::string getLockOwner();
+    static std::string getTemporaryFileName(const std::string& fileName);
+    static bool       isWorkFile(const std::string& fileName);
+
+  protected:
+
+    static bool       checkImage(const uchar *head,const uchar *tail,std::size_t size);
+
+    struct Entry
+    {
+      std::string     fileName;         //!< Path of the image file.
+      std::size_t     fileSize;         //!< Size of the image file in bytes.
+      time_t          lastAccess;       //!< Time of the latest hit (or insertion).
+      uint            hitCount;         //!< Number of hits since the insertion.
+      bool            isProtected;      //!< True if the entry lives in the protected segment.
+    };
+
+    typedef std::list<Entry> Entry_list;
+
+    void              access(Entry_list::iterator it);
+    void              evict(std::vector<std::string>& removedFiles,const Entry *keepEntry);
+    void              removeFiles(const std::vector<std::string>& removedFiles);
+    void              removeEntry(Entry_list::iterator it);
+
+    Entry_list        mProbationList;   //!< Entries hit at most once, most recently used first.
+    Entry_list        mProtectedList;   //!< Entries hit more than once, most recently used first.
+    std::unordered_map<std::string,Entry_list::iterator> mEntries;  //!< File name → position in one of the lists.
+    std::size_t       mSize;            //!< Total size of the indexed files.
+    std::size_t       mProtectedSize;   //!< Total size of the files in the protected segment.
+    std::size_t       mMaxSize;         //!< Byte budget of the cache directory.
+    uint              mMaxImages;       //!< Eviction starts when the image count exceeds this.
+    uint              mMinImages;       //!< Eviction by count stops at this image count.
+    std::function<void(const std::string&)> mRemoveCallback;  //!< Called for every evicted file after it has been removed.
+    ThreadLock        mThreadLock;      //!< Lock protecting all of the above.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,257 @@
+#include "ImageWriter.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <cstdio>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Constructor. */
+
+ImageWriter::ImageWriter()
+{
+  try
+  {
+    mImageFileCache = nullptr;
+    mMaxQueueSize = 0;
+    mShutdown = true;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+ImageWriter::~ImageWriter()
+{
+  try
+  {
+    shutdown();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Start the writer thread. */
+
+void ImageWriter::init(ImageFileCache *imageFileCache,uint maxQueueSize)
+{
+  try
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mImageFileCache = imageFileCache;
+    mMaxQueueSize = maxQueueSize;
+
+    if (mThread.joinable() || mMaxQueueSize == 0)
+      return;
+
+    mShutdown = false;
+    mThread = std::thread(&ImageWriter::writerThread,this);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Write the queued images and stop the writer thread. */
+
+void ImageWriter::shutdown()
+{
+  try
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mShutdown = true;
+    }
+    mCondition.notify_all();
+
+    if (mThread.joinable())
+      mThread.join();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Add an image to the write queue. The caller must hold the lock
+ *  file of the image. */
+
+void ImageWriter::addImage(const std::string& fileName,const ImageContent_sptr& content)
+{
+  try
+  {
+    Entry entry;
+    entry.fileName = fileName;
+    entry.content = content;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (!mShutdown  &&  mQueue.size() < mMaxQueueSize)
+      {
+        mQueue.emplace_back(entry);
+        mCondition.notify_one();
+        return;
+      }
+    }
+
+    // ### The writer is too far behind (or it is not running). Let's write the image
+    // ### by ourselves.
+
+    writeImage(entry);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the number of images waiting to be written. */
+
+uint ImageWriter::getQueueSize()
+{
+  try
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Write an image file. The image is written into a temporary file
+ *  and renamed when it is complete, so the other processes never see a partial
+ *  image. The lock file of the image is released in any case. */
+
+void ImageWriter::writeImage(const Entry& entry)
+{
+  std::string tmpName = ImageFileCache::getTemporaryFileName(entry.fileName);
+  try
+  {
+    if (entry.content  &&  !entry.content->empty())
+    {
+      FILE *file = fopen(tmpName.c_str(),"we");
+      if (file == nullptr)
+      {
+        Fmi::Exception exception(BCP, "Cannot create the image file!");
+        exception.addParameter("File",tmpName);
+        throw exception;
+      }
+
+      std::size_t n = fwrite(entry.content->data(),1,entry.content->size(),file);
+      int closeResult = fclose(file);
+
+      if (n != entry.content->size() || closeResult != 0)
+      {
+        Fmi::Exception exception(BCP, "Cannot write the image file!");
+        exception.addParameter("File",tmpName);
+        throw exception;
+      }
+
+      if (rename(tmpName.c_str(),entry.fileName.c_str()) != 0)
+      {
+        Fmi::Exception exception(BCP, "Cannot rename the image file!");
+        exception.addParameter("From",tmpName);
+        exception.addParameter("To",entry.fileName);
+        throw exception;
+      }
+
+      if (mImageFileCache != nullptr)
+        mImageFileCache->addFile(entry.fileName,entry.content->size());
+    }
+
+    ImageFileCache::unlockFile(entry.fileName);
+  }
+  catch (...)
+  {
+    remove(tmpName.c_str());
+    ImageFileCache::unlockFile(entry.fileName);
+
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",entry.fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Writer thread. The queue is emptied before the thread exits. */
+
+void ImageWriter::writerThread()
+{
+  while (true)
+  {
+    Entry entry;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock,[this]{ return mShutdown || !mQueue.empty(); });
+
+      if (mQueue.empty())
+        return;
+
+      entry = mQueue.front();
+      mQueue.pop_front();
+    }
+
+    try
+    {
+      writeImage(entry);
+    }
+    catch (...)
+    {
+      // ### The image is still served from the memory, so a failed write only means
+      // ### that the image must be rendered again later.
+
+      Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+      exception.printError();
+    }
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ImageCache.h"
+#include "ImageFileCache.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ====================================================================================
+/*! \brief Background writer that persists rendered images into the image cache
+ *  directory.
+ *
+ *  The images are encoded into the memory and served from there, so writing them
+ *  into the cache directory is not on the critical path of the request.  The caller
+ *  of addImage() must hold the lock file of the image (ImageFileCache::lockFile());
+ *  the writer releases the lock when the image file is complete.  If the queue is
+ *  full (or the writer is not running) the image is written by the calling thread. */
+// ====================================================================================
+
+class ImageWriter
+{
+  public:
+                      ImageWriter();
+    virtual           ~ImageWriter();
+
+    void              init(ImageFileCache *imageFileCache,uint maxQueueSize);
+    void              shutdown();
+
+    void              addImage(const std::string& fileName,const ImageContent_sptr& content);
+    uint              getQueueSize();
+
+  protected:
+
+    struct Entry
+    {
+      std::string                       fileName;     //!< Final name of the image file.
+      ImageContent_sptr                 content;      //!< Encoded image bytes.
+    };
+
+    void              writeImage(const Entry& entry);
+    void              writerThread();
+
+    ImageFileCache*   mImageFileCache;  //!< Index of the image cache directory (not owned).
+    std::deque<Entry> mQueue;           //!< Images waiting to be written.
+    uint              mMaxQueueSize;    //!< Maximum number of images in mQueue.
+    std::thread       mThread;          //!< Writer thread.
+    bool              mShutdown;        //!< True when the writer thread should exit.
+    std::mutex        mMutex;           //!< Lock protecting mQueue and mShutdown.
+    std::condition_variable mCondition; //!< Signaled when an image is queued or the writer is shut down.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <grid-files/common/AutoThreadLock.h>
+#include <grid-files/common/Typedefs.h>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+/*! \brief Size of a cached object that knows its size in bytes (value->getSize()).
+ *  A null object takes no space. */
+
+struct LruObjectSize
+{
+  template <class VALUE>
+  std::size_t operator()(const VALUE& value) const
+  {
+    return value ? value->getSize() : 0;
+  }
+};
+
+
+
+/*! \brief Size of a cache entry when the cache is limited by the number of entries. */
+
+struct LruEntryCount
+{
+  template <class VALUE>
+  std::size_t operator()(const VALUE&) const
+  {
+    return 1;
+  }
+};
+
+
+
+// ====================================================================================
+/*! \brief Thread-safe LRU cache of values by string keys.
+ *
+ *  The entries are kept in a list in the LRU order (most recently used first) and
+ *  indexed by a hash map, so all the operations are O(1) except the eviction itself.
+ *  The size of each value is given by SIZE_FN (bytes with LruObjectSize or one per
+ *  entry with LruEntryCount), and the least recently used entries are dropped when
+ *  the total size exceeds the budget.  A value larger than the whole budget is not
+ *  cached, so a zero budget disables the cache.
+ *
+ *  The optional remove callback is called for every entry that is removed from the
+ *  cache (evicted, replaced or removed explicitly, but not cleared) while the lock of
+ *  the cache is held. */
+// ====================================================================================
+
+template <class VALUE,class SIZE_FN>
+class LruCache
+{
+  public:
+
+    typedef std::function<void(const std::string& key,const VALUE& value)> RemoveCallback;
+
+    LruCache()
+    {
+      mSize = 0;
+      mMaxSize = 0;
+    }
+
+
+    /*! \brief Set the budget of the cache. Zero disables caching. */
+    void setMaxSize(std::size_t maxSize)
+    {
+      try
+      {
+        AutoThreadLock lock(&mThreadLock);
+        mMaxSize = maxSize;
+        evict();
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Get the budget of the cache. */
+    std::size_t getMaxSize()
+    {
+      AutoThreadLock lock(&mThreadLock);
+      return mMaxSize;
+    }
+
+
+    /*! \brief Get the total size of the cached values. */
+    std::size_t getSize()
+    {
+      AutoThreadLock lock(&mThreadLock);
+      return mSize;
+    }
+
+
+    /*! \brief Set the callback that is called for the removed entries. */
+    void setRemoveCallback(const RemoveCallback& removeCallback)
+    {
+      AutoThreadLock lock(&mThreadLock);
+      mRemoveCallback = removeCallback;
+    }
+
+
+    /*! \brief Get a value and mark it as the most recently used. Returns false if the
+     *  key is not cached. */
+    bool get(const std::string& key,VALUE& value)
+    {
+      try
+      {
+        AutoThreadLock lock(&mThreadLock);
+
+        auto it = mEntries.find(key);
+        if (it == mEntries.end())
+          return false;
+
+        mEntryList.splice(mEntryList.begin(),mEntryList,it->second);
+        value = it->second->value;
+        return true;
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Add a value as the most recently used one. An earlier value with the
+     *  same key is replaced. Returns false if the value does not fit into the budget. */
+    bool add(const std::string& key,const VALUE& value)
+    {
+      try
+      {
+        std::size_t size = SIZE_FN()(value);
+
+        AutoThreadLock lock(&mThreadLock);
+
+        if (size > mMaxSize)
+          return false;
+
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+          removeEntry(it->second);
+
+        mEntryList.emplace_front(Entry{key,value,size});
+        mEntries.insert(std::make_pair(key,mEntryList.begin()));
+        mSize += size;
+
+        evict();
+        return true;
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Remove a value. */
+    void remove(const std::string& key)
+    {
+      try
+      {
+        AutoThreadLock lock(&mThreadLock);
+
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+          removeEntry(it->second);
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Remove all the values. */
+    void clear()
+    {
+      try
+      {
+        AutoThreadLock lock(&mThreadLock);
+
+        mEntries.clear();
+        mEntryList.clear();
+        mSize = 0;
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+  private:
+
+    struct Entry
+    {
+      std::string     key;              //!< Key of the value.
+      VALUE           value;            //!< The cached value.
+      std::size_t     size;             //!< Size of the value (by SIZE_FN).
+    };
+
+    typedef std::list<Entry> Entry_list;
+
+    /*! \brief Drop the least recently used entries until the cache fits into its
+     *  budget. The caller must hold the lock. */
+    void evict()
+    {
+      while (mSize > mMaxSize  &&  !mEntryList.empty())
+        removeEntry(std::prev(mEntryList.end()));
+    }
+
+    /*! \brief Remove an entry. The caller must hold the lock. */
+    void removeEntry(typename Entry_list::iterator it)
+    {
+      if (mRemoveCallback)
+        mRemoveCallback(it->key,it->value);
+
+      mSize -= it->size;
+      mEntries.erase(it->key);
+      mEntryList.erase(it);
+    }
+
+    Entry_list        mEntryList;       //!< Entries in LRU order (most recently used first).
+    std::unordered_map<std::string,typename Entry_list::iterator> mEntries;  //!< Key → position in mEntryList.
+    std::size_t       mSize;            //!< Total size of the cached values.
+    std::size_t       mMaxSize;         //!< Budget; 0 disables the cache.
+    RemoveCallback    mRemoveCallback;  //!< Called for the removed entries.
+    ThreadLock        mThreadLock;      //!< Lock protecting all of the above.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
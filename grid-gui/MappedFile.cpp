@@ -0,0 +1,240 @@
+#include "MappedFile.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+#define MAPPED_FILE_CHUNK_SIZE  (256*1024)
+
+
+
+/*! \brief GridGui: Constructor. */
+
+MappedFile::MappedFile()
+{
+  try
+  {
+    mData = nullptr;
+    mSize = 0;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+MappedFile::~MappedFile()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Map the whole file into the memory. Returns false if the file does
+ *  not exist or it is empty. */
+
+bool MappedFile::open(const char *fileName)
+{
+  try
+  {
+    close();
+
+    int fd = ::open(fileName,O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return false;
+
+    struct stat st;
+    if (fstat(fd,&st) != 0  ||  st.st_size <= 0)
+    {
+      ::close(fd);
+      return false;
+    }
+
+    void *data = mmap(nullptr,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+    ::close(fd);
+
+    if (data == MAP_FAILED)
+      return false;
+
+    madvise(data,st.st_size,MADV_SEQUENTIAL);
+
+    mFileName = fileName;
+    mData = data;
+    mSize = st.st_size;
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("File",fileName);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Unmap the file. */
+
+void MappedFile::close()
+{
+  try
+  {
+    if (mData != nullptr)
+      munmap(mData,mSize);
+
+    mFileName.clear();
+    mData = nullptr;
+    mSize = 0;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the mapped data. */
+
+const char* MappedFile::getData() const
+{
+  try
+  {
+    return static_cast<const char*>(mData);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the size of the mapped data. */
+
+std::size_t MappedFile::getSize() const
+{
+  try
+  {
+    return mSize;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the name of the mapped file. */
+
+const std::string& MappedFile::getFileName() const
+{
+  try
+  {
+    return mFileName;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Constructor. */
+
+MappedFileStreamer::MappedFileStreamer(const MappedFile_sptr& mappedFile)
+{
+  try
+  {
+    mMappedFile = mappedFile;
+    mPosition = 0;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+MappedFileStreamer::~MappedFileStreamer()
+{
+}
+
+
+
+
+
+/*! \brief GridGui: Get the next chunk of the file. */
+
+std::string MappedFileStreamer::getChunk()
+{
+  try
+  {
+    std::size_t size = mMappedFile->getSize();
+    std::size_t len = size - mPosition;
+    if (len > MAPPED_FILE_CHUNK_SIZE)
+      len = MAPPED_FILE_CHUNK_SIZE;
+
+    std::string chunk(mMappedFile->getData() + mPosition,len);
+    mPosition += len;
+
+    if (mPosition >= size)
+      setStatus(StreamerStatus::EXIT_OK);
+
+    return chunk;
+  }
+  catch (...)
+  {
+    setStatus(StreamerStatus::EXIT_ERROR);
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+    return std::string();
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
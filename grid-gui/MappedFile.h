@@ -0,0 +1,76 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <spine/HTTP.h>
+#include <memory>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ====================================================================================
+/*! \brief Read-only memory mapping of a whole file.
+ *
+ *  The mapping stays valid after the file has been removed or replaced by a rename,
+ *  which is how the image cache updates its files, so a mapped image can be shared
+ *  by several responses without copying it into the heap.  The file must never be
+ *  truncated in place while it is mapped. */
+// ====================================================================================
+
+class MappedFile
+{
+  public:
+                      MappedFile();
+                      MappedFile(const MappedFile&) = delete;
+    virtual           ~MappedFile();
+
+    MappedFile&       operator=(const MappedFile&) = delete;
+
+    bool              open(const char *fileName);
+    void              close();
+
+    const char*       getData() const;
+    std::size_t       getSize() const;
+    const std::string& getFileName() const;
+
+  protected:
+
+    std::string       mFileName;        //!< Name of the mapped file.
+    void*             mData;            //!< Start of the mapping (nullptr if not mapped).
+    std::size_t       mSize;            //!< Size of the mapping in bytes.
+};
+
+typedef std::shared_ptr<MappedFile> MappedFile_sptr;
+
+
+
+// ====================================================================================
+/*! \brief Streams a memory-mapped file to the HTTP response in fixed size chunks.
+ *
+ *  The streamer keeps a reference to the mapping, so the mapping lives until the
+ *  whole response has been sent even if the image is evicted from the cache. */
+// ====================================================================================
+
+class MappedFileStreamer : public Spine::HTTP::ContentStreamer
+{
+  public:
+                      MappedFileStreamer(const MappedFile_sptr& mappedFile);
+    virtual           ~MappedFileStreamer();
+
+    std::string       getChunk() override;
+
+  protected:
+
+    MappedFile_sptr   mMappedFile;      //!< The file to be sent.
+    std::size_t       mPosition;        //!< Offset of the next chunk.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
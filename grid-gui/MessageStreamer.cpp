@@ -0,0 +1,236 @@
+#include "MessageStreamer.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <cstring>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Constructor. The message list is moved into the streamer. */
+
+MessageListStreamer::MessageListStreamer(const std::shared_ptr<DataServer::ServiceInterface>& dataServer,StreamMessage_vec& messages,WorkerPool *fetchPool,uint maxFetches)
+{
+  try
+  {
+    mDataServer = dataServer;
+    mMessages.swap(messages);
+    mFetchPool = fetchPool;
+    mNext = 0;
+    mNextFetch = 0;
+    mMaxFetches = std::max(1U,maxFetches);
+    mCancelled.reset(new std::atomic<bool>(false));
+    mCurrent = nullptr;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. The fetches that are still queued or running are
+ *  cancelled. They are not waited for: their results are dropped when they complete. */
+
+MessageListStreamer::~MessageListStreamer()
+{
+  try
+  {
+    mCancelled->store(true);
+    mFetches.clear();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Fetch a message from the data server. Returns the message bytes,
+ *  or nullptr if the fetch fails or the download has been cancelled. */
+
+ByteBuffer_sptr MessageListStreamer::fetchMessage(const std::shared_ptr<DataServer::ServiceInterface>& dataServer,const StreamMessage& message,const std::atomic<bool>& cancelled)
+{
+  try
+  {
+    if (cancelled.load())
+      return nullptr;
+
+    std::shared_ptr<std::vector<uchar>> messageBytes(new std::vector<uchar>());
+    std::vector<uint> messageSections;
+    int result = dataServer->getGridMessageBytes(0,message.fileId,message.messageIndex,*messageBytes,messageSections);
+    if (cancelled.load())
+      return nullptr;
+
+    if (result != 0  ||  messageBytes->empty())
+    {
+      Fmi::Exception exception(BCP,"Message fetching failed!");
+      exception.addParameter("FileId",std::to_string(message.fileId));
+      exception.addParameter("MessageIndex",std::to_string(message.messageIndex));
+      exception.addParameter("Result",DataServer::getResultString(result));
+      exception.printError();
+      return nullptr;
+    }
+
+    return messageBytes;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+    return nullptr;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Start fetching the next remote messages until the maximum number
+ *  of fetches is running. */
+
+void MessageListStreamer::startFetches()
+{
+  try
+  {
+    while (mFetches.size() < mMaxFetches  &&  mNextFetch < mMessages.size())
+    {
+      std::size_t index = mNextFetch++;
+      if (!mMessages[index].fileName.empty())
+        continue;
+
+      // ### The fetch gets its own copies of the shared state, so it does not refer to
+      // ### the streamer after the streamer has been destroyed. If the fetch is dropped
+      // ### by the pool, the promise is destroyed unset and the output ends with an error.
+
+      std::shared_ptr<std::promise<ByteBuffer_sptr>> promise(new std::promise<ByteBuffer_sptr>());
+      mFetches.insert(std::make_pair(index,promise->get_future()));
+
+      auto dataServer = mDataServer;
+      auto cancelled = mCancelled;
+      StreamMessage message = mMessages[index];
+
+      mFetchPool->post([dataServer,cancelled,message,promise]()
+      {
+        promise->set_value(fetchMessage(dataServer,message,*cancelled));
+      });
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the next chunk of the current message. The local messages are
+ *  read from their files and the remote messages from their fetched buffers. */
+
+std::string MessageListStreamer::getChunk()
+{
+  try
+  {
+    while (true)
+    {
+      if (mCurrent != nullptr)
+      {
+        std::string chunk = mCurrent->getChunk();
+        if (mCurrent->getStatus() == StreamerStatus::EXIT_ERROR)
+        {
+          setStatus(StreamerStatus::EXIT_ERROR);
+          return std::string();
+        }
+
+        if (mCurrent->getStatus() == StreamerStatus::EXIT_OK)
+        {
+          mCurrent = nullptr;
+          mNext++;
+        }
+
+        if (!chunk.empty())
+          return chunk;
+
+        continue;
+      }
+
+      if (mNext >= mMessages.size())
+      {
+        setStatus(StreamerStatus::EXIT_OK);
+        return std::string();
+      }
+
+      startFetches();
+
+      const StreamMessage& message = mMessages[mNext];
+      if (!message.fileName.empty())
+      {
+        if (!mFile.open(message.fileName.c_str(),message.position,message.size,message.trailer))
+        {
+          setStatus(StreamerStatus::EXIT_ERROR);
+          return std::string();
+        }
+
+        mCurrent = &mFile;
+        continue;
+      }
+
+      auto it = mFetches.find(mNext);
+      if (it == mFetches.end())
+      {
+        setStatus(StreamerStatus::EXIT_ERROR);
+        return std::string();
+      }
+
+      ByteBuffer_sptr bytes = it->second.get();
+      mFetches.erase(it);
+
+      if (!bytes)
+      {
+        setStatus(StreamerStatus::EXIT_ERROR);
+        return std::string();
+      }
+
+      // ### The GRIB end section is added if the message does not contain it.
+
+      std::size_t size = bytes->size();
+      std::string trailer;
+      if (size < 4  ||  memcmp(&(*bytes)[size-4],"7777",4) != 0)
+        trailer = "7777";
+
+      if (!mBuffer.open(bytes,0,size,trailer))
+      {
+        setStatus(StreamerStatus::EXIT_ERROR);
+        return std::string();
+      }
+
+      mCurrent = &mBuffer;
+    }
+  }
+  catch (...)
+  {
+    setStatus(StreamerStatus::EXIT_ERROR);
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+    return std::string();
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
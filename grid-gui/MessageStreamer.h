@@ -0,0 +1,88 @@
+#pragma once
+
+#include "FileStreamer.h"
+#include "WorkerPool.h"
+#include <engines/grid/Engine.h>
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+/*! \brief A message of a message list download. The message is read from its file
+ *  if the file name is known, otherwise it is fetched from the data server. */
+
+struct StreamMessage
+{
+  T::FileId         fileId = 0;                 //!< File of the message.
+  T::MessageIndex   messageIndex = 0;           //!< Message index in the file.
+  std::string       fileName;                   //!< Local file (empty = fetched from the data server).
+  std::size_t       position = 0;               //!< File position of the message.
+  std::size_t       size = 0;                   //!< Message size in bytes.
+  std::string       trailer;                    //!< Missing GRIB end section.
+};
+
+typedef std::vector<StreamMessage> StreamMessage_vec;
+
+
+
+// ====================================================================================
+/*! \brief Streams a list of GRIB messages back to back to the HTTP response.
+ *
+ *  The local messages are read from their files in fixed size chunks.  The other
+ *  messages are fetched from the data server ahead of the output, at most the given
+ *  number of messages at a time, and sent from the fetched buffers in the same fixed
+ *  size chunks, so the memory used by the download depends on the number of parallel
+ *  fetches instead of the size of the result.
+ *
+ *  The fetches run in a shared pool of fetch threads that the plugin joins when it is
+ *  shut down. A fetch shares only the message, the data server and a cancellation
+ *  flag with the streamer, so the streamer can be destroyed (for example, when the
+ *  client disconnects) without waiting for it. A fetch that is dropped by the pool
+ *  shutdown breaks its promise, so the output ends with an error instead of waiting
+ *  for the message forever. */
+// ====================================================================================
+
+class MessageListStreamer : public Spine::HTTP::ContentStreamer
+{
+  public:
+                      MessageListStreamer(const std::shared_ptr<DataServer::ServiceInterface>& dataServer,StreamMessage_vec& messages,WorkerPool *fetchPool,uint maxFetches);
+                      MessageListStreamer(const MessageListStreamer&) = delete;
+    virtual           ~MessageListStreamer();
+
+    MessageListStreamer& operator=(const MessageListStreamer&) = delete;
+
+    std::string       getChunk() override;
+
+  protected:
+
+    void              startFetches();
+    static ByteBuffer_sptr fetchMessage(const std::shared_ptr<DataServer::ServiceInterface>& dataServer,const StreamMessage& message,const std::atomic<bool>& cancelled);
+
+    std::shared_ptr<DataServer::ServiceInterface> mDataServer;  //!< Source of the remote messages.
+    StreamMessage_vec mMessages;        //!< The messages in the output order.
+    WorkerPool        *mFetchPool;      //!< Threads running the fetches.
+    std::size_t       mNext;            //!< Next message to be sent.
+    std::size_t       mNextFetch;       //!< Next message to be considered for fetching.
+    uint              mMaxFetches;      //!< Maximum number of messages fetched ahead.
+    std::map<std::size_t,std::future<ByteBuffer_sptr>> mFetches;   //!< Message index → fetch in progress.
+    std::shared_ptr<std::atomic<bool>> mCancelled;  //!< Set when the streamer is destroyed.
+    FileRangeStreamer mFile;            //!< Reader of the current local message.
+    BufferRangeStreamer mBuffer;        //!< Reader of the current fetched message.
+    Spine::HTTP::ContentStreamer *mCurrent;  //!< Reader of the current message (nullptr = none).
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
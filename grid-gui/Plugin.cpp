@@ -5,6 +5,10 @@
 // ======================================================================
 
 #include "Plugin.h"
+#include "FileStreamer.h"
+#include "ImageEncoder.h"
+#include "MessageStreamer.h"
+#include "TextFormat.h"
 
 #include <grid-files/common/GeneralFunctions.h>
 #include <grid-files/common/ImagePaint.h>
@@ -70,6 +74,38 @@ using namespace SmartMet::Spine;
 #define ATTR_TIME_GROUP_TYPE    "tgt"
 #define ATTR_TIME_GROUP         "tg"
 #define ATTR_PROJECTION_LOCK    "pl"
+#define ATTR_IMAGE_WIDTH        "iw"
+#define ATTR_IMAGE_HEIGHT       "ih"
+#define ATTR_AREA               "bb"
+#define ATTR_TILE_Z             "tz"
+#define ATTR_TILE_X             "tx"
+#define ATTR_TILE_Y             "ty"
+#define ATTR_POINTS             "pts"
+#define ATTR_LATLON             "ll"
+#define ATTR_RASTER_FORMAT      "rf"
+#define ATTR_TABLE_X            "tbx"
+#define ATTR_TABLE_Y            "tby"
+#define ATTR_TABLE_COLUMNS      "tbc"
+#define ATTR_TABLE_ROWS         "tbr"
+#define ATTR_TABLE_STEP         "tbs"
+#define ATTR_SUBSET_LEVEL_MIN   "sl1"
+#define ATTR_SUBSET_LEVEL_MAX   "sl2"
+#define ATTR_SUBSET_TIME_MIN    "st1"
+#define ATTR_SUBSET_TIME_MAX    "st2"
+#define ATTR_MESSAGE_OFFSET     "mo"
+#define ATTR_MESSAGE_LENGTH     "ml"
+
+#define IMAGE_TILE_SIZE         256
+#define IMAGE_MAPPING_MIN_SIZE  (4*1024*1024)
+#define IMAGE_LOCK_STALE_MARGIN 60
+#define VALUES_MAX_POINTS       10000
+#define TABLE_DEFAULT_SIZE      100
+#define TABLE_MAX_SIZE          1000
+#define SUBSET_MAX_MESSAGES     10000
+#define SUBSET_MAX_FETCHES      4
+#define SUBSET_FETCH_THREADS    8
+#define MESSAGE_VIEW_LENGTH     16000
+#define MESSAGE_VIEW_MAX_LENGTH 262144
 
 #define ATTR_LAND_SHADING_LIGHT  "lsl"
 #define ATTR_LAND_SHADING_SHADOW "lss"
@@ -113,8 +149,21 @@ Plugin::Plugin(Spine::Reactor *theReactor, const char *theConfig)
     itsImageCache_dir = "/tmp";
     itsImageCache_maxImages = 1000;
     itsImageCache_minImages = 500;
+    itsImageCache_maxSize = 0;
+    itsImageCache_memorySize = 200;
+    itsImageCache_layerMemorySize = 500;
+    itsImageCache_renderTimeout = 30;
+    itsImageCache_maxAge = 7*24*3600;
+    itsImageCache_writeQueueSize = 100;
+    itsRendering_threads = 0;
+    itsRendering_minPixelsPerThread = 250000;
+    itsValueCache_memorySize = 500;
+    itsValueCache_statsCount = 10000;
+    itsValueCache_reprojectionMemorySize = 200;
+    itsContentCache_maxAge = 300;
+    itsContentCache_maxEntries = 1000;
+    itsShutdownRequested = false;
     itsAnimationEnabled = true;
-    itsImageCounter = 0;
     itsProducerFile_modificationTime = 0;
 
     if (theReactor->getRequiredAPIVersion() != SMARTMET_API_VERSION)
@@ -149,6 +198,74 @@ Plugin::Plugin(Spine::Reactor *theReactor, const char *theConfig)
     itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.maxImages",itsImageCache_maxImages);
     itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.minImages",itsImageCache_minImages);
 
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.imageCache.maxSize"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.maxSize",itsImageCache_maxSize);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.imageCache.memorySize"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.memorySize",itsImageCache_memorySize);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.imageCache.layerMemorySize"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.layerMemorySize",itsImageCache_layerMemorySize);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.imageCache.renderTimeout"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.renderTimeout",itsImageCache_renderTimeout);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.imageCache.maxAge"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.maxAge",itsImageCache_maxAge);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.imageCache.writeQueueSize"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.imageCache.writeQueueSize",itsImageCache_writeQueueSize);
+
+    itsImageFileCache.setLimits(static_cast<std::size_t>(itsImageCache_maxSize) * 1024 * 1024,itsImageCache_maxImages,itsImageCache_minImages);
+    itsImageFileCache.setRemoveCallback([this](const std::string& fileName)
+    {
+      // ### A mapping of an evicted file would keep its disk space reserved.
+
+      itsImageMemoryCache.removeMappedFile(fileName);
+    });
+    itsImageMemoryCache.setMaxSize(static_cast<std::size_t>(itsImageCache_memorySize) * 1024 * 1024);
+    itsStaticLayerCache.setMaxSize(static_cast<std::size_t>(itsImageCache_layerMemorySize) * 1024 * 1024);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.rendering.threads"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.rendering.threads",itsRendering_threads);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.rendering.minPixelsPerThread"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.rendering.minPixelsPerThread",itsRendering_minPixelsPerThread);
+
+    if (itsRendering_threads == 0)
+      itsRendering_threads = std::thread::hardware_concurrency();
+
+    if (itsRendering_minPixelsPerThread == 0)
+      itsRendering_minPixelsPerThread = 1;
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.valueCache.memorySize"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.valueCache.memorySize",itsValueCache_memorySize);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.valueCache.statsCount"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.valueCache.statsCount",itsValueCache_statsCount);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.valueCache.reprojectionMemorySize"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.valueCache.reprojectionMemorySize",itsValueCache_reprojectionMemorySize);
+
+    itsGridValueCache.setMaxSize(static_cast<std::size_t>(itsValueCache_memorySize) * 1024 * 1024);
+    itsReprojectionCache.setMaxSize(static_cast<std::size_t>(itsValueCache_reprojectionMemorySize) * 1024 * 1024);
+    itsValueStatsCache.setMaxSize(itsValueCache_statsCount);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.contentCache.maxAge"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.contentCache.maxAge",itsContentCache_maxAge);
+
+    if (itsConfigurationFile.findAttribute("smartmet.plugin.grid-gui.contentCache.maxEntries"))
+      itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.contentCache.maxEntries",itsContentCache_maxEntries);
+
+    itsContentCache.setLimits(itsContentCache_maxAge,itsContentCache_maxEntries);
+
+    itsWorkerPool.init(itsRendering_threads);
+
+    // ### Only the workers run the posted fetches, so the calling thread is not counted.
+
+    itsFetchPool.init(SUBSET_FETCH_THREADS + 1);
+    itsImageWriter.init(&itsImageFileCache,itsImageCache_writeQueueSize);
+
 
     std::vector<std::string> projVec;
     itsConfigurationFile.getAttributeValue("smartmet.plugin.grid-gui.blockedProjections",projVec);
@@ -167,23 +284,6 @@ Plugin::Plugin(Spine::Reactor *theReactor, const char *theConfig)
 
     loadColorFile();
     loadProducerFile();
-
-
-    // Removing files from the image cache.
-
-    std::vector<std::string> filePatterns;
-    std::set<std::string> dirList;
-    std::vector<std::pair<std::string,std::string>> fileList;
-
-    filePatterns.emplace_back(std::string("grid-gui-image_*"));
-
-    getFileList(itsImageCache_dir.c_str(),filePatterns,false,dirList,fileList);
-
-    for (auto it = fileList.begin(); it != fileList.end(); ++it)
-    {
-      std::string fname = itsImageCache_dir + "/" + it->second;
-      remove(fname.c_str());
-    }
   }
   catch (...)
   {
@@ -203,6 +303,21 @@ Plugin::Plugin(Spine::Reactor *theReactor, const char *theConfig)
 
 Plugin::~Plugin()
 {
+  try
+  {
+    itsShutdownRequested = true;
+    if (itsImageCacheThread.joinable())
+      itsImageCacheThread.join();
+
+    itsWorkerPool.shutdown();
+    itsFetchPool.shutdown();
+    itsImageWriter.shutdown();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
 }
 
 
@@ -222,6 +337,10 @@ void Plugin::init()
   {
     itsGridEngine = itsReactor->getEngine<Engine::Grid::Engine>("grid", nullptr);
     itsProducerFile = itsGridEngine->getProducerFileName();
+
+    // The image files rendered before the restart are indexed in the background.
+
+    itsImageCacheThread = std::thread(&Plugin::imageCacheThread,this);
   }
   catch (...)
   {
@@ -247,6 +366,14 @@ void Plugin::shutdown()
   try
   {
     std::cout << "  -- Shutdown requested (grid-plugin)\n";
+
+    itsShutdownRequested = true;
+    if (itsImageCacheThread.joinable())
+      itsImageCacheThread.join();
+
+    itsWorkerPool.shutdown();
+    itsFetchPool.shutdown();
+    itsImageWriter.shutdown();
   }
   catch (...)
   {
@@ -463,37 +590,32 @@ uint Plugin::getColorValue(std::string& colorName)
 
 
 
-/*! \brief GridGui: Scan a parameter-value vector and derive a min/max/step triple for
- *  the implicit colour scaling used by saveMap() when no colour map file is configured. */
+/*! \brief GridGui: Derive a min/max/step triple from the value statistics for the
+ *  implicit colour scaling used when no colour map file is configured. */
 
-void Plugin::computeValueRangeForMap(const T::ParamValue_vec& values,
+void Plugin::computeValueRangeForMap(const ValueStats& stats,
                                      double& minValue,
                                      double& maxValue,
                                      double& step)
 {
-  double total = 0;
-  uint cnt = 0;
-  uint sz = values.size();
+  try
+  {
+    if (stats.count == 0)
+      return;
+
+    minValue = stats.minValue;
+    maxValue = stats.maxValue;
 
-  for (uint t = 0; t < sz; t++)
+    double dd = maxValue - minValue;
+    double ddd = stats.mean - minValue;
+    step = dd / 200;
+    if (maxValue > (minValue + 5*ddd))
+      step = 5*ddd / 200;
+  }
+  catch (...)
   {
-    double val = values[t];
-    if (val != ParamValueMissing)
-    {
-      total = total + val;
-      cnt++;
-      if (val < minValue)
-        minValue = val;
-      if (val > maxValue)
-        maxValue = val;
-    }
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
   }
-  double avg = total / (double)cnt;
-  double dd = maxValue - minValue;
-  double ddd = avg - minValue;
-  step = dd / 200;
-  if (maxValue > (minValue + 5*ddd))
-    step = 5*ddd / 200;
 }
 
 
@@ -501,7 +623,7 @@ void Plugin::computeValueRangeForMap(const T::ParamValue_vec& values,
 
 /*! \brief GridGui: Save map. */
 
-void Plugin::saveMap(const char *imageFile,uint columns,uint rows,T::ParamValue_vec&  values,unsigned char hue,unsigned char saturation,unsigned char blur,uint coordinateLines,uint landBorder,std::string landMask,std::string seaMask,std::string colorMapName,std::string missingStr)
+void Plugin::saveMap(ImageData& mapImage,uint columns,uint rows,const T::ParamValue_vec& values,const ValueStats& valueStats,unsigned char hue,unsigned char saturation,unsigned char blur,uint coordinateLines,uint landBorder,std::string landMask,std::string seaMask,std::string colorMapName,std::string missingStr)
 {
   FUNCTION_TRACE
   try
@@ -534,7 +656,7 @@ void Plugin::saveMap(const char *imageFile,uint columns,uint rows,T::ParamValue_
     double step = 0;
 
     if (!colorMapFile)
-      computeValueRangeForMap(values, minValue, maxValue, step);
+      computeValueRangeForMap(valueStats, minValue, maxValue, step);
 
     int width = columns;
     int height = rows;
@@ -551,7 +673,6 @@ void Plugin::saveMap(const char *imageFile,uint columns,uint rows,T::ParamValue_
 
     uint *image = new uint[width*height];
 
-    uint c = 0;
     bool yLand[width];
     for (int x=0; x<width; x++)
       yLand[x] = false;
@@ -564,121 +685,127 @@ void Plugin::saveMap(const char *imageFile,uint columns,uint rows,T::ParamValue_
 
     AutoReadLock lock(modificationLock);
 
-    for (int y=0; y<height; y++)
-    {
-      bool prevLand = false;
-      for (int x=0; x<width; x++)
-      {
-        T::ParamValue val = values[c];
-        if (val == 0.0   &&  zeroIsMissingValue)
-          val = ParamValueMissing;
+    // ### The pixel colors and the land flags do not depend on each other, so they
+    // ### are computed in parallel row bands. The land borders and the coordinate lines
+    // ### depend on the neighbouring pixels and they are painted sequentially below.
 
-        uint col = 0xFFFFFFFF;
-        if (colorMapFile)
-        {
-          col = colorMapFile->getSmoothColor(val);
-        }
-        else
-        {
-          uint vv = ((val - minValue) / step);
-          uint v = 200 - vv;
-          if (vv > 200)
-            v = 0;
-
-          v = v / blur;
-          v = v * blur;
-          v = v + 55;
-          col = 0xFF000000 + hsv_to_rgb(hue,saturation,C_UCHAR(v));
-        }
+    std::vector<uchar> landFlags(sz);
 
-        double xc = xd*(x-(dWidth/2));
-        double yc = yd*((dHeight-y-1)-(dHeight/2));
+    uint missingColor = 0;
+    if (colorMapFile)
+      missingColor = colorMapFile->getSmoothColor(ParamValueMissing);
 
-        bool land = Map::topography.isLand(xc,yc);
+    processRowBands(height,sz,[&](int y1,int y2)
+    {
+      std::vector<uint> rowColors;
+      if (colorMapFile)
+        rowColors.resize(width);
 
-        if (land  &&  (val == ParamValueMissing || ((col & 0xFF000000) == 0)))
-          col = landColor;
+      for (int y=y1; y<y2; y++)
+      {
+        uint c = y*width;
 
-        if (!land &&  (val == ParamValueMissing || ((col & 0xFF000000) == 0)))
-          col = seaColor;
+        // The colors of the whole row are mapped in one call.
+        if (colorMapFile)
+          colorMapFile->getSmoothColors(&values[c],width,rowColors.data());
 
-        if (landBorder & 0xFF000000)
+        for (int x=0; x<width; x++)
         {
-          if (land & (!prevLand || !yLand[x]))
+          T::ParamValue val = values[c];
+          bool zeroMissing = false;
+          if (val == 0.0   &&  zeroIsMissingValue)
           {
-            col = landBorder;
-            lbcol = col;
+            val = ParamValueMissing;
+            zeroMissing = true;
           }
 
-          if (!land)
+          uint col = 0xFFFFFFFF;
+          if (colorMapFile)
           {
-            if (prevLand  &&  x > 0  &&  image[y*width + x-1] != coordinateLines)
-              image[y*width + x-1] = lbcol;
-
-            if (yLand[x] &&  y > 0  && image[(y-1)*width + x] != coordinateLines)
-              image[(y-1)*width + x] = lbcol;
+            col = zeroMissing ? missingColor : rowColors[x];
+          }
+          else
+          {
+            uint vv = ((val - minValue) / step);
+            uint v = 200 - vv;
+            if (vv > 200)
+              v = 0;
+
+            v = v / blur;
+            v = v * blur;
+            v = v + 55;
+            col = 0xFF000000 + hsv_to_rgb(hue,saturation,C_UCHAR(v));
           }
-        }
-
-        if ((coordinateLines & 0xFF000000) && ((x % xx) == 0  ||  (y % yy) == 0))
-        {
-          col = coordinateLines;
-        }
 
-        yLand[x] = land;
-        prevLand = land;
-        image[y*width + x] = col;
-        c++;
-      }
-    }
+          double xc = xd*(x-(dWidth/2));
+          double yc = yd*((dHeight-y-1)-(dHeight/2));
 
-    //jpeg_save(imageFile,image,height,width,100);
+          bool land = Map::topography.isLand(xc,yc);
 
-    png_save(imageFile,image,width,height,1);
+          if (land  &&  (val == ParamValueMissing || ((col & 0xFF000000) == 0)))
+            col = landColor;
 
-    delete[] image;
+          if (!land &&  (val == ParamValueMissing || ((col & 0xFF000000) == 0)))
+            col = seaColor;
 
-    checkImageCache();
-  }
-  catch (...)
-  {
-    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
-    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
-    throw exception;
-  }
-}
+          landFlags[c] = land;
+          image[c] = col;
+          c++;
+        }
+      }
+    });
 
+    if ((landBorder & 0xFF000000) || (coordinateLines & 0xFF000000))
+    {
+      uint c = 0;
+      for (int y=0; y<height; y++)
+      {
+        bool prevLand = false;
+        for (int x=0; x<width; x++)
+        {
+          uint col = image[c];
+          bool land = landFlags[c];
 
+          if (landBorder & 0xFF000000)
+          {
+            if (land & (!prevLand || !yLand[x]))
+            {
+              col = landBorder;
+              lbcol = col;
+            }
 
+            if (!land)
+            {
+              if (prevLand  &&  x > 0  &&  image[y*width + x-1] != coordinateLines)
+                image[y*width + x-1] = lbcol;
 
+              if (yLand[x] &&  y > 0  && image[(y-1)*width + x] != coordinateLines)
+                image[(y-1)*width + x] = lbcol;
+            }
+          }
 
-/*! \brief GridGui: Check image cache. */
+          if ((coordinateLines & 0xFF000000) && ((x % xx) == 0  ||  (y % yy) == 0))
+          {
+            col = coordinateLines;
+          }
 
-void Plugin::checkImageCache()
-{
-  FUNCTION_TRACE
-  try
-  {
-    AutoThreadLock lock(&itsThreadLock);
+          yLand[x] = land;
+          prevLand = land;
+          image[c] = col;
+          c++;
+        }
+      }
+    }
 
-    uint cnt = itsImages.size();
+    //jpeg_save(imageFile,image,height,width,100);
 
-    if (cnt > itsImageCache_maxImages)
-    {
-      std::map<std::string,std::string> tmpImages;
+    mapImage.content.reset(new std::vector<char>());
+    mapImage.mappedFile.reset();
+    mapImage.contentType = "image/png";
+    png_encode(image,width,height,1,*mapImage.content);
 
-      for (auto it = itsImages.begin(); it != itsImages.end(); ++it)
-      {
-        tmpImages.insert(std::pair<std::string,std::string>(it->second,it->first));
-      }
+    delete[] image;
 
-      for (auto it = tmpImages.begin(); it != tmpImages.end()  &&  cnt > itsImageCache_minImages; ++it)
-      {
-        remove(it->first.c_str());
-        itsImages.erase(it->second);
-        cnt--;
-      }
-    }
   }
   catch (...)
   {
@@ -699,8 +826,6 @@ void Plugin::saveImage(ImagePaintParameters& params)
   FUNCTION_TRACE
   try
   {
-    auto dataServer = itsGridEngine->getDataServer_sptr();
-
     T::GeometryId geomId = params.geometryId;
     if (params.projectionId > 0  &&  params.projectionId != params.geometryId)
       geomId = params.projectionId;
@@ -729,10 +854,23 @@ void Plugin::saveImage(ImagePaintParameters& params)
       }
     }
 
+    // ### The HSV colors are scaled by the value range of the whole message.
+
+    bool hsvColors = false;
+    if (params.stream_step == 0)
+    {
+      if (params.paint_colorMapName.empty() ||  strcasecmp(params.paint_colorMapName.c_str(),"None") == 0)
+        hsvColors = true;
+      else
+        hsvColors = (getColorMapFile(params.paint_colorMapName) == nullptr);
+    }
+
+    std::string valueKey = getMessageKey(params.fileId,params.messageIndex) + ":";
+
     if (geomId == params.geometryId)
     {
-      T::GridData gridData;
-      int result = dataServer->getGridData(0,params.fileId,params.messageIndex,gridData);
+      GridValues_sptr grid;
+      int result = getGridValues(params.fileId,params.messageIndex,0,grid);
       if (result != 0)
       {
         Fmi::Exception exception(BCP,"Data fetching failed!");
@@ -740,7 +878,10 @@ void Plugin::saveImage(ImagePaintParameters& params)
         throw exception;
       }
 
-      saveImage(params,gridData.mColumns,gridData.mRows,gridData.mValues,*coordinates,lineCoordinates);
+      if (hsvColors)
+        params.valueStats = getValueStats(valueKey + "0",grid->values);
+
+      saveGridImage(params,grid->columns,grid->rows,grid->values,*coordinates,lineCoordinates);
       //saveImage(imageFile,gridData.mColumns,gridData.mRows,gridData.mValues,*coordinates,*lineCoordinates,hue,saturation,blur,coordinateLines,landBorder,landMask,seaMask,colorMapName,missingStr,geometryId,pstep,minLength,maxLength,lightBackground,animation);
     }
     else
@@ -750,21 +891,17 @@ void Plugin::saveImage(ImagePaintParameters& params)
       uint rows = 0;
       if (Identification::gridDef.getGridDimensionsByGeometryId(geomId,cols,rows))
       {
-        T::ParamValue_vec values;
-
-        short interpolationMethod = T::AreaInterpolationMethod::Linear;
-
-        T::AttributeList attributeList;
-        attributeList.addAttribute("grid.geometryId",std::to_string(geomId));
-        attributeList.addAttribute("grid.areaInterpolationMethod",std::to_string(interpolationMethod));
         if (params.fileId > 0)
         {
-          double_vec modificationParameters;
-          int result = dataServer->getGridValueVectorByGeometry(0,params.fileId,params.messageIndex,attributeList,0,modificationParameters,values);
+          GridValues_sptr grid;
+          int result = getGridValues(params.fileId,params.messageIndex,geomId,grid);
           if (result != 0)
             throw Fmi::Exception(BCP,"Data fetching failed!");
 
-          saveImage(params,cols,rows,values,*coordinates,lineCoordinates);
+          if (hsvColors)
+            params.valueStats = getValueStats(valueKey + std::to_string(geomId),grid->values);
+
+          saveGridImage(params,cols,rows,grid->values,*coordinates,lineCoordinates);
           //saveImage(imageFile,cols,rows,values,*coordinates,*lineCoordinates,hue,saturation,blur,coordinateLines,landBorder,landMask,seaMask,colorMapName,missingStr,geomId,pstep,minLength,maxLength,lightBackground,animation);
         }
       }
@@ -781,548 +918,2479 @@ void Plugin::saveImage(ImagePaintParameters& params)
 
 
 
-/*! \brief GridGui: Save image. */
+/*! \brief GridGui: Get the cache key of a message. The file ids are not stable: a
+ *  content source that is reloaded after a restart numbers its files again, and the
+ *  nodes sharing the image cache directory can have their own content servers. So
+ *  the key also contains the identity of the message: its file (server, name and
+ *  modification time) and its position in the file. */
 
-void Plugin::saveImage(ImagePaintParameters& params,
-    int width,
-    int height,
-    T::ParamValue_vec& values,
-    T::Coordinate_vec& coordinates,
-    T::Coordinate_vec *lineCoordinates)
+std::string Plugin::getMessageKey(T::FileId fileId,T::MessageIndex messageIndex)
 {
   FUNCTION_TRACE
   try
   {
-    T::ColorMapFile *colorMapFile = nullptr;
+    std::string key = std::to_string(fileId) + ":" + std::to_string(messageIndex);
 
-    if (!params.paint_colorMapName.empty() &&  strcasecmp(params.paint_colorMapName.c_str(),"None") != 0)
-      colorMapFile = getColorMapFile(params.paint_colorMapName);
+    auto contentServer = itsGridEngine->getContentServer_sptr();
 
-    uint size = width*height;
-    std::size_t sz = values.size();
+    T::FileInfo fileInfo;
+    T::ContentInfo contentInfo;
+    if (fileId == 0  ||  contentServer->getFileInfoById(0,fileId,fileInfo) != 0  ||  contentServer->getContentInfo(0,fileId,messageIndex,contentInfo) != 0)
+      return key;
 
-    if (size == 0 || size > 100000000)
-      return;
+    std::string identity = fileInfo.mServer + ":" + fileInfo.mName + ":" + std::to_string(fileInfo.mModificationTime) + ":" + std::to_string(contentInfo.mFilePosition);
+    return key + ":" + std::to_string(Fmi::hash(identity));
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-    if (sz < size)
-    {
-      printf("ERROR: There are not enough values (= %lu) for the grid (%u x %u)!\n",sz,width,height);
-      return;
-    }
 
-    bool rotate = true;
-    if (coordinates.size() > C_UINT(10*width)  &&  coordinates[0].y() < coordinates[10*width].y())
-      rotate = true;
-    else
-      rotate = false;
 
 
-    uint *finalImage = new uint[size];
-    uint *valImage = nullptr;
-    uint *landShadingImage = nullptr;
-    uint *seaShadingImage = nullptr;
-    uint *landImage = nullptr;
-    uint *landBorderImage = nullptr;
-    uint *seaImage = nullptr;
-
-    if (size == coordinates.size() && (params.seaShading_light || params.seaShading_shadow))
-    {
-      std::vector<float> seaShadings;
-      seaShadingImage = new uint[size];
-      seaImage = new uint[size];
-      uint c = 0;
-      for (int y=0; y<height; y++)
-      {
-        int yy = y;
-        if (rotate)
-          yy = height-y-1;
 
-        for (int x=0; x<width; x++)
-        {
-          uint pixpos = yy*width + x;
-          seaShadingImage[pixpos] = 0x000000;
-          seaImage[pixpos] = 0x00000000;
+/*! \brief GridGui: Get the values of a message in the given geometry (0 = the
+ *  original geometry of the message). The values are taken from the grid value
+ *  cache if possible. Returns the result code of the data server. */
 
-          double lon = coordinates[c].x();
-          double lat = coordinates[c].y();
-          bool land = Map::topography.isLand(lon,lat);
+int Plugin::getGridValues(T::FileId fileId,T::MessageIndex messageIndex,T::GeometryId geometryId,GridValues_sptr& values)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::string key = getMessageKey(fileId,messageIndex) + ":" + std::to_string(geometryId);
 
+    return getGridValues(key,[&](GridValues& grid)
+    {
+      auto dataServer = itsGridEngine->getDataServer_sptr();
 
-          if (!land)
-          {
-            if (params.seaColor_position)
-              seaImage[pixpos] = params.seaColor;
+      if (geometryId == 0)
+      {
+        T::GridData gridData;
+        int result = dataServer->getGridData(0,fileId,messageIndex,gridData);
+        if (result != 0)
+          return result;
+
+        grid.columns = gridData.mColumns;
+        grid.rows = gridData.mRows;
+        grid.geometryId = gridData.mGeometryId;
+        grid.values.swap(gridData.mValues);
+        return 0;
+      }
 
-            if (params.seaShading_position)
-            {
-              double m = Map::topography.getSeaShading(lon,lat);
-              if (m < 0)
-              {
-                uint pp = (uint)(-(double)params.seaShading_shadow*m);
-                if (pp > 255)
-                  pp = 255;
+      if (!Identification::gridDef.getGridDimensionsByGeometryId(geometryId,grid.columns,grid.rows))
+      {
+        Fmi::Exception exception(BCP,"Unknown geometry!");
+        exception.addParameter("GeometryId",std::to_string(geometryId));
+        throw exception;
+      }
 
-                seaShadingImage[pixpos] = pp << 24;
-              }
-              else
-              {
-                uint pp = (uint)((double)params.seaShading_light*m);
-                if (pp > 255)
-                  pp = 255;
+      grid.geometryId = geometryId;
 
-                seaShadingImage[pixpos] = (pp << 24) + 0xFFFFFF;
-              }
-            }
-          }
-          c++;
+      // ### The values are interpolated from the original grid with a cached reprojection
+      // ### table, so the original grid is fetched only once for all the projections. The
+      // ### data server is used if the table cannot be created.
+
+      GridValues_sptr source;
+      if (getGridValues(fileId,messageIndex,0,source) == 0  &&  source->geometryId != 0)
+      {
+        ReprojectionTable_sptr table = getReprojectionTable(source->geometryId,geometryId);
+        if (table  &&  table->columns == grid.columns  &&  table->rows == grid.rows  &&  source->values.size() >= static_cast<std::size_t>(table->sourceColumns) * table->sourceRows)
+        {
+          grid.values.resize(static_cast<std::size_t>(grid.columns) * grid.rows);
+          processRowBands(grid.rows,grid.values.size(),[&](int y1,int y2)
+          {
+            reproject(*table,source->values,static_cast<std::size_t>(y1) * grid.columns,static_cast<std::size_t>(y2) * grid.columns,grid.values.data());
+          });
+          return 0;
         }
       }
-    }
 
+      short interpolationMethod = T::AreaInterpolationMethod::Linear;
 
-    if (size == coordinates.size() && (params.landShading_light || params.landShading_shadow || (params.landBorder_color & 0xFF000000)))
-    {
-      // Counting land topography.
+      T::AttributeList attributeList;
+      attributeList.addAttribute("grid.geometryId",std::to_string(geometryId));
+      attributeList.addAttribute("grid.areaInterpolationMethod",std::to_string(interpolationMethod));
 
-      bool yLand[width];
-      for (int x=0; x<width; x++)
-        yLand[x] = false;
+      double_vec modificationParameters;
+      return dataServer->getGridValueVectorByGeometry(0,fileId,messageIndex,attributeList,0,modificationParameters,grid.values);
+    },values);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("FileId",std::to_string(fileId));
+    exception.addParameter("MessageIndex",std::to_string(messageIndex));
+    throw exception;
+  }
+}
 
-      landShadingImage = new uint[size];
-      landImage = new uint[size];
-      landBorderImage = new uint[size];
 
-      uint c = 0;
-      for (int y=0; y<height; y++)
-      {
-        bool prevLand = false;
-        int yy = y;
-        if (rotate)
-          yy = height-y-1;
 
-        for (int x=0; x<width; x++)
-        {
-          uint pixpos = yy*width + x;
-          landShadingImage[pixpos] = 0x000000;
-          landImage[pixpos] = 0x00000000;
-          landBorderImage[pixpos] = 0x00000000;
 
-          double lon = coordinates[c].x();
-          double lat = coordinates[c].y();
 
-          bool land = Map::topography.isLand(lon,lat);
-          if (land)
-          {
-            if (params.landColor_position)
-              landImage[pixpos] = params.landColor;
+/*! \brief GridGui: Get the linear reprojection table from the source geometry to the
+ *  target geometry. The table is taken from the reprojection cache if possible.
+ *  Returns nullptr if the table cannot be created. */
 
-            if (!prevLand || !yLand[x])
-              landBorderImage[pixpos] = params.landBorder_color;
-;
-            if (params.landShading_position)
-            {
-              double m = (double)Map::topography.getLandShading(lon,lat);
-              if (m < 0)
-              {
-                uint pp = (uint)(-(double)params.landShading_shadow*m);
-                if (pp > 255)
-                  pp = 255;
+ReprojectionTable_sptr Plugin::getReprojectionTable(T::GeometryId sourceGeometryId,T::GeometryId targetGeometryId)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::string key = std::to_string(sourceGeometryId) + ":" + std::to_string(targetGeometryId) + ":" + std::to_string(T::AreaInterpolationMethod::Linear);
 
-                landShadingImage[pixpos] = pp << 24;
-              }
-              else
-              {
-                uint pp = (uint)((double)params.landShading_light*m);
-                if (pp > 255)
-                  pp = 255;
+    ReprojectionTable_sptr table;
+    if (itsReprojectionCache.get(key,table))
+      return table;
 
-                landShadingImage[pixpos] = (pp << 24) + 0xFFFFFF;
-              }
-            }
-          }
-          else
-          {
-            if (prevLand  &&  x > 0)
-            {
-              int ppos = yy*width + (x-1);
-              landBorderImage[ppos] = params.landBorder_color;
-            }
+    std::shared_future<ReprojectionTable_sptr> future;
+    if (!itsReprojectionFlights.start(key,future))
+    {
+      // ### Another thread is computing the same table. If it takes too long, we use
+      // ### the data server instead.
 
-            if (yLand[x] &&  yy > 0)
-            {
-              int ppos = (yy-1)*width + x;
-              landBorderImage[ppos] = params.landBorder_color;
-            }
-          }
-          yLand[x] = land;
-          prevLand = land;
-          c++;
-        }
+      if (SingleFlight<ReprojectionTable_sptr>::wait(future,itsImageCache_renderTimeout,table))
+        return table;
+
+      return nullptr;
+    }
+
+    try
+    {
+      std::shared_ptr<ReprojectionTable> newTable(new ReprojectionTable());
+      if (createReprojectionTable(sourceGeometryId,targetGeometryId,*newTable))
+      {
+        table = newTable;
+        itsReprojectionCache.add(key,table);
       }
+      itsReprojectionFlights.finish(key,table);
+    }
+    catch (...)
+    {
+      itsReprojectionFlights.abort(key,std::current_exception());
+      throw;
     }
 
-    uint alpha = (uint)params.paint_alpha << 24;
+    return table;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-    if (!colorMapFile && params.stream_step == 0)
+
+
+
+
+/*! \brief GridGui: Get grid values by the cache key. Only one thread loads the values
+ *  of a key; the other threads wait for its result. The values are not cached if the
+ *  load function returns an error code. */
+
+int Plugin::getGridValues(const std::string& key,const std::function<int(GridValues&)>& load,GridValues_sptr& values)
+{
+  FUNCTION_TRACE
+  try
+  {
+    if (itsGridValueCache.get(key,values))
+      return 0;
+
+    std::shared_future<GridValues_sptr> future;
+    if (!itsGridValueFlights.start(key,future))
     {
-      // We do not have colormap - using HSV instead
+      // ### Another thread is loading the same grid. If it takes too long or if it
+      // ### fails, we load the grid by ourselves.
 
-      valImage = new uint[size];
+      if (SingleFlight<GridValues_sptr>::wait(future,itsImageCache_renderTimeout,values)  &&  values)
+        return 0;
 
-      double maxValue = -1000000000;
-      double minValue = 1000000000;
-      double total = 0;
-      uint cnt = 0;
+      std::shared_ptr<GridValues> grid(new GridValues());
+      int result = load(*grid);
+      if (result == 0)
+        values = grid;
+      return result;
+    }
 
-      for (uint t=0; t<size; t++)
+    try
+    {
+      std::shared_ptr<GridValues> grid(new GridValues());
+      int result = load(*grid);
+      if (result == 0)
       {
-        double val = values[t];
-        if (val != ParamValueMissing)
-        {
-          total = total + val;
-          cnt++;
-          if (val < minValue)
-            minValue = val;
-
-          if (val > maxValue)
-            maxValue = val;
-        }
+        values = grid;
+        itsGridValueCache.add(key,values);
       }
+      itsGridValueFlights.finish(key,values);
+      return result;
+    }
+    catch (...)
+    {
+      itsGridValueFlights.abort(key,std::current_exception());
+      throw;
+    }
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Key",key);
+    throw exception;
+  }
+}
 
-      double avg = total / (double)cnt;
-      double dd = maxValue - minValue;
-      double ddd = avg-minValue;
-      double step = dd / 200;
-      if (maxValue > (minValue + 5*ddd))
-        step = 5*ddd / 200;
 
-      if (params.paint_blur == 0)
-        params.paint_blur = 1;
 
 
-      uint c = 0;
-      for (int y=0; y<height; y++)
-      {
-        int yy = y;
-        if (rotate)
-          yy = height-y-1;
 
-        for (int x=0; x<width; x++)
-        {
-          uint pixpos = yy*width + x;
-          valImage[pixpos] = 0x00000000;
+/*! \brief GridGui: Get the value statistics of a message. The statistics are taken
+ *  from the statistics cache if possible. The key identifies the message and the
+ *  geometry of the given values. */
 
-          T::ParamValue val = values[c];
+ValueStats_sptr Plugin::getValueStats(const std::string& key,const T::ParamValue_vec& values)
+{
+  FUNCTION_TRACE
+  try
+  {
+    ValueStats_sptr stats;
+    if (itsValueStatsCache.get(key,stats))
+      return stats;
 
-          if (val == 0.0   &&  params.zeroIsMissing)
-            val = ParamValueMissing;
+    std::shared_ptr<ValueStats> newStats(new ValueStats());
+    computeValueStats(values.data(),values.size(),*newStats);
+
+    stats = newStats;
+    itsValueStatsCache.add(key,stats);
+    return stats;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Key",key);
+    throw exception;
+  }
+}
 
-          uint vv = ((val - minValue) / step);
-          uint v = 200 - vv;
-          if (vv > 200)
-            v = 0;
 
-          v = v / params.paint_blur;
-          v = v * params.paint_blur;
-          v = v + 55;
 
-          if (val != ParamValueMissing)
-            valImage[pixpos] = alpha + hsv_to_rgb(params.paint_hue,params.paint_saturation,C_UCHAR(v));
 
-          c++;
-        }
-      }
+
+/*! \brief GridGui: Get the static (land and sea) layers of an image. The layers are
+ *  taken from the layer cache if possible. Returns nullptr if no static layers are
+ *  painted. */
+
+StaticLayers_sptr Plugin::getStaticLayers(ImagePaintParameters& params,int width,int height,T::Coordinate_vec& coordinates,bool rotate)
+{
+  FUNCTION_TRACE
+  try
+  {
+    bool seaLayers = (params.seaShading_light || params.seaShading_shadow);
+    bool landLayers = (params.landShading_light || params.landShading_shadow || (params.landBorder_color & 0xFF000000));
+
+    if (!seaLayers && !landLayers)
+      return nullptr;
+
+    std::string key = "Layers:" + std::to_string(params.geometryId) + ":" + std::to_string(width) + ":" + std::to_string(height) + ":" + std::to_string(rotate);
+
+    // ### A tile or a crop area covers only a part of the grid.
+    if (params.tile_zoom >= 0)
+      key += ":T:" + std::to_string(params.tile_zoom) + ":" + std::to_string(params.tile_x) + ":" + std::to_string(params.tile_y);
+
+    if (!params.image_area.empty())
+      key += ":A:" + params.image_area;
+
+    if (seaLayers)
+    {
+      key += ":S:" + std::to_string(params.seaColor) + ":" + std::to_string(params.seaColor_position) + ":" +
+        std::to_string(params.seaShading_light) + ":" + std::to_string(params.seaShading_shadow) + ":" + std::to_string(params.seaShading_position);
     }
 
+    if (landLayers)
+    {
+      key += ":L:" + std::to_string(params.landColor) + ":" + std::to_string(params.landColor_position) + ":" + std::to_string(params.landBorder_color) + ":" +
+        std::to_string(params.landShading_light) + ":" + std::to_string(params.landShading_shadow) + ":" + std::to_string(params.landShading_position);
+    }
 
-    T::ByteData_vec contours;
+    StaticLayers_sptr layers;
+    if (itsStaticLayerCache.get(key,layers))
+      return layers;
 
-    if (colorMapFile && params.stream_step == 0)
+    std::shared_future<StaticLayers_sptr> future;
+    if (!itsStaticLayerFlights.start(key,future))
     {
-      valImage = new uint[size];
+      // ### Another thread is computing the same layers. If it takes too long, we compute
+      // ### them by ourselves.
 
-      double amp = (double)params.paint_alpha/255.0;
+      if (SingleFlight<StaticLayers_sptr>::wait(future,itsImageCache_renderTimeout,layers))
+        return layers;
 
+      return createStaticLayers(params,width,height,coordinates,rotate);
+    }
 
-      uint c = 0;
-      ModificationLock *modificationLock = colorMapFile->getModificationLock();
-      AutoReadLock lock(modificationLock);
+    try
+    {
+      layers = createStaticLayers(params,width,height,coordinates,rotate);
+      itsStaticLayerCache.add(key,layers);
+      itsStaticLayerFlights.finish(key,layers);
+    }
+    catch (...)
+    {
+      itsStaticLayerFlights.abort(key,std::current_exception());
+      throw;
+    }
 
-      for (int y=0; y<height; y++)
+    return layers;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Split the rows 0..height-1 into bands and call the function for
+ *  each band (y1 <= y < y2) in the worker pool. Small images are processed in the
+ *  calling thread, because splitting them costs more than it saves. */
+
+void Plugin::processRowBands(int height,std::size_t pixels,const std::function<void(int,int)>& func)
+{
+  FUNCTION_TRACE
+  try
+  {
+    if (height <= 0)
+      return;
+
+    std::size_t bands = itsWorkerPool.getThreadCount();
+
+    std::size_t maxBands = pixels / itsRendering_minPixelsPerThread;
+    if (bands > maxBands)
+      bands = maxBands;
+
+    if (bands > C_UINT(height))
+      bands = height;
+
+    if (bands <= 1)
+    {
+      func(0,height);
+      return;
+    }
+
+    itsWorkerPool.run(bands,[&](uint band)
+    {
+      int y1 = C_INT((std::size_t)height * band / bands);
+      int y2 = C_INT((std::size_t)height * (band+1) / bands);
+      func(y1,y2);
+    });
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Create the static (land and sea) layers of an image. */
+
+StaticLayers_sptr Plugin::createStaticLayers(ImagePaintParameters& params,int width,int height,T::Coordinate_vec& coordinates,bool rotate)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::shared_ptr<StaticLayers> layers(new StaticLayers());
+    uint size = width*height;
+
+    bool seaLayers = (params.seaShading_light || params.seaShading_shadow);
+    bool landLayers = (params.landShading_light || params.landShading_shadow || (params.landBorder_color & 0xFF000000));
+
+    if (seaLayers)
+    {
+      layers->seaShadingImage.resize(size);
+      layers->seaImage.resize(size);
+    }
+
+    std::vector<uchar> landMask;
+    if (landLayers)
+    {
+      layers->landShadingImage.resize(size);
+      layers->landImage.resize(size);
+      layers->landBorderImage.resize(size);
+      landMask.resize(size);
+    }
+
+    uint *seaShadingImage = layers->seaShadingImage.data();
+    uint *seaImage = layers->seaImage.data();
+    uint *landShadingImage = layers->landShadingImage.data();
+    uint *landImage = layers->landImage.data();
+    uint *landBorderImage = layers->landBorderImage.data();
+
+    // ### The topography lookups are independent per pixel, so they are done in
+    // ### parallel row bands. The land mask is stored in the coordinate order.
+
+    processRowBands(height,size,[&](int y1,int y2)
+    {
+      for (int y=y1; y<y2; y++)
       {
         int yy = y;
         if (rotate)
           yy = height-y-1;
 
+        uint c = y*width;
         for (int x=0; x<width; x++)
         {
           uint pixpos = yy*width + x;
-          valImage[pixpos] = 0x00000000;
 
-          T::ParamValue val = values[c];
-          if (val == 0.0   &&  params.zeroIsMissing)
-            val = ParamValueMissing;
+          double lon = coordinates[c].x();
+          double lat = coordinates[c].y();
+          bool land = Map::topography.isLand(lon,lat);
 
-          uint col = colorMapFile->getSmoothColor(val);
-          if (params.paint_alpha != 255)
+          if (seaLayers  &&  !land)
           {
-            uint current_alpha = col & 0xFF000000;
-            uint current_color = col & 0x00FFFFFF;
-            if (current_alpha == 0xFF000000)
+            if (params.seaColor_position)
+              seaImage[pixpos] = params.seaColor;
+
+            if (params.seaShading_position)
             {
-              col = alpha | current_color;
+              double m = Map::topography.getSeaShading(lon,lat);
+              if (m < 0)
+              {
+                uint pp = (uint)(-(double)params.seaShading_shadow*m);
+                if (pp > 255)
+                  pp = 255;
+
+                seaShadingImage[pixpos] = pp << 24;
+              }
+              else
+              {
+                uint pp = (uint)((double)params.seaShading_light*m);
+                if (pp > 255)
+                  pp = 255;
+
+                seaShadingImage[pixpos] = (pp << 24) + 0xFFFFFF;
+              }
             }
-            else
+          }
+
+          if (landLayers  &&  land)
+          {
+            if (params.landColor_position)
+              landImage[pixpos] = params.landColor;
+
+            if (params.landShading_position)
             {
-              uint new_alpha = ((uint)((double)current_alpha *amp)) & 0xFF000000;
-              col = new_alpha | current_color;
+              double m = (double)Map::topography.getLandShading(lon,lat);
+              if (m < 0)
+              {
+                uint pp = (uint)(-(double)params.landShading_shadow*m);
+                if (pp > 255)
+                  pp = 255;
+
+                landShadingImage[pixpos] = pp << 24;
+              }
+              else
+              {
+                uint pp = (uint)((double)params.landShading_light*m);
+                if (pp > 255)
+                  pp = 255;
+
+                landShadingImage[pixpos] = (pp << 24) + 0xFFFFFF;
+              }
             }
           }
-          valImage[pixpos] = col;
+
+          if (landLayers)
+            landMask[c] = land;
+
           c++;
         }
       }
-    }
+    });
 
-    for (uint t=0; t<size; t++)
+    if (landLayers  &&  (params.landBorder_color & 0xFF000000))
     {
-      uint col = 0x00000000;
-      uint landcol = 0x00000000;
-      uint seacol = 0x00000000;
-      uint lscol = 0x00000000;
-      uint sscol = 0x00000000;
-      uint vcol = 0x00000000;
-      uint lbcol = 0x00000000;
-
-      if (landImage)
-        landcol = landImage[t];
+      // ### The land borders depend on the previous pixel and on the previous row, so
+      // ### they are drawn sequentially from the land mask.
 
-      if (seaImage)
-        seacol = seaImage[t];
+      bool yLand[width];
+      for (int x=0; x<width; x++)
+        yLand[x] = false;
+
+      uint c = 0;
+      for (int y=0; y<height; y++)
+      {
+        bool prevLand = false;
+        int yy = y;
+        if (rotate)
+          yy = height-y-1;
+
+        for (int x=0; x<width; x++)
+        {
+          uint pixpos = yy*width + x;
+          landBorderImage[pixpos] = 0x00000000;
+
+          bool land = landMask[c];
+          if (land)
+          {
+            if (!prevLand || !yLand[x])
+              landBorderImage[pixpos] = params.landBorder_color;
+          }
+          else
+          {
+            if (prevLand  &&  x > 0)
+            {
+              int ppos = yy*width + (x-1);
+              landBorderImage[ppos] = params.landBorder_color;
+            }
+
+            if (yLand[x] &&  yy > 0)
+            {
+              int ppos = (yy-1)*width + x;
+              landBorderImage[ppos] = params.landBorder_color;
+            }
+          }
+          yLand[x] = land;
+          prevLand = land;
+          c++;
+        }
+      }
+    }
+    else
+    {
+      // The border color is transparent, so the layer has no effect.
+      std::vector<uint>().swap(layers->landBorderImage);
+    }
+
+    // ### The layers below the data are composited into a single layer. The layers above
+    // ### the data are merged after the data, so they are kept as they are.
+
+    if ((params.landColor_position == 1 && !layers->landImage.empty()) ||
+        (params.seaColor_position == 1 && !layers->seaImage.empty()) ||
+        (params.landShading_position == 1 && !layers->landShadingImage.empty()) ||
+        (params.seaShading_position == 1 && !layers->seaShadingImage.empty()))
+    {
+      layers->bottomImage.resize(size);
+
+      processRowBands(height,size,[&](int y1,int y2)
+      {
+        for (uint t=y1*width; t<C_UINT(y2*width); t++)
+        {
+          uint col = 0x00000000;
+
+          if (params.landColor_position == 1  &&  !layers->landImage.empty()  &&  (layers->landImage[t] & 0xFF000000))
+            col = layers->landImage[t];
+
+          if (params.seaColor_position == 1  &&  !layers->seaImage.empty()  &&  (layers->seaImage[t] & 0xFF000000))
+            col = layers->seaImage[t];
+
+          if (params.landShading_position == 1  &&  !layers->landShadingImage.empty()  &&  (layers->landShadingImage[t] & 0xFF000000))
+            col = merge_ARGB(layers->landShadingImage[t],col);
+
+          if (params.seaShading_position == 1  &&  !layers->seaShadingImage.empty()  &&  (layers->seaShadingImage[t] & 0xFF000000))
+            col = merge_ARGB(layers->seaShadingImage[t],col);
+
+          layers->bottomImage[t] = col;
+        }
+      });
+    }
+
+    // ### Releasing the layers that are not painted above the data.
+
+    if (params.landColor_position != 2)
+      std::vector<uint>().swap(layers->landImage);
+
+    if (params.seaColor_position != 2)
+      std::vector<uint>().swap(layers->seaImage);
+
+    if (params.landShading_position != 2)
+      std::vector<uint>().swap(layers->landShadingImage);
+
+    if (params.seaShading_position != 2)
+      std::vector<uint>().swap(layers->seaShadingImage);
+
+    return layers;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the integer factor that reduces the grid into the maximum
+ *  image size of the paint parameters. Returns 1 if the grid fits as it is. */
+
+uint Plugin::getDownsampleFactor(ImagePaintParameters& params,int width,int height)
+{
+  FUNCTION_TRACE
+  try
+  {
+    uint factor = 1;
+
+    if (params.image_maxWidth > 0  &&  C_UINT(width) > params.image_maxWidth)
+      factor = (width + params.image_maxWidth - 1) / params.image_maxWidth;
+
+    if (params.image_maxHeight > 0  &&  C_UINT(height) > params.image_maxHeight)
+    {
+      uint f = (height + params.image_maxHeight - 1) / params.image_maxHeight;
+      if (f > factor)
+        factor = f;
+    }
+
+    return factor;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Downsample the area x1 <= x < x2, y1 <= y < y2 of a grid by the
+ *  given factor in one pass. Each new grid cell is the average of the valid values
+ *  of a factor x factor block. Stream line directions cannot be averaged, so they
+ *  are decimated (the center of the block is used), like the coordinates. The
+ *  coordinate line points are moved and scaled into the new grid. */
+
+void Plugin::downsampleGrid(ImagePaintParameters& params,uint factor,int width,int height,int x1,int y1,int x2,int y2,
+    const T::ParamValue_vec& values,
+    T::Coordinate_vec& coordinates,
+    T::Coordinate_vec *lineCoordinates,
+    int& newWidth,
+    int& newHeight,
+    T::ParamValue_vec& newValues,
+    T::Coordinate_vec& newCoordinates,
+    T::Coordinate_vec& newLineCoordinates)
+{
+  FUNCTION_TRACE
+  try
+  {
+    int f = C_INT(factor);
+    newWidth = (x2 - x1 + f - 1) / f;
+    newHeight = (y2 - y1 + f - 1) / f;
+
+    uint newSize = newWidth * newHeight;
+    newValues.resize(newSize);
+
+    bool hasCoordinates = (coordinates.size() == C_UINT(width*height));
+    if (hasCoordinates)
+      newCoordinates.resize(newSize);
+
+    bool decimate = (params.stream_step > 0);
+
+    processRowBands(newHeight,C_UINT((x2-x1)*(y2-y1)),[&](int r1,int r2)
+    {
+      for (int y=r1; y<r2; y++)
+      {
+        int sy1 = y1 + y*f;
+        int sy2 = std::min(sy1 + f,y2);
+        int cy = std::min(sy1 + f/2,y2-1);
+
+        for (int x=0; x<newWidth; x++)
+        {
+          int sx1 = x1 + x*f;
+          int sx2 = std::min(sx1 + f,x2);
+          int cx = std::min(sx1 + f/2,x2-1);
+          uint c = y*newWidth + x;
+
+          if (hasCoordinates)
+            newCoordinates[c] = coordinates[cy*width + cx];
+
+          if (decimate)
+          {
+            newValues[c] = values[cy*width + cx];
+            continue;
+          }
+
+          double total = 0;
+          uint cnt = 0;
+          for (int sy=sy1; sy<sy2; sy++)
+          {
+            const T::ParamValue *v = &values[sy*width + sx1];
+            for (int sx=sx1; sx<sx2; sx++, v++)
+            {
+              if (*v != ParamValueMissing  &&  !(*v == 0.0  &&  params.zeroIsMissing))
+              {
+                total += *v;
+                cnt++;
+              }
+            }
+          }
+
+          if (cnt > 0)
+            newValues[c] = total / cnt;
+          else
+            newValues[c] = ParamValueMissing;
+        }
+      }
+    });
+
+    if (lineCoordinates)
+    {
+      newLineCoordinates.reserve(lineCoordinates->size());
+      for (auto it = lineCoordinates->begin(); it != lineCoordinates->end(); ++it)
+      {
+        if (it->x() >= x1  &&  it->x() < x2  &&  it->y() >= y1  &&  it->y() < y2)
+          newLineCoordinates.emplace_back(T::Coordinate((it->x() - x1) / f,(it->y() - y1) / f));
+      }
+    }
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the zoom level of the full resolution tiles. At zoom level z
+ *  the whole grid is reduced by the factor 2^(maxZoom-z), so the zoom level 0 fits
+ *  into a single tile. */
+
+uint Plugin::getTileMaxZoom(int width,int height)
+{
+  FUNCTION_TRACE
+  try
+  {
+    int size = std::max(width,height);
+    uint zoom = 0;
+    while ((IMAGE_TILE_SIZE << zoom) < size  &&  zoom < 30)
+      zoom++;
+
+    return zoom;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Save the image of a fetched grid. The grid is painted as a whole,
+ *  as a tile of the image pyramid or as a crop area, depending on the paint
+ *  parameters. */
+
+void Plugin::saveGridImage(ImagePaintParameters& params,
+    int width,
+    int height,
+    const T::ParamValue_vec& values,
+    T::Coordinate_vec& coordinates,
+    T::Coordinate_vec *lineCoordinates)
+{
+  FUNCTION_TRACE
+  try
+  {
+    if (params.tile_zoom >= 0)
+      saveTile(params,width,height,values,coordinates,lineCoordinates);
+    else
+    if (!params.image_area.empty())
+      saveArea(params,width,height,values,coordinates,lineCoordinates);
+    else
+      saveImage(params,width,height,values,coordinates,lineCoordinates);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the grid index range (x1 <= x < x2, y1 <= y < y2) of the crop
+ *  area. The area is given either as a lat/lon box "lon1,lat1,lon2,lat2" or as a
+ *  grid index box "grid:x1,y1,x2,y2" (inclusive). A lat/lon box is converted to the
+ *  smallest index range that contains all the grid points inside the box (lon1 > lon2
+ *  means a box across the dateline). Returns HTTP::Status::ok if the area can be
+ *  cropped, HTTP::Status::bad_request if the area is invalid or if it crosses the edge
+ *  of the grid, and HTTP::Status::not_found if it does not contain any grid points. */
+
+int Plugin::getImageArea(ImagePaintParameters& params,int width,int height,T::Coordinate_vec& coordinates,int& x1,int& y1,int& x2,int& y2)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::string area = params.image_area;
+    bool gridArea = false;
+    if (strncasecmp(area.c_str(),"grid:",5) == 0)
+    {
+      gridArea = true;
+      area = area.substr(5);
+    }
+
+    std::vector<std::string> partList;
+    splitString(area,',',partList);
+    if (partList.size() != 4)
+      return HTTP::Status::bad_request;
+
+    double a1 = toDouble(partList[0]);
+    double b1 = toDouble(partList[1]);
+    double a2 = toDouble(partList[2]);
+    double b2 = toDouble(partList[3]);
+
+    if (b1 > b2)
+      std::swap(b1,b2);
+
+    // ### A lat/lon box with lon1 > lon2 crosses the dateline (e.g. 170,50,-170,70).
+    // ### It is handled as the box lon1..lon2+360.
+
+    if (a1 > a2)
+    {
+      if (gridArea)
+        std::swap(a1,a2);
+      else
+        a2 = a2 + 360;
+    }
+
+    if (gridArea)
+    {
+      x1 = std::max(0,C_INT(a1));
+      y1 = std::max(0,C_INT(b1));
+      x2 = std::min(width,C_INT(a2) + 1);
+      y2 = std::min(height,C_INT(b2) + 1);
+      if (x1 >= x2  ||  y1 >= y2)
+        return HTTP::Status::not_found;
+
+      return HTTP::Status::ok;
+    }
+
+    if (coordinates.size() != C_UINT(width*height))
+      return HTTP::Status::not_found;
+
+    // ### The longitudes of the grid can be in the range 0..360 or -180..180.
+
+    x1 = width;
+    y1 = height;
+    x2 = 0;
+    y2 = 0;
+
+    std::vector<uchar> columns(width);
+
+    uint c = 0;
+    for (int y=0; y<height; y++)
+    {
+      for (int x=0; x<width; x++)
+      {
+        const T::Coordinate& coord = coordinates[c];
+        c++;
+
+        double lat = coord.y();
+        if (lat < b1  ||  lat > b2)
+          continue;
+
+        double lon = coord.x();
+        if ((lon >= a1  &&  lon <= a2) || (lon - 360 >= a1  &&  lon - 360 <= a2) || (lon + 360 >= a1  &&  lon + 360 <= a2))
+        {
+          columns[x] = 1;
+          if (x < x1)
+            x1 = x;
+          if (x >= x2)
+            x2 = x + 1;
+          if (y < y1)
+            y1 = y;
+          if (y >= y2)
+            y2 = y + 1;
+        }
+      }
+    }
+
+    if (x1 >= x2  ||  y1 >= y2)
+      return HTTP::Status::not_found;
+
+    // ### The crop area is a single index range, so a box that crosses the edge of the
+    // ### grid (e.g. -10..30 on a 0..360 grid or 170..-170 on a -180..180 grid) cannot be
+    // ### cropped. Otherwise the range would contain the complementary band of the grid.
+
+    for (int x=x1; x<x2; x++)
+    {
+      if (!columns[x])
+        return HTTP::Status::bad_request;
+    }
+
+    return HTTP::Status::ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Check that the crop area can be cut from the grids of the given
+ *  geometry. The image pages check the area before rendering, so that an unusable
+ *  area is rejected with the status of getImageArea() instead of a render failure. */
+
+int Plugin::checkImageArea(const std::string& area,T::GeometryId geometryId)
+{
+  FUNCTION_TRACE
+  try
+  {
+    uint cols = 0;
+    uint rows = 0;
+    if (!Identification::gridDef.getGridDimensionsByGeometryId(geometryId,cols,rows))
+      return HTTP::Status::not_found;
+
+    T::Coordinate_svec coordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(geometryId);
+    if (!coordinates)
+      return HTTP::Status::not_found;
+
+    ImagePaintParameters params;
+    params.image_area = area;
+
+    int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    return getImageArea(params,cols,rows,*coordinates,x1,y1,x2,y2);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Save the crop area of a grid. Only the area is cut from the grid,
+ *  so the land and sea layers, the painting and the encoding depend on the size of
+ *  the area instead of the size of the grid. */
+
+void Plugin::saveArea(ImagePaintParameters& params,
+    int width,
+    int height,
+    const T::ParamValue_vec& values,
+    T::Coordinate_vec& coordinates,
+    T::Coordinate_vec *lineCoordinates)
+{
+  FUNCTION_TRACE
+  try
+  {
+    if (width <= 0 || height <= 0 || values.size() < C_UINT(width*height))
+      return;
+
+    int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+    if (getImageArea(params,width,height,coordinates,x1,y1,x2,y2) != HTTP::Status::ok)
+    {
+      Fmi::Exception exception(BCP, "The area cannot be cropped from the grid!");
+      exception.addParameter("Area",params.image_area);
+      throw exception;
+    }
+
+    if (params.image_rotate < 0)
+      params.image_rotate = (coordinates.size() > C_UINT(10*width)  &&  coordinates[0].y() < coordinates[10*width].y());
+
+    int newWidth = 0;
+    int newHeight = 0;
+    T::ParamValue_vec newValues;
+    T::Coordinate_vec newCoordinates;
+    T::Coordinate_vec newLineCoordinates;
+
+    downsampleGrid(params,1,width,height,x1,y1,x2,y2,values,coordinates,lineCoordinates,newWidth,newHeight,newValues,newCoordinates,newLineCoordinates);
+
+    // ### The area can still be bigger than the requested image size.
+
+    saveImage(params,newWidth,newHeight,newValues,newCoordinates,&newLineCoordinates);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    exception.addParameter("Area",params.image_area);
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Save a tile of the image pyramid. The tile is cut from the grid
+ *  and reduced to the resolution of its zoom level, so only the tile is painted.
+ *  The tile rows are counted from the top of the image, which is the last grid
+ *  row if the image is flipped. */
+
+void Plugin::saveTile(ImagePaintParameters& params,
+    int width,
+    int height,
+    const T::ParamValue_vec& values,
+    T::Coordinate_vec& coordinates,
+    T::Coordinate_vec *lineCoordinates)
+{
+  FUNCTION_TRACE
+  try
+  {
+    if (width <= 0 || height <= 0 || values.size() < C_UINT(width*height))
+      return;
+
+    uint maxZoom = getTileMaxZoom(width,height);
+    if (params.tile_zoom < 0  ||  C_UINT(params.tile_zoom) > maxZoom)
+    {
+      Fmi::Exception exception(BCP, "Invalid tile zoom level!");
+      exception.addParameter("Zoom",std::to_string(params.tile_zoom));
+      exception.addParameter("MaxZoom",std::to_string(maxZoom));
+      throw exception;
+    }
+
+    uint factor = 1 << (maxZoom - params.tile_zoom);
+    std::size_t span = (std::size_t)IMAGE_TILE_SIZE * factor;
+
+    std::size_t x1 = params.tile_x * span;
+    std::size_t iy1 = params.tile_y * span;
+    if (x1 >= C_UINT(width) || iy1 >= C_UINT(height))
+    {
+      Fmi::Exception exception(BCP, "The tile is outside of the grid!");
+      exception.addParameter("Tile",std::to_string(params.tile_zoom) + "/" + std::to_string(params.tile_x) + "/" + std::to_string(params.tile_y));
+      throw exception;
+    }
+
+    std::size_t x2 = std::min(x1 + span,(std::size_t)width);
+    std::size_t iy2 = std::min(iy1 + span,(std::size_t)height);
+
+    bool rotate = true;
+    if (coordinates.size() > C_UINT(10*width)  &&  coordinates[0].y() < coordinates[10*width].y())
+      rotate = true;
+    else
+      rotate = false;
+
+    std::size_t y1 = iy1;
+    std::size_t y2 = iy2;
+    if (rotate)
+    {
+      y1 = height - iy2;
+      y2 = height - iy1;
+    }
+
+    int newWidth = 0;
+    int newHeight = 0;
+    T::ParamValue_vec newValues;
+    T::Coordinate_vec newCoordinates;
+    T::Coordinate_vec newLineCoordinates;
+
+    downsampleGrid(params,factor,width,height,x1,y1,x2,y2,values,coordinates,lineCoordinates,newWidth,newHeight,newValues,newCoordinates,newLineCoordinates);
+
+    params.image_rotate = rotate;
+    params.image_maxWidth = 0;
+    params.image_maxHeight = 0;
+    saveImage(params,newWidth,newHeight,newValues,newCoordinates,&newLineCoordinates);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Save image. */
+
+void Plugin::saveImage(ImagePaintParameters& params,
+    int width,
+    int height,
+    const T::ParamValue_vec& values,
+    T::Coordinate_vec& coordinates,
+    T::Coordinate_vec *lineCoordinates)
+{
+  FUNCTION_TRACE
+  try
+  {
+    // ### Grids that are larger than the requested image are reduced to the image size
+    // ### before painting, so the painting cost depends on the image size only.
+
+    uint factor = getDownsampleFactor(params,width,height);
+    if (factor > 1  &&  values.size() >= C_UINT(width*height))
+    {
+      int newWidth = 0;
+      int newHeight = 0;
+      T::ParamValue_vec newValues;
+      T::Coordinate_vec newCoordinates;
+      T::Coordinate_vec newLineCoordinates;
+
+      // ### The row order is decided by the full coordinates, because the reduced grid
+      // ### might be too small for the test.
+
+      if (params.image_rotate < 0)
+        params.image_rotate = (coordinates.size() > C_UINT(10*width)  &&  coordinates[0].y() < coordinates[10*width].y());
+
+      downsampleGrid(params,factor,width,height,0,0,width,height,values,coordinates,lineCoordinates,newWidth,newHeight,newValues,newCoordinates,newLineCoordinates);
+      saveImage(params,newWidth,newHeight,newValues,newCoordinates,&newLineCoordinates);
+      return;
+    }
+
+    T::ColorMapFile *colorMapFile = nullptr;
+
+    if (!params.paint_colorMapName.empty() &&  strcasecmp(params.paint_colorMapName.c_str(),"None") != 0)
+      colorMapFile = getColorMapFile(params.paint_colorMapName);
+
+    uint size = width*height;
+    std::size_t sz = values.size();
+
+    if (size == 0 || size > 100000000)
+      return;
+
+    if (sz < size)
+    {
+      printf("ERROR: There are not enough values (= %lu) for the grid (%u x %u)!\n",sz,width,height);
+      return;
+    }
+
+    bool rotate = true;
+    if (coordinates.size() > C_UINT(10*width)  &&  coordinates[0].y() < coordinates[10*width].y())
+      rotate = true;
+    else
+      rotate = false;
+
+    if (params.image_rotate >= 0)
+      rotate = (params.image_rotate > 0);
+
+
+    uint *finalImage = new uint[size];
+
+    // ### The land and sea layers do not depend on the data, so they are shared by
+    // ### all the images of the same geometry. The layers below the data have already
+    // ### been composited into a single bottom layer.
+
+    StaticLayers_sptr staticLayers;
+    if (size == coordinates.size())
+      staticLayers = getStaticLayers(params,width,height,coordinates,rotate);
+
+    const uint *bottomImage = nullptr;
+    const uint *topImages[5];
+    uint topCount = 0;
+
+    if (staticLayers)
+    {
+      if (!staticLayers->bottomImage.empty())
+        bottomImage = staticLayers->bottomImage.data();
+
+      // The layers above the data in the painting order.
+
+      if (params.landColor_position == 2  &&  !staticLayers->landImage.empty())
+        topImages[topCount++] = staticLayers->landImage.data();
+
+      if (params.seaColor_position == 2  &&  !staticLayers->seaImage.empty())
+        topImages[topCount++] = staticLayers->seaImage.data();
+
+      if (params.landShading_position == 2  &&  !staticLayers->landShadingImage.empty())
+        topImages[topCount++] = staticLayers->landShadingImage.data();
+
+      if (params.seaShading_position == 2  &&  !staticLayers->seaShadingImage.empty())
+        topImages[topCount++] = staticLayers->seaShadingImage.data();
+
+      if (!staticLayers->landBorderImage.empty())
+        topImages[topCount++] = staticLayers->landBorderImage.data();
+    }
+
+    uint alpha = (uint)params.paint_alpha << 24;
+
+    // We do not have colormap - using HSV instead
+    bool hsvColors = (!colorMapFile && params.stream_step == 0);
+    bool mapColors = (colorMapFile && params.stream_step == 0);
+
+    double minValue = 1000000000;
+    double step = 1;
+
+    if (hsvColors)
+    {
+      // ### The color scale is taken from the whole message if possible, so the
+      // ### tiles and the cropped areas get the same colors as the full image.
+
+      double maxValue = -1000000000;
+      if (params.valueStats)
+      {
+        computeValueRangeForMap(*params.valueStats,minValue,maxValue,step);
+      }
+      else
+      {
+        ValueStats stats;
+        computeValueStats(values.data(),size,stats);
+        computeValueRangeForMap(stats,minValue,maxValue,step);
+      }
+
+      if (params.paint_blur == 0)
+        params.paint_blur = 1;
+    }
+
+    double amp = (double)params.paint_alpha/255.0;
+
+    std::unique_ptr<AutoReadLock> colorMapLock;
+    if (mapColors)
+      colorMapLock.reset(new AutoReadLock(colorMapFile->getModificationLock()));
+
+    // ### Each pixel is produced in a single pass: the bottom layer, the data and the
+    // ### layers above the data. The rows are processed in parallel bands.
+
+    processRowBands(height,size,[&](int y1,int y2)
+    {
+      std::vector<uint> rowColors;
+      if (mapColors)
+        rowColors.resize(width);
+
+      for (int y=y1; y<y2; y++)
+      {
+        int yy = y;
+        if (rotate)
+          yy = height-y-1;
+
+        uint c = y*width;
+
+        // The colors of the whole row are mapped in one call.
+        if (mapColors)
+          colorMapFile->getSmoothColors(&values[c],width,rowColors.data());
+
+        for (int x=0; x<width; x++)
+        {
+          uint pixpos = yy*width + x;
+          uint col = 0x00000000;
+
+          if (bottomImage)
+            col = bottomImage[pixpos];
+
+          if (hsvColors || mapColors)
+          {
+            T::ParamValue val = values[c];
+            if (val == 0.0   &&  params.zeroIsMissing)
+              val = ParamValueMissing;
+
+            uint vcol = 0x00000000;
+            if (hsvColors)
+            {
+              uint vv = ((val - minValue) / step);
+              uint v = 200 - vv;
+              if (vv > 200)
+                v = 0;
+
+              v = v / params.paint_blur;
+              v = v * params.paint_blur;
+              v = v + 55;
+
+              if (val != ParamValueMissing)
+                vcol = alpha + hsv_to_rgb(params.paint_hue,params.paint_saturation,C_UCHAR(v));
+            }
+            else
+            {
+              vcol = rowColors[x];
+              if (val == ParamValueMissing)
+                vcol = 0x00FFFFFF;
+
+              if (params.paint_alpha != 255)
+              {
+                uint current_alpha = vcol & 0xFF000000;
+                uint current_color = vcol & 0x00FFFFFF;
+                if (current_alpha == 0xFF000000)
+                {
+                  vcol = alpha | current_color;
+                }
+                else
+                {
+                  uint new_alpha = ((uint)((double)current_alpha *amp)) & 0xFF000000;
+                  vcol = new_alpha | current_color;
+                }
+              }
+            }
+
+            if (vcol & 0xFF000000)
+              col = merge_ARGB(vcol,col);
+          }
+
+          for (uint l=0; l<topCount; l++)
+          {
+            uint lcol = topImages[l][pixpos];
+            if (lcol & 0xFF000000)
+              col = merge_ARGB(lcol,col);
+          }
+
+          finalImage[pixpos] = col;
+          c++;
+        }
+      }
+    });
+
+    colorMapLock.reset();
+
+
+    if ((params.coordinateLine_color & 0xFF000000)  &&  lineCoordinates  &&  lineCoordinates->size() > 0)
+    {
+      ImagePaint imagePaint(finalImage,width,height,0x0,params.coordinateLine_color,0xFFFFFFFF,false,rotate);
+
+      for (auto it = lineCoordinates->begin(); it != lineCoordinates->end(); ++it)
+        imagePaint.paintPixel(C_INT(Fmi::floor(it->x())),C_INT(Fmi::floor(it->y())),params.coordinateLine_color);
+    }
+
+
+
+    if (params.stream_step > 0)
+    {
+      // Draw stream lines
+
+      T::ParamValue *direction = new float[size];
+      if (!rotate)
+      {
+        uint idx = 0;
+        for (int y=0; y<height; y++)
+        {
+          for (int x=0; x<width; x++)
+          {
+            direction[idx] = values[idx];
+            idx++;
+          }
+        }
+      }
+      else
+      {
+        uint idx = 0;
+        for (int y=0; y<height; y++)
+        {
+          uint idx2 = (height-y-1) * width;
+          for (int x=0; x<width; x++)
+          {
+            direction[idx] = values[idx2];
+            idx++;
+            idx2++;
+          }
+        }
+      }
+
+      //uint *img = finalImage; //imagePaint.getImage();
+      uint *streamImage = new uint[size];
+
+      getStreamlineImage(direction,nullptr,streamImage,width,height,params.stream_step,params.stream_step,params.stream_minLength,params.stream_maxLength);
+
+      uint lcolmax = 0xD0;
+      const uint lcolors = 16;
+      uint color[lcolors];
+
+      uint sc = params.stream_color & 0x00FFFFFF;
+
+      double mp = (double)lcolmax / (double)lcolors;
+      std::vector<int> timeVect;
+      for (uint t=0; t<lcolors; t++)
+      {
+        uint cc = lcolmax - (uint)(t*mp);
+        color[t] = (cc << 24) + sc;
+        timeVect.push_back(50);
+      }
+
+      if (params.stream_animation)
+      {
+        uint *wimage[lcolors];
+        for (uint t=0; t<lcolors; t++)
+          wimage[t] = new uint[size];
+
+        processRowBands(height,size*lcolors,[&](int y1,int y2)
+        {
+          uint idx = y1*width;
+          for (int y = y1; y < y2; y++)
+          {
+            for (int x=0; x < width; x++)
+            {
+              uint streamCol = streamImage[idx];
+              for (uint t=0; t<lcolors; t++)
+              {
+                uint fcol = finalImage[idx];
+
+                if (streamCol != 0)
+                {
+                  uint lcol = color[(streamCol-1+t) % lcolors];
+                  fcol = merge_ARGB(lcol,fcol);
+                }
+                // ARGB to RGBA
+                uint newCol = (fcol & 0xFF000000) + ((fcol & 0xFF0000) >> 16) + (fcol & 0x00FF00) + ((fcol & 0xFF) << 16);
+                wimage[t][idx] = newCol;
+              }
+              idx++;
+            }
+          }
+        });
+
+        params.image.content.reset(new std::vector<char>());
+        params.image.mappedFile.reset();
+        params.image.contentType = "image/webp";
+        webp_anim_encode(wimage,width,height,lcolors,timeVect,*params.image.content);
+
+        for (uint t=0; t<lcolors; t++)
+        {
+          delete [] wimage[t];
+          wimage[t] = nullptr;
+        }
+
+        delete [] direction;
+        direction = nullptr;
+
+        delete [] streamImage;
+        streamImage = nullptr;
+        return;
+      }
+      else
+      {
+        processRowBands(height,size,[&](int y1,int y2)
+        {
+          for (uint t=y1*width; t<C_UINT(y2*width); t++)
+          {
+            uint streamCol = streamImage[t];
+            if (streamCol != 0)
+            {
+              finalImage[t] = merge_ARGB(color[(streamCol-1) % lcolors],finalImage[t]);
+            }
+          }
+        });
+      }
+      delete [] direction;
+      direction = nullptr;
+
+      delete [] streamImage;
+      streamImage = nullptr;
+    }
+
+
+    if (finalImage)
+    {
+      //jpeg_save(params.imageFile.c_str(),finalImage,height,width,100);
+      params.image.content.reset(new std::vector<char>());
+      params.image.mappedFile.reset();
+      params.image.contentType = "image/png";
+      png_encode(finalImage,width,height,1,*params.image.content);
+
+      delete [] finalImage;
+      finalImage = nullptr;
+    }
+
+
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+
+/*! \brief GridGui: Page info. */
+
+int Plugin::page_info(Spine::Reactor &theReactor,
+                            const HTTP::Request &theRequest,
+                            HTTP::Response &theResponse,
+                            Session& session)
+{
+  FUNCTION_TRACE
+  try
+  {
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    auto dataServer = itsGridEngine->getDataServer_sptr();
+
+    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
+    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+
+    std::ostringstream ostr;
+
+    T::ContentInfo contentInfo;
+    int result = contentServer->getContentInfo(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),contentInfo);
+    if (result != 0)
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "ERROR: getContentInfo : " << result << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+    T::FileInfo fileInfo;
+    result = contentServer->getFileInfoById(0,contentInfo.mFileId,fileInfo);
+    if (result != 0)
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "ERROR: getFileInfoById : " << result << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+    T::GenerationInfo generationInfo;
+    result = contentServer->getGenerationInfoById(0,contentInfo.mGenerationId,generationInfo);
+    if (result != 0)
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "ERROR: getGenerationInfoById : " << result << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+    T::ProducerInfo producerInfo;
+    result = contentServer->getProducerInfoById(0,contentInfo.mProducerId,producerInfo);
+    if (result != 0)
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "ERROR: getProducerInfoById : " << result << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+    T::AttributeList attributeList;
+    result = dataServer->getGridAttributeList(0,contentInfo.mFileId,contentInfo.mMessageIndex,attributeList);
+    if (result != 0)
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "ERROR: getGridAttributeList : " << result << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+
+    ostr << "<HTML><BODY>\n";
+    ostr << "<TABLE border=\"1\" width=\"100%\" style=\"font-size:14; color:#FFFFFF;\">\n";
+
+    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Producer</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Id</TD><TD>" << producerInfo.mProducerId << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Name</TD><TD>" << producerInfo.mName << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Title</TD><TD>" << producerInfo.mTitle << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Description</TD><TD>" << producerInfo.mDescription << "</TD></TR>\n";
+
+    ostr << "</TABLE></TD></TR>\n";
+
+
+
+    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Generation</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Id</TD><TD>" << generationInfo.mGenerationId << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Name</TD><TD>" << generationInfo.mName << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Description</TD><TD>" << generationInfo.mDescription << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Analysis time</TD><TD>" << generationInfo.mAnalysisTime << "</TD></TR>\n";
+    if (generationInfo.mDeletionTime > 0)
+      ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Deletion time</TD><TD>" << utcTimeFromTimeT(generationInfo.mDeletionTime) << "</TD></TR>\n";
+
+    ostr << "</TABLE></TD></TR>\n";
+
+
+
+    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">File</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Id</TD><TD>" << fileInfo.mFileId << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Server</TD><TD>" << fileInfo.mServer << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Protocol</TD><TD>" << C_INT(fileInfo.mProtocol) << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Type</TD><TD>" << C_INT(fileInfo.mFileType) << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Name</TD><TD>" << fileInfo.mName << "</TD></TR>\n";
+    if (fileInfo.mDeletionTime > 0)
+      ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Deletion time</TD><TD>" << utcTimeFromTimeT(fileInfo.mDeletionTime) << "</TD></TR>\n";
+
+    ostr << "</TABLE></TD></TR>\n";
+
+
+
+    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Parameter</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Message index</TD><TD>" << contentInfo.mMessageIndex << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">File Position</TD><TD>" << contentInfo.mFilePosition << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Size</TD><TD>" << contentInfo.mMessageSize << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Forecast time</TD><TD>" << contentInfo.getForecastTime() << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Level</TD><TD>" << contentInfo.mParameterLevel << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">FMI identifier</TD><TD>" << contentInfo.mFmiParameterId << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">FMI name</TD><TD>" << contentInfo.getFmiParameterName() << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">FMI level identifier</TD><TD>" << toString(contentInfo.mFmiParameterLevelId) << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Forecast type</TD><TD>" << contentInfo.mForecastType << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Forecast number</TD><TD>" << contentInfo.mForecastNumber << "</TD></TR>\n";
+    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Geometry identifier</TD><TD>" << contentInfo.mGeometryId << "</TD></TR>\n";
+
+    ostr << "</TABLE></TD></TR>\n";
+
+
+    uint len = attributeList.getLength();
+    if (len > 0)
+    {
+      ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Attributes</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+
+      for (uint t=0; t<len; t++)
+      {
+        T::Attribute *attr = attributeList.getAttributeByIndex(t);
+        ostr << "<TR><TD>" << attr->mName << " = " << attr->mValue << "</TD></TR>\n";
+      }
+      ostr << "</TABLE></TD></TR>\n";
+    }
+
+
+    ostr << "</TABLE>\n";
+
+    ostr << "</BODY></HTML>\n";
+
+
+    theResponse.setContent(std::string(ostr.str()));
+    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+    return HTTP::Status::ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Page message. Shows a window of the message bytes as a hex and
+ *  ASCII table. The window starts from the given offset (mo) and its length is ml
+ *  bytes (default 16000). Only the window and the section headers are read if the
+ *  message is in a local file. */
+
+int Plugin::page_message(Spine::Reactor &theReactor,
+                            const HTTP::Request &theRequest,
+                            HTTP::Response &theResponse,
+                            Session& session)
+{
+  FUNCTION_TRACE
+  try
+  {
+    auto dataServer = itsGridEngine->getDataServer_sptr();
+
+    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
+    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+    std::string offsetStr = getRequestAttribute(theRequest,session,ATTR_MESSAGE_OFFSET);
+    std::string lengthStr = getRequestAttribute(theRequest,session,ATTR_MESSAGE_LENGTH);
+
+    if (fileIdStr.empty())
+      return HTTP::Status::ok;
+
+    std::size_t offset = offsetStr.empty() ? 0 : toUInt64(offsetStr);
+    std::size_t length = lengthStr.empty() ? MESSAGE_VIEW_LENGTH : toUInt64(lengthStr);
+    length = std::max(static_cast<std::size_t>(16),std::min(length,static_cast<std::size_t>(MESSAGE_VIEW_MAX_LENGTH)));
+
+    // ### The rows start from the multiples of 16.
+
+    offset = offset & ~static_cast<std::size_t>(15);
+    length = (length + 15) & ~static_cast<std::size_t>(15);
+
+    std::ostringstream ostr;
+
+    std::string fileName;
+    std::size_t position = 0;
+    std::size_t size = 0;
+    std::string trailer;
+    std::vector<uint> messageSections;
+    std::vector<uchar> messageBytes;
+    const uchar *bytes = nullptr;
+
+    if (getLocalMessage(toUInt64(fileIdStr),toUInt32(messageIndexStr),fileName,position,size,trailer))
+    {
+      readGribSections(fileName.c_str(),position,size,messageSections);
+
+      if (offset >= size)
+        offset = (size - 1) & ~static_cast<std::size_t>(15);
+
+      messageBytes.resize(std::min(length,size - offset));
+      if (!readFileBytes(fileName.c_str(),position + offset,messageBytes.size(),reinterpret_cast<char*>(messageBytes.data())))
+      {
+        ostr << "<HTML><BODY>\n";
+        ostr << "ERROR: Cannot read the message from the file " << fileName << "\n";
+        ostr << "</BODY></HTML>\n";
+        theResponse.setContent(std::string(ostr.str()));
+        theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+        return HTTP::Status::ok;
+      }
+      bytes = messageBytes.data();
+    }
+    else
+    {
+      int result = dataServer->getGridMessageBytes(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),messageBytes,messageSections);
+      if (result != 0)
+      {
+        ostr << "<HTML><BODY>\n";
+        ostr << "ERROR: getGridMessageBytes : " << result << "\n";
+        ostr << "</BODY></HTML>\n";
+        theResponse.setContent(std::string(ostr.str()));
+        theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+        return HTTP::Status::ok;
+      }
+
+      size = messageBytes.size();
+      if (offset >= size)
+        offset = (size > 0) ? (size - 1) & ~static_cast<std::size_t>(15) : 0;
+
+      bytes = messageBytes.data() + offset;
+    }
+
+    std::size_t count = std::min(length,size - offset);
+    std::size_t rows = (count + 15) / 16;
+    std::size_t ssize = messageSections.size();
+
+    std::string output;
+    output.reserve(rows * 1200 + ssize * 200 + 4096);
+
+    output += "<HTML><BODY>\n";
+
+    // ### Navigation: the neighbouring windows and the section boundaries.
+
+    auto link = [&](const std::string& text,std::size_t newOffset) -> std::string
+    {
+      session.setAttribute(ATTR_MESSAGE_OFFSET,std::to_string(newOffset));
+      session.setAttribute(ATTR_MESSAGE_LENGTH,std::to_string(length));
+      return "<A href=\"grid-gui?session=" + session.getUrlParameter() + "&" + ATTR_PAGE + "=message\">" + text + "</A> ";
+    };
+
+    output += "<P style=\"font-family:Arial; font-size:10pt;\">Message size ";
+    appendNumber(output,size);
+    output += " bytes, bytes ";
+    appendHex(output,offset,8);
+    output += "..";
+    appendHex(output,offset + count - (count > 0 ? 1 : 0),8);
+    output += " : ";
+    if (offset > 0)
+    {
+      output += link("First",0);
+      output += link("Previous",(offset > length) ? offset - length : 0);
+    }
+    if (offset + length < size)
+    {
+      output += link("Next",offset + length);
+      output += link("Last",((size - 1) / length) * length);
+    }
+
+    if (ssize > 0)
+    {
+      output += "<BR>Sections : ";
+      for (std::size_t t=0; t<ssize; t++)
+      {
+        std::string text;
+        appendHex(text,messageSections[t],8);
+        output += link(text,messageSections[t]);
+      }
+    }
+    output += "</P>\n";
+
+    output += "<TABLE border=\"1\" style=\"font-family:Arial; font-size:14; color:#000000; background:#FFFFFF;\">\n";
+    output += "<TR bgColor=\"#A0A0A0\"><TD width=\"50\">Address</TD>";
+
+    for (uint c=0; c<16; c++)
+    {
+      output += "<TD width=\"20\" align=\"center\">";
+      appendHex(output,c,2);
+      output += "</TD>";
+    }
+
+    output += "<TD width=\"20\"></TD>";
+
+    for (uint c=0; c<16; c++)
+    {
+      output += "<TD width=\"20\" align=\"center\">";
+      appendHex(output,c,2);
+      output += "</TD>";
+    }
+
+    output += "</TR>";
+
+    // ### The sections are painted with alternating colors. The window can start in
+    // ### the middle of a section.
+
+    std::size_t scnt = 0;
+    while (scnt < ssize  &&  messageSections[scnt] <= offset)
+      scnt++;
+
+    const char *color = (scnt > 0  &&  ((scnt - 1) % 2) == 1) ? " bgColor=\"E0E0E0\"" : "";
+
+    std::string ascii;
+    ascii.reserve(600);
+
+    for (std::size_t r=0; r<rows; r++)
+    {
+      std::size_t a = offset + r*16;
+      ascii = "<TD bgColor=\"#C0C0C0\"></TD>";
+
+      output += "<TR><TD bgColor=\"#C0C0C0\" width=\"50\">";
+      appendHex(output,a,8);
+      output += "</TD>";
+
+      for (uint c=0; c<16; c++)
+      {
+        std::size_t cnt = a + c;
+        if (scnt < ssize  &&  cnt == messageSections[scnt])
+        {
+          color = ((scnt % 2) == 1) ? " bgColor=\"E0E0E0\"" : "";
+          scnt++;
+        }
+
+        output += "<TD width=\"20\"";
+        output += color;
+        output += ">";
+        ascii += "<TD";
+        ascii += color;
+        ascii += ">";
+
+        if (cnt < size  &&  cnt < offset + count)
+        {
+          uchar b = bytes[cnt - offset];
+          appendHex(output,b,2);
+          ascii += getPrintableChar(b);
+        }
+        else
+        {
+          ascii += '.';
+        }
+
+        output += "</TD>";
+        ascii += "</TD>";
+      }
+      output += ascii;
+      output += "</TR>\n";
+    }
+
+    output += "</TABLE>\n";
+
+    output += "</BODY></HTML>\n";
+
+    theResponse.setContent(output);
+    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+    return HTTP::Status::ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-      if (landShadingImage)
-        lscol = landShadingImage[t];
 
-      if (seaShadingImage)
-        sscol = seaShadingImage[t];
 
-      if (valImage)
-        vcol = valImage[t];
 
-      if (landBorderImage)
-        lbcol = landBorderImage[t];
 
-      if ((landcol & 0xFF000000) &&  params.landColor_position == 1)
-        col = landcol;
+/*! \brief GridGui: Get the local file and the byte range of a GRIB message, and the
+ *  missing GRIB end section (see checkGribMessage()). Returns false if the file is
+ *  not readable by this server (for example, a remote file) or the range does not
+ *  contain a GRIB message. */
 
-      if ((seacol & 0xFF000000) &&  params.seaColor_position == 1)
-        col = seacol;
+bool Plugin::getLocalMessage(T::FileId fileId,T::MessageIndex messageIndex,std::string& fileName,std::size_t& position,std::size_t& size,std::string& trailer)
+{
+  FUNCTION_TRACE
+  try
+  {
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+
+    T::ContentInfo contentInfo;
+    if (contentServer->getContentInfo(0,fileId,messageIndex,contentInfo) != 0  ||  contentInfo.mMessageSize == 0)
+      return false;
+
+    T::FileInfo fileInfo;
+    if (contentServer->getFileInfoById(0,fileId,fileInfo) != 0  ||  !fileInfo.mServer.empty()  ||  fileInfo.mName.empty())
+      return false;
+
+    if (!checkGribMessage(fileInfo.mName.c_str(),contentInfo.mFilePosition,contentInfo.mMessageSize,trailer))
+      return false;
+
+    fileName = fileInfo.mName;
+    position = contentInfo.mFilePosition;
+    size = contentInfo.mMessageSize;
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the byte range (start <= x < end) of the "Range" request header.
+ *  Only a single range "bytes=a-b", "bytes=a-" or "bytes=-n" is supported; the
+ *  whole content is returned for the other ranges. The range is also ignored if the
+ *  "If-Range" header does not match the ETag of the content, because the client's
+ *  partial copy is then from a different version. Returns the response status:
+ *  ok (whole content), partial_content or requested_range_not_satisfiable. */
+
+int Plugin::getByteRange(const HTTP::Request& theRequest,const std::string& etag,std::size_t size,std::size_t& start,std::size_t& end)
+{
+  FUNCTION_TRACE
+  try
+  {
+    start = 0;
+    end = size;
+
+    std::optional<std::string> header = theRequest.getHeader("Range");
+    if (!header  ||  strncasecmp(header->c_str(),"bytes=",6) != 0  ||  header->find(',') != std::string::npos)
+      return HTTP::Status::ok;
+
+    // ### If-Range contains an ETag (a weak one never matches) or a date. No
+    // ### Last-Modified is sent, so a date cannot match either.
+
+    std::optional<std::string> ifRange = theRequest.getHeader("If-Range");
+    if (ifRange)
+    {
+      std::size_t first = ifRange->find_first_not_of(" \t");
+      std::size_t last = ifRange->find_last_not_of(" \t");
+      std::string tag = (first == std::string::npos) ? "" : ifRange->substr(first,last-first+1);
+      if (tag.size() >= 2  &&  tag.front() == '"'  &&  tag.back() == '"')
+        tag = tag.substr(1,tag.size()-2);
+
+      if (tag != etag)
+        return HTTP::Status::ok;
+    }
+
+    std::string range = header->substr(6);
+    std::size_t dash = range.find('-');
+    if (dash == std::string::npos)
+      return HTTP::Status::ok;
+
+    std::string first = range.substr(0,dash);
+    std::string last = range.substr(dash+1);
+    if (first.find_first_not_of("0123456789") != std::string::npos  ||  last.find_first_not_of("0123456789") != std::string::npos)
+      return HTTP::Status::ok;
+
+    if (first.empty())
+    {
+      // ### The last n bytes.
+
+      if (last.empty())
+        return HTTP::Status::ok;
+
+      std::size_t n = std::stoull(last);
+      if (n == 0  ||  size == 0)
+        return HTTP::Status::requested_range_not_satisfiable;
+
+      start = (n < size) ? size - n : 0;
+      return HTTP::Status::partial_content;
+    }
+
+    std::size_t a = std::stoull(first);
+    if (a >= size)
+      return HTTP::Status::requested_range_not_satisfiable;
+
+    if (!last.empty())
+    {
+      std::size_t b = std::stoull(last);
+      if (b < a)
+        return HTTP::Status::ok;
+
+      end = std::min(size,b + 1);
+    }
+
+    start = a;
+    return HTTP::Status::partial_content;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Page download. The message is streamed in chunks straight from its
+ *  file when the file is readable by this server; otherwise it is fetched from the
+ *  data server. A single byte range ("Range" header) can be requested for resuming
+ *  the download. The ETag is checked before the message is read or fetched. */
+
+int Plugin::page_download(Spine::Reactor &theReactor,
+                            const HTTP::Request &theRequest,
+                            HTTP::Response &theResponse,
+                            Session& session)
+{
+  FUNCTION_TRACE
+  try
+  {
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    auto dataServer = itsGridEngine->getDataServer_sptr();
+
+    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
+    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+
+    T::FileId fileId = toUInt64(fileIdStr);
+    T::MessageIndex messageIndex = toUInt32(messageIndexStr);
+
+    T::ContentInfo contentInfo;
+    if (fileId == 0  ||  contentServer->getContentInfo(0,fileId,messageIndex,contentInfo) != 0  ||  contentInfo.mMessageSize == 0)
+    {
+      std::ostringstream ostr;
+      ostr << "<HTML><BODY>\n";
+      ostr << "Message does not exist!\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      theResponse.setContent(std::string(ostr.str()));
+      return HTTP::Status::ok;
+    }
+
+    // ### The ETag is based on the location of the message, so a cached download is
+    // ### validated before the message is read or fetched from the data server.
+
+    std::string hash = "Download:" + getMessageKey(fileId,messageIndex) + ":" + std::to_string(contentInfo.mMessageSize);
+    std::string seedStr = std::to_string(Fmi::hash(hash));
+
+    if (auto status = conditionalResponseStatus(theRequest, seedStr))
+    {
+      theResponse.setHeader("ETag",seedStr);
+      return *status;
+    }
+
+    std::string fileName;
+    std::size_t position = 0;
+    std::size_t size = 0;
+    std::string trailer;
+    bool local = getLocalMessage(fileId,messageIndex,fileName,position,size,trailer);
+
+    // ### The fetched message is shared with the response streamer instead of being
+    // ### copied into the response.
+
+    std::shared_ptr<std::vector<uchar>> messageBytes;
+    if (!local)
+    {
+      messageBytes.reset(new std::vector<uchar>());
+      std::vector<uint> messageSections;
+      int result = dataServer->getGridMessageBytes(0,fileId,messageIndex,*messageBytes,messageSections);
+      if (result != 0)
+      {
+        std::ostringstream ostr;
+        ostr << "<HTML><BODY>\n";
+        ostr << "ERROR: getGridMessageBytes : " << result << "\n";
+        ostr << "</BODY></HTML>\n";
+        theResponse.setContent(std::string(ostr.str()));
+        theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+        return HTTP::Status::ok;
+      }
+      size = messageBytes->size();
+
+      // ### The GRIB end section is added if the message does not contain it.
+
+      if (size < 4  ||  memcmp(&(*messageBytes)[size-4],"7777",4) != 0)
+        trailer = "7777";
+    }
+
+    if (size == 0)
+    {
+      std::ostringstream ostr;
+      ostr << "<HTML><BODY>\n";
+      ostr << "Message does not exist!\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      theResponse.setContent(std::string(ostr.str()));
+      return HTTP::Status::ok;
+    }
+
+    std::size_t total = size + trailer.size();
+
+    theResponse.setHeader("ETag",seedStr);
+    theResponse.setHeader("Accept-Ranges","bytes");
+
+    std::size_t start = 0;
+    std::size_t end = total;
+    int status = getByteRange(theRequest,seedStr,total,start,end);
+    if (status == HTTP::Status::requested_range_not_satisfiable)
+    {
+      theResponse.setHeader("Content-Range","bytes */" + std::to_string(total));
+      return status;
+    }
+
+    if (status == HTTP::Status::partial_content)
+      theResponse.setHeader("Content-Range","bytes " + std::to_string(start) + "-" + std::to_string(end-1) + "/" + std::to_string(total));
+
+    // ### The range is split between the message and the trailer.
+
+    std::size_t messageStart = std::min(start,size);
+    std::size_t messageEnd = std::min(end,size);
+    std::string rangeTrailer;
+    if (end > size)
+      rangeTrailer = trailer.substr(std::max(start,size) - size,end - std::max(start,size));
+
+    std::string val = "attachment; filename=message_" + fileIdStr + "_" + messageIndexStr + ".grib";
+    theResponse.setHeader("Content-Disposition",val);
+    theResponse.setHeader("Content-Type","application/octet-stream");
+
+    if (local)
+    {
+      std::shared_ptr<FileRangeStreamer> streamer(new FileRangeStreamer());
+      if (!streamer->open(fileName.c_str(),position + messageStart,messageEnd - messageStart,rangeTrailer))
+        return HTTP::Status::not_found;
+
+      theResponse.setContent(streamer);
+      return status;
+    }
+
+    std::shared_ptr<BufferRangeStreamer> streamer(new BufferRangeStreamer());
+    if (!streamer->open(messageBytes,messageStart,messageEnd - messageStart,rangeTrailer))
+      return HTTP::Status::not_found;
+
+    theResponse.setContent(streamer);
+    return status;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Page subset. Streams all the GRIB messages of the selected
+ *  generation and parameter back to back as one download. The level range (sl1, sl2)
+ *  defaults to the selected level and the time range (st1, st2) to all the times;
+ *  the selected level type, forecast type, forecast number and geometry are used
+ *  as they are. */
+
+int Plugin::page_subset(Spine::Reactor &theReactor,
+                            const HTTP::Request &theRequest,
+                            HTTP::Response &theResponse,
+                            Session& session)
+{
+  FUNCTION_TRACE
+  try
+  {
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    auto dataServer = itsGridEngine->getDataServer_sptr();
+
+    std::string generationIdStr = session.getAttribute(ATTR_GENERATION_ID);
+    std::string parameterIdStr = session.getAttribute(ATTR_PARAMETER_ID);
+    std::string levelIdStr = session.getAttribute(ATTR_LEVEL_ID);
+    std::string levelStr = session.getAttribute(ATTR_LEVEL);
+    std::string forecastTypeStr = session.getAttribute(ATTR_FORECAST_TYPE);
+    std::string forecastNumberStr = session.getAttribute(ATTR_FORECAST_NUMBER);
+    std::string geometryIdStr = session.getAttribute(ATTR_GEOMETRY_ID);
+    std::string levelMinStr = getRequestAttribute(theRequest,session,ATTR_SUBSET_LEVEL_MIN);
+    std::string levelMaxStr = getRequestAttribute(theRequest,session,ATTR_SUBSET_LEVEL_MAX);
+    std::string timeMinStr = getRequestAttribute(theRequest,session,ATTR_SUBSET_TIME_MIN);
+    std::string timeMaxStr = getRequestAttribute(theRequest,session,ATTR_SUBSET_TIME_MAX);
+
+    std::ostringstream ostr;
+
+    if (generationIdStr.empty()  ||  parameterIdStr.empty())
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "The generation and the parameter must be selected!\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::bad_request;
+    }
+
+    if (levelMinStr.empty())
+      levelMinStr = levelStr.empty() ? "0" : levelStr;
+
+    if (levelMaxStr.empty())
+      levelMaxStr = levelStr.empty() ? "2147483647" : levelStr;
+
+    if (timeMinStr.empty())
+      timeMinStr = "14000101T000000";
+
+    if (timeMaxStr.empty())
+      timeMaxStr = "30000101T000000";
+
+    T::GenerationId generationId = toUInt32(generationIdStr);
+    int levelId = levelIdStr.empty() ? -1 : toInt32(levelIdStr);
+    short forecastType = forecastTypeStr.empty() ? -2 : toInt16(forecastTypeStr);
+    short forecastNumber = forecastNumberStr.empty() ? -2 : toInt16(forecastNumberStr);
+    T::GeometryId geometryId = geometryIdStr.empty() ? -2 : toInt32(geometryIdStr);
+
+    T::ContentInfoList contentInfoList;
+    int result = contentServer->getContentListByParameterAndGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,parameterIdStr,levelId,toInt32(levelMinStr),toInt32(levelMaxStr),forecastType,forecastNumber,geometryId,timeMinStr,timeMaxStr,0,contentInfoList);
+    if (result != 0)
+    {
+      ostr << "<HTML><BODY>\n";
+      ostr << "ERROR: getContentListByParameterAndGenerationId : " << result << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+    uint len = contentInfoList.getLength();
+    if (len == 0  ||  len > SUBSET_MAX_MESSAGES)
+    {
+      ostr << "<HTML><BODY>\n";
+      if (len == 0)
+        ostr << "No messages found!\n";
+      else
+        ostr << "Too many messages (" << len << "), the limit is " << SUBSET_MAX_MESSAGES << "!\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
+
+    // ### The messages of the local files are read straight from the files. The file
+    // ### information is asked only once per file.
+
+    std::map<T::FileId,std::string> fileNames;
+    StreamMessage_vec messages;
+    messages.reserve(len);
+
+    for (uint t=0; t<len; t++)
+    {
+      T::ContentInfo *contentInfo = contentInfoList.getContentInfoByIndex(t);
+      if (contentInfo == nullptr)
+        continue;
+
+      StreamMessage message;
+      message.fileId = contentInfo->mFileId;
+      message.messageIndex = contentInfo->mMessageIndex;
+
+      auto f = fileNames.find(contentInfo->mFileId);
+      if (f == fileNames.end())
+      {
+        std::string fileName;
+        T::FileInfo fileInfo;
+        if (contentServer->getFileInfoById(0,contentInfo->mFileId,fileInfo) == 0  &&  fileInfo.mServer.empty())
+          fileName = fileInfo.mName;
+
+        f = fileNames.insert(std::make_pair(contentInfo->mFileId,fileName)).first;
+      }
+
+      if (!f->second.empty()  &&  checkGribMessage(f->second.c_str(),contentInfo->mFilePosition,contentInfo->mMessageSize,message.trailer))
+      {
+        message.fileName = f->second;
+        message.position = contentInfo->mFilePosition;
+        message.size = contentInfo->mMessageSize;
+      }
 
-      if ((lscol & 0xFF000000)  &&  params.landShading_position == 1)
-        col = merge_ARGB(lscol,col);
+      messages.emplace_back(message);
+    }
+
+    std::string val = "attachment; filename=subset_" + generationIdStr + "_" + parameterIdStr + ".grib";
+    theResponse.setHeader("Content-Disposition",val);
+    theResponse.setHeader("Content-Type","application/octet-stream");
+    theResponse.setContent(std::shared_ptr<HTTP::ContentStreamer>(new MessageListStreamer(dataServer,messages,&itsFetchPool,SUBSET_MAX_FETCHES)));
+
+    return HTTP::Status::ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get a page attribute. The attributes of the separate pages are
+ *  normally appended to the session parameter, but they can also be given as
+ *  separate request parameters. Returns an empty string if the attribute is not
+ *  given at all. */
+
+std::string Plugin::getRequestAttribute(const HTTP::Request& theRequest,Session& session,const char *name)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::string str;
+    session.getAttribute(name,str);
+    if (str.empty())
+    {
+      std::optional<std::string> v = theRequest.getParameter(name);
+      if (v)
+        str = *v;
+    }
+    return str;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-      if ((sscol & 0xFF000000) &&  params.seaShading_position == 1)
-        col = merge_ARGB(sscol,col);
 
 
-      if (vcol & 0xFF000000)
-        col = merge_ARGB(vcol,col);
 
 
-      if ((landcol & 0xFF000000)  &&  params.landColor_position == 2)
-        col = merge_ARGB(landcol,col);
+/*! \brief GridGui: Get the window of the table and coordinate pages: the first column
+ *  and row (tbx, tby), the number of the shown columns and rows (tbc, tbr) and the
+ *  step between the shown cells (tbs). The step 0 selects the smallest step that
+ *  fits the rest of the grid into the window. The defaults show the top-left
+ *  100 x 100 cells. */
 
-      if ((seacol & 0xFF000000)  &&  params.seaColor_position == 2)
-        col = merge_ARGB(seacol,col);
+void Plugin::getTableWindow(const HTTP::Request& theRequest,Session& session,uint width,uint height,uint& x,uint& y,uint& columns,uint& rows,uint& step)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::string xStr = getRequestAttribute(theRequest,session,ATTR_TABLE_X);
+    std::string yStr = getRequestAttribute(theRequest,session,ATTR_TABLE_Y);
+    std::string columnsStr = getRequestAttribute(theRequest,session,ATTR_TABLE_COLUMNS);
+    std::string rowsStr = getRequestAttribute(theRequest,session,ATTR_TABLE_ROWS);
+    std::string stepStr = getRequestAttribute(theRequest,session,ATTR_TABLE_STEP);
+
+    x = xStr.empty() ? 0 : toUInt32(xStr);
+    y = yStr.empty() ? 0 : toUInt32(yStr);
+    columns = columnsStr.empty() ? TABLE_DEFAULT_SIZE : toUInt32(columnsStr);
+    rows = rowsStr.empty() ? TABLE_DEFAULT_SIZE : toUInt32(rowsStr);
+    step = stepStr.empty() ? 1 : toUInt32(stepStr);
+
+    columns = std::max(1U,std::min(columns,C_UINT(TABLE_MAX_SIZE)));
+    rows = std::max(1U,std::min(rows,C_UINT(TABLE_MAX_SIZE)));
+
+    if (width == 0 || height == 0)
+    {
+      x = 0;
+      y = 0;
+      columns = 0;
+      rows = 0;
+      step = 1;
+      return;
+    }
 
-      if ((lscol & 0xFF000000)  &&  params.landShading_position == 2)
-        col = merge_ARGB(lscol,col);
+    if (x >= width)
+      x = width - 1;
 
-      if ((sscol & 0xFF000000) &&  params.seaShading_position == 2)
-        col = merge_ARGB(sscol,col);
+    if (y >= height)
+      y = height - 1;
 
-      if (lbcol & 0xFF000000)
-        col = merge_ARGB(lbcol,col);
+    if (step == 0)
+      step = std::max(1U,std::max((width - x + columns - 1) / columns,(height - y + rows - 1) / rows));
 
-      //if (lbcol & 0xFF000000)
-      //  col = merge_ARGB(lbcol,col);
+    columns = std::min(columns,(width - x + step - 1) / step);
+    rows = std::min(rows,(height - y + step - 1) / step);
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-      finalImage[t] = col;
-    }
 
 
-    if ((params.coordinateLine_color & 0xFF000000)  &&  lineCoordinates  &&  lineCoordinates->size() > 0)
-    {
-      ImagePaint imagePaint(finalImage,width,height,0x0,params.coordinateLine_color,0xFFFFFFFF,false,rotate);
 
-      for (auto it = lineCoordinates->begin(); it != lineCoordinates->end(); ++it)
-        imagePaint.paintPixel(C_INT(Fmi::floor(it->x())),C_INT(Fmi::floor(it->y())),params.coordinateLine_color);
-    }
 
+/*! \brief GridGui: Get the navigation links of the table and coordinate pages. The
+ *  links are built on a copy of the session, so the session of the page is not
+ *  modified. */
 
-    if (landImage)
-    {
-      delete [] landImage;
-      landImage = nullptr;
-    }
+std::string Plugin::getTableNavigation(Session& session,const char *page,uint width,uint height,uint x,uint y,uint columns,uint rows,uint step)
+{
+  FUNCTION_TRACE
+  try
+  {
+    Session linkSession = session;
 
-    if (seaImage)
+    auto link = [&](const char *text,uint newX,uint newY,uint newStep) -> std::string
     {
-      delete [] seaImage;
-      seaImage = nullptr;
-    }
+      linkSession.setAttribute(ATTR_TABLE_X,newX);
+      linkSession.setAttribute(ATTR_TABLE_Y,newY);
+      linkSession.setAttribute(ATTR_TABLE_COLUMNS,columns);
+      linkSession.setAttribute(ATTR_TABLE_ROWS,rows);
+      linkSession.setAttribute(ATTR_TABLE_STEP,newStep);
+      return std::string("<A href=\"grid-gui?session=") + linkSession.getUrlParameter() + "&" + ATTR_PAGE + "=" + page + "\">" + text + "</A> ";
+    };
 
-    if (landShadingImage)
-    {
-      delete [] landShadingImage;
-      landShadingImage = nullptr;
-    }
+    uint spanX = columns * step;
+    uint spanY = rows * step;
 
-    if (seaShadingImage)
-    {
-      delete [] seaShadingImage;
-      seaShadingImage = nullptr;
-    }
+    std::string output = "<P style=\"font-size:10pt;\">Grid ";
+    appendNumber(output,width);
+    output += " x ";
+    appendNumber(output,height);
 
-    if (valImage)
-    {
-      delete [] valImage;
-      valImage = nullptr;
-    }
+    // ### An empty grid (e.g. a geometry without coordinates) has no range to show.
 
-    if (landBorderImage)
+    if (width == 0  ||  height == 0)
     {
-      delete [] landBorderImage;
-      landBorderImage = nullptr;
+      output += ", empty</P>\n";
+      return output;
     }
 
+    output += ", columns ";
+    appendNumber(output,x);
+    output += "..";
+    appendNumber(output,std::min(width,x + spanX) - 1);
+    output += ", rows ";
+    appendNumber(output,y);
+    output += "..";
+    appendNumber(output,std::min(height,y + spanY) - 1);
+    output += ", step ";
+    appendNumber(output,step);
+    output += " : ";
 
-    if (params.stream_step > 0)
-    {
-      // Draw stream lines
-
-      T::ParamValue *direction = new float[size];
-      if (!rotate)
-      {
-        uint idx = 0;
-        for (int y=0; y<height; y++)
-        {
-          for (int x=0; x<width; x++)
-          {
-            direction[idx] = values[idx];
-            idx++;
-          }
-        }
-      }
-      else
-      {
-        uint idx = 0;
-        for (int y=0; y<height; y++)
-        {
-          uint idx2 = (height-y-1) * width;
-          for (int x=0; x<width; x++)
-          {
-            direction[idx] = values[idx2];
-            idx++;
-            idx2++;
-          }
-        }
-      }
-
-      //uint *img = finalImage; //imagePaint.getImage();
-      uint *streamImage = new uint[size];
-
-      getStreamlineImage(direction,nullptr,streamImage,width,height,params.stream_step,params.stream_step,params.stream_minLength,params.stream_maxLength);
-
-      uint lcolmax = 0xD0;
-      uint lcolors = 16;
-      uint color[lcolors];
-
-      uint sc = params.stream_color & 0x00FFFFFF;
-
-      double mp = (double)lcolmax / (double)lcolors;
-      std::vector<int> timeVect;
-      for (uint t=0; t<lcolors; t++)
-      {
-        uint cc = lcolmax - (uint)(t*mp);
-        color[t] = (cc << 24) + sc;
-        timeVect.push_back(50);
-      }
-
-      if (params.stream_animation)
-      {
-        uint *wimage[lcolors];
-        for (uint t=0; t<lcolors; t++)
-          wimage[t] = new uint[size];
-
-        uint idx = 0;
-        for (int y = 0; y < height; y++)
-        {
-          for (int x=0; x < width; x++)
-          {
-            uint streamCol = streamImage[idx];
-            for (uint t=0; t<lcolors; t++)
-            {
-              uint fcol = finalImage[idx];
-
-              if (streamCol != 0)
-              {
-                uint lcol = color[(streamCol-1+t) % lcolors];
-                fcol = merge_ARGB(lcol,fcol);
-              }
-              // ARGB to RGBA
-              uint newCol = (fcol & 0xFF000000) + ((fcol & 0xFF0000) >> 16) + (fcol & 0x00FF00) + ((fcol & 0xFF) << 16);
-              wimage[t][idx] = newCol;
-            }
-            idx++;
-          }
-        }
-
-        webp_anim_save(params.imageFile.c_str(),wimage,width,height,lcolors,timeVect);
-
-        for (uint t=0; t<lcolors; t++)
-        {
-          delete [] wimage[t];
-          wimage[t] = nullptr;
-        }
-
-        delete [] direction;
-        direction = nullptr;
+    output += link("Top-left",0,0,1);
 
-        delete [] streamImage;
-        streamImage = nullptr;
-        return;
-      }
-      else
-      {
-        for (uint t=0; t<size; t++)
-        {
-          uint streamCol = streamImage[t];
-          if (streamCol != 0)
-          {
-            finalImage[t] = merge_ARGB(color[(streamCol-1) % lcolors],finalImage[t]);
-          }
-        }
-      }
-      delete [] direction;
-      direction = nullptr;
+    if (x > 0)
+      output += link("Previous columns",(x > spanX) ? x - spanX : 0,y,step);
 
-      delete [] streamImage;
-      streamImage = nullptr;
-    }
+    if (x + spanX < width)
+      output += link("Next columns",x + spanX,y,step);
 
+    if (y > 0)
+      output += link("Previous rows",x,(y > spanY) ? y - spanY : 0,step);
 
-    if (finalImage)
-    {
-      //jpeg_save(params.imageFile.c_str(),finalImage,height,width,100);
-      png_save(params.imageFile.c_str(),finalImage,width,height,1);
+    if (y + spanY < height)
+      output += link("Next rows",x,y + spanY,step);
 
-      delete [] finalImage;
-      finalImage = nullptr;
-    }
+    output += link("Whole grid",0,0,0);
 
+    if (step > 1)
+      output += link("Full resolution",x,y,1);
 
-    checkImageCache();
+    output += "</P>\n";
+    return output;
   }
   catch (...)
   {
@@ -1336,10 +3404,10 @@ void Plugin::saveImage(ImagePaintParameters& params,
 
 
 
+/*! \brief GridGui: Page table. Shows a window of the grid values (see getTableWindow()).
+ *  The values are read from the cached grid. */
 
-/*! \brief GridGui: Page info. */
-
-int Plugin::page_info(Spine::Reactor &theReactor,
+int Plugin::page_table(Spine::Reactor &theReactor,
                             const HTTP::Request &theRequest,
                             HTTP::Response &theResponse,
                             Session& session)
@@ -1347,154 +3415,263 @@ int Plugin::page_info(Spine::Reactor &theReactor,
   FUNCTION_TRACE
   try
   {
-    auto contentServer = itsGridEngine->getContentServer_sptr();
-    auto dataServer = itsGridEngine->getDataServer_sptr();
-
+    std::string geometryIdStr = session.getAttribute(ATTR_GEOMETRY_ID);
     std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
     std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
 
+    if (fileIdStr.empty())
+      return HTTP::Status::ok;
+
     std::ostringstream ostr;
 
-    T::ContentInfo contentInfo;
-    int result = contentServer->getContentInfo(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),contentInfo);
+    GridValues_sptr grid;
+    int result = getGridValues(toUInt64(fileIdStr),toUInt32(messageIndexStr),0,grid);
     if (result != 0)
     {
       ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getContentInfo : " << result << "\n";
+      ostr << "DataServer request 'getGridData()' failed : " << result << "\n";
       ostr << "</BODY></HTML>\n";
       theResponse.setContent(std::string(ostr.str()));
       theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
       return HTTP::Status::ok;
     }
 
-    T::FileInfo fileInfo;
-    result = contentServer->getFileInfoById(0,contentInfo.mFileId,fileInfo);
-    if (result != 0)
+    T::GeometryId geometryId = grid->geometryId;
+    if (geometryId == 0)
+      geometryId = toInt32(geometryIdStr);
+
+
+    T::Coordinate_svec coordinates = Identification::gridDef.getGridOriginalCoordinatesByGeometryId(geometryId);
+
+    uint height = grid->rows;
+    uint width = grid->columns;
+
+    uint sz = width * height;
+    if (!coordinates  ||  coordinates->size() != sz  ||  grid->values.size() < sz)
     {
       ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getFileInfoById : " << result << "\n";
+      ostr << "Cannot get the grid coordinates\n";
       ostr << "</BODY></HTML>\n";
       theResponse.setContent(std::string(ostr.str()));
       theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
       return HTTP::Status::ok;
     }
 
-    T::GenerationInfo generationInfo;
-    result = contentServer->getGenerationInfoById(0,contentInfo.mGenerationId,generationInfo);
-    if (result != 0)
+    uint x1 = 0, y1 = 0, columns = 0, rows = 0, step = 1;
+    getTableWindow(theRequest,session,width,height,x1,y1,columns,rows,step);
+
+    ValueStats_sptr valueStats = getValueStats(getMessageKey(toUInt64(fileIdStr),toUInt32(messageIndexStr)) + ":0",grid->values);
+    T::ParamValue max = valueStats->maxValue;
+
+    int precision = 3;
+    if (max < 0.00001)
+      precision = 14;
+    else
+    if (max < 0.001)
+      precision = 12;
+    else
+    if (max < 0.1)
+      precision = 6;
+
+    // ### The page is written straight into a preallocated string.
+
+    std::string output;
+    output.reserve(C_UINT(columns + 2) * (rows + 2) * (precision + 16) + 4096);
+
+    output += "<HTML><BODY>\n";
+    output += getTableNavigation(session,"table",width,height,x1,y1,columns,rows,step);
+    output += "<TABLE border=\"1\" style=\"text-align:right; font-size:10pt;\">\n";
+
+
+    // ### Column index header:
+
+    output += "<TR bgColor=\"#E0E0E0\"><TD></TD><TD></TD>";
+    for (uint x=0; x<columns; x++)
     {
-      ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getGenerationInfoById : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
+      output += "<TD>";
+      appendNumber(output,x1 + x*step);
+      output += "</TD>";
     }
+    output += "</TR>\n";
 
-    T::ProducerInfo producerInfo;
-    result = contentServer->getProducerInfoById(0,contentInfo.mProducerId,producerInfo);
-    if (result != 0)
+
+    // ### X coordinate header:
+
+    output += "<TR bgColor=\"#D0D0D0\"><TD></TD><TD></TD>";
+    for (uint x=0; x<columns; x++)
     {
-      ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getProducerInfoById : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
+      output += "<TD>";
+      appendNumber(output,(*coordinates)[y1*width + x1 + x*step].x(),3);
+      output += "</TD>";
     }
+    output += "</TR>\n";
 
-    T::AttributeList attributeList;
-    result = dataServer->getGridAttributeList(0,contentInfo.mFileId,contentInfo.mMessageIndex,attributeList);
-    if (result != 0)
+
+    // ### Rows:
+
+    for (uint y=0; y<rows; y++)
     {
-      ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getGridAttributeList : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
+      uint gy = y1 + y*step;
+      uint c = gy*width + x1;
+
+      // ### Row index and Y coordinate:
+
+      output += "<TR><TD bgColor=\"#E0E0E0\">";
+      appendNumber(output,gy);
+      output += "</TD><TD bgColor=\"#D0D0D0\">";
+      appendNumber(output,(*coordinates)[c].y(),3);
+      output += "</TD>";
+
+      // ### Columns:
+
+      for (uint x=0; x<columns; x++, c += step)
+      {
+        output += "<TD>";
+        if (grid->values[c] != ParamValueMissing)
+          appendNumber(output,grid->values[c],precision);
+        else
+          output += "Null";
+        output += "</TD>";
+      }
+      output += "</TR>\n";
     }
+    output += "</TABLE>\n";
+    output += "</BODY></HTML>\n";
 
+    theResponse.setContent(output);
+    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
 
-    ostr << "<HTML><BODY>\n";
-    ostr << "<TABLE border=\"1\" width=\"100%\" style=\"font-size:14; color:#FFFFFF;\">\n";
+    return HTTP::Status::ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Producer</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
 
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Id</TD><TD>" << producerInfo.mProducerId << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Name</TD><TD>" << producerInfo.mName << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Title</TD><TD>" << producerInfo.mTitle << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Description</TD><TD>" << producerInfo.mDescription << "</TD></TR>\n";
 
-    ostr << "</TABLE></TD></TR>\n";
 
 
+/*! \brief GridGui: Page coordinates. Shows a window of the grid coordinates (see
+ *  getTableWindow()). The coordinates are taken from the shared coordinates of the
+ *  geometry; the whole coordinate list is fetched from the data server only if the
+ *  geometry is not known. */
+
+int Plugin::page_coordinates(Spine::Reactor &theReactor,
+                            const HTTP::Request &theRequest,
+                            HTTP::Response &theResponse,
+                            Session& session)
+{
+  FUNCTION_TRACE
+  try
+  {
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    auto dataServer = itsGridEngine->getDataServer_sptr();
+
+    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
+    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+
+    if (fileIdStr.empty())
+      return HTTP::Status::ok;
+
+    std::ostringstream ostr;
+
+    T::Coordinate_svec coordinates;
+    uint width = 0;
+    uint height = 0;
+
+    T::ContentInfo contentInfo;
+    if (contentServer->getContentInfo(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),contentInfo) == 0  &&  contentInfo.mGeometryId != 0  &&
+        Identification::gridDef.getGridDimensionsByGeometryId(contentInfo.mGeometryId,width,height))
+    {
+      coordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(contentInfo.mGeometryId);
+    }
 
-    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Generation</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+    if (!coordinates  ||  coordinates->size() != C_UINT(width*height))
+    {
+      T::GridCoordinates gridCoordinates;
+      int result = dataServer->getGridCoordinates(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),T::CoordinateTypeValue::LATLON_COORDINATES,gridCoordinates);
+      if (result != 0)
+      {
+        ostr << "<HTML><BODY>\n";
+        ostr << "DataServer request 'getGridCoordinates()' failed : " << result << "\n";
+        ostr << "</BODY></HTML>\n";
+        theResponse.setContent(std::string(ostr.str()));
+        theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+        return HTTP::Status::ok;
+      }
 
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Id</TD><TD>" << generationInfo.mGenerationId << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Name</TD><TD>" << generationInfo.mName << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Description</TD><TD>" << generationInfo.mDescription << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Analysis time</TD><TD>" << generationInfo.mAnalysisTime << "</TD></TR>\n";
-    if (generationInfo.mDeletionTime > 0)
-      ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Deletion time</TD><TD>" << utcTimeFromTimeT(generationInfo.mDeletionTime) << "</TD></TR>\n";
+      width = gridCoordinates.mColumns;
+      height = gridCoordinates.mRows;
+      coordinates = std::make_shared<T::Coordinate_vec>(std::move(gridCoordinates.mCoordinateList));
+    }
 
-    ostr << "</TABLE></TD></TR>\n";
+    if (coordinates->size() < C_UINT(width*height))
+    {
+      width = 0;
+      height = 0;
+    }
 
+    uint x1 = 0, y1 = 0, columns = 0, rows = 0, step = 1;
+    getTableWindow(theRequest,session,width,height,x1,y1,columns,rows,step);
 
+    // ### The page is written straight into a preallocated string.
 
-    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">File</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+    std::string output;
+    output.reserve(C_UINT(columns + 1) * (rows + 1) * 40 + 4096);
 
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Id</TD><TD>" << fileInfo.mFileId << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Server</TD><TD>" << fileInfo.mServer << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Protocol</TD><TD>" << C_INT(fileInfo.mProtocol) << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Type</TD><TD>" << C_INT(fileInfo.mFileType) << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Name</TD><TD>" << fileInfo.mName << "</TD></TR>\n";
-    if (fileInfo.mDeletionTime > 0)
-      ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Deletion time</TD><TD>" << utcTimeFromTimeT(fileInfo.mDeletionTime) << "</TD></TR>\n";
+    output += "<HTML><BODY>\n";
+    output += getTableNavigation(session,"coordinates",width,height,x1,y1,columns,rows,step);
+    output += "<TABLE border=\"1\" style=\"text-align:right; font-size:10pt;\">\n";
 
-    ostr << "</TABLE></TD></TR>\n";
 
+    // ### Column index header:
 
+    output += "<TR bgColor=\"#E0E0E0\"><TD></TD>";
+    for (uint x=0; x<columns; x++)
+    {
+      output += "<TD>";
+      appendNumber(output,x1 + x*step);
+      output += "</TD>";
+    }
+    output += "</TR>\n";
 
-    ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Parameter</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
 
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Message index</TD><TD>" << contentInfo.mMessageIndex << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">File Position</TD><TD>" << contentInfo.mFilePosition << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Size</TD><TD>" << contentInfo.mMessageSize << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Forecast time</TD><TD>" << contentInfo.getForecastTime() << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Level</TD><TD>" << contentInfo.mParameterLevel << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">FMI identifier</TD><TD>" << contentInfo.mFmiParameterId << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">FMI name</TD><TD>" << contentInfo.getFmiParameterName() << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">FMI level identifier</TD><TD>" << toString(contentInfo.mFmiParameterLevelId) << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Forecast type</TD><TD>" << contentInfo.mForecastType << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Forecast number</TD><TD>" << contentInfo.mForecastNumber << "</TD></TR>\n";
-    ostr << "<TR><TD width=\"180\" bgColor=\"#E0E0E0\">Geometry identifier</TD><TD>" << contentInfo.mGeometryId << "</TD></TR>\n";
+    // ### Rows:
 
-    ostr << "</TABLE></TD></TR>\n";
+    for (uint y=0; y<rows; y++)
+    {
+      uint gy = y1 + y*step;
+      uint c = gy*width + x1;
 
+      // ### Row index:
 
-    uint len = attributeList.getLength();
-    if (len > 0)
-    {
-      ostr << "<TR><TD bgColor=\"#000080\" width=\"100\">Attributes</TD><TD><TABLE border=\"1\" width=\"100%\" style=\"font-size:12;\">\n";
+      output += "<TR><TD bgColor=\"#E0E0E0\">";
+      appendNumber(output,gy);
+      output += "</TD>";
 
-      for (uint t=0; t<len; t++)
+      // ### Columns:
+
+      for (uint x=0; x<columns; x++, c += step)
       {
-        T::Attribute *attr = attributeList.getAttributeByIndex(t);
-        ostr << "<TR><TD>" << attr->mName << " = " << attr->mValue << "</TD></TR>\n";
+        const T::Coordinate& coordinate = (*coordinates)[c];
+        output += "<TD>";
+        appendNumber(output,coordinate.y(),8);
+        output += ",";
+        appendNumber(output,coordinate.x(),8);
+        output += "</TD>";
       }
-      ostr << "</TABLE></TD></TR>\n";
+      output += "</TR>\n";
     }
+    output += "</TABLE>\n";
+    output += "</BODY></HTML>\n";
 
-
-    ostr << "</TABLE>\n";
-
-    ostr << "</BODY></HTML>\n";
-
-
-    theResponse.setContent(std::string(ostr.str()));
+    theResponse.setContent(output);
     theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+
     return HTTP::Status::ok;
   }
   catch (...)
@@ -1509,9 +3686,9 @@ int Plugin::page_info(Spine::Reactor &theReactor,
 
 
 
-/*! \brief GridGui: Page message. */
+/*! \brief GridGui: Page value. */
 
-int Plugin::page_message(Spine::Reactor &theReactor,
+int Plugin::page_value(Spine::Reactor &theReactor,
                             const HTTP::Request &theRequest,
                             HTTP::Response &theResponse,
                             Session& session)
@@ -1519,111 +3696,147 @@ int Plugin::page_message(Spine::Reactor &theReactor,
   FUNCTION_TRACE
   try
   {
+    auto contentServer = itsGridEngine->getContentServer_sptr();
     auto dataServer = itsGridEngine->getDataServer_sptr();
 
-    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
-    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+    T::FileId fileId = session.getUInt64Attribute(ATTR_FILE_ID);
+    T::MessageIndex messageIndex = session.getUIntAttribute(ATTR_MESSAGE_INDEX);
+    float xPos = session.getDoubleAttribute(ATTR_X);
+    float yPos = session.getDoubleAttribute(ATTR_Y);
 
-    if (fileIdStr.empty())
+    if (fileId == 0)
       return HTTP::Status::ok;
 
+    T::ContentInfo contentInfo;
+    if (contentServer->getContentInfo(0,fileId,messageIndex,contentInfo) != 0)
+      return HTTP::Status::ok;
 
-    std::ostringstream ostr;
+    if (contentInfo.mGeometryId == 0)
+      return HTTP::Status::ok;
 
-    std::vector<uchar> messageBytes;
-    std::vector<uint> messageSections;
-    int result = dataServer->getGridMessageBytes(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),messageBytes,messageSections);
-    if (result != 0)
+    T::GeometryId projectionId = toInt32(session.getAttribute(ATTR_PROJECTION_ID));
+
+    if (projectionId > 0  &&  projectionId != contentInfo.mGeometryId)
     {
-      ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getGridMessageBytes : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
-    }
+      // Image was rendered using the projection geometry's grid layout.  Map the click
+      // to the projection cell using the same row-orientation logic as saveImage(),
+      // look up the cell's latlon, and query the data by latlon so interpolation crosses
+      // geometries correctly.
 
-    uint size = messageBytes.size();
-    uint ssize = messageSections.size();
+      uint cols = 0;
+      uint rows = 0;
 
-    uint rows = size / 16;
-    if ((size % 16) != 0)
-      rows++;
+      if (!Identification::gridDef.getGridDimensionsByGeometryId(projectionId,cols,rows))
+        return HTTP::Status::ok;
 
-    if (rows > 1000)
-      rows = 1000;
+      T::Coordinate_svec latLonCoordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(projectionId);
+      if (!latLonCoordinates  ||  latLonCoordinates->size() < static_cast<std::size_t>(cols) * rows)
+        return HTTP::Status::ok;
 
-    char tmp[2000];
-    char tmp2[2000];
-    char *p = tmp;
+      const auto& coords = *latLonCoordinates;
 
-    ostr << "<HTML><BODY>\n";
-    ostr << "<TABLE border=\"1\" style=\"font-family:Arial; font-size:14; color:#000000; background:#FFFFFF;\">\n";
-    ostr << "<TR bgColor=\"#A0A0A0\"><TD width=\"50\">Address</TD>";
+      // Same rotate test as Plugin::saveImage(): if rows run south-to-north in the
+      // coordinate array, the image is flipped vertically so that north is at the top.
+      bool rotate = true;
+      if (coords.size() > C_UINT(10*cols)  &&  coords[0].y() < coords[10*cols].y())
+        rotate = true;
+      else
+        rotate = false;
 
+      int col = static_cast<int>(xPos * cols);
+      int row = static_cast<int>(yPos * rows);
+      if (col < 0) col = 0;
+      if (col >= static_cast<int>(cols)) col = static_cast<int>(cols) - 1;
+      if (row < 0) row = 0;
+      if (row >= static_cast<int>(rows)) row = static_cast<int>(rows) - 1;
 
-    for (uint c=0; c<16; c++)
-      p += sprintf(p,"<TD width=\"20\" align=\"center\">%02X</TD>",c);
+      int dataRow = rotate ? static_cast<int>(rows) - row - 1 : row;
+      std::size_t idx = static_cast<std::size_t>(dataRow) * cols + static_cast<std::size_t>(col);
 
-    p += sprintf(p,"<TD width=\"20\"></TD>");
+      // If the projected grid has been loaded for the image, the value is taken from
+      // the same grid that was painted.
 
-    for (uint c=0; c<16; c++)
-      p += sprintf(p,"<TD width=\"20\" align=\"center\">%02X</TD>",c);
+      T::ParamValue value = 0;
+      GridValues_sptr grid;
+      std::string valueKey = getMessageKey(fileId,messageIndex) + ":" + std::to_string(projectionId);
+      if (itsGridValueCache.get(valueKey,grid)  &&  idx < grid->values.size())
+      {
+        value = grid->values[idx];
+      }
+      else
+      {
+        double_vec modificationParameters;
+        const auto& p = coords[idx];
+        dataServer->getGridValueByPoint(0,fileId,messageIndex,T::CoordinateTypeValue::LATLON_COORDINATES,p.x(),p.y(),T::AreaInterpolationMethod::Linear,0,modificationParameters,value);
+      }
 
-    ostr << tmp;
-    ostr << "</TR>";
+      if (value != ParamValueMissing)
+        theResponse.setContent(std::to_string(value));
+      else
+        theResponse.setContent(std::string("Not available"));
 
-    std::string color;
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
+    }
 
-    uint cnt = 0;
-    uint scnt = 0;
-    for (uint r=0; r<rows; r++)
-    {
-      uint a = r*16;
-      char *p = tmp;
-      char *p2 = tmp2;
-      p2 += sprintf(p2,"<TD bgColor=\"#C0C0C0\"></TD>");
+    uint cols = 0;
+    uint rows = 0;
 
-      p += sprintf(p,"<TR><TD bgColor=\"#C0C0C0\" width=\"50\">%08X</TD>",a);
-      for (uint c=0; c<16; c++)
-      {
-        if (scnt < ssize  &&  cnt == messageSections[scnt])
-        {
-          if ((scnt % 2) == 1)
-            color = " bgColor=\"E0E0E0\"";
-          else
-            color = "";
+    if (!Identification::gridDef.getGridDimensionsByGeometryId(contentInfo.mGeometryId,cols,rows))
+      return HTTP::Status::ok;
 
-          scnt++;
-        }
+    uint height = rows;
+    uint width = cols;
 
-        if (cnt < size)
-        {
-          p += sprintf(p,"<TD width=\"20\"%s>%02X</TD>",color.c_str(),messageBytes[cnt]);
+    double dWidth = C_DOUBLE(width);
+    double dHeight = C_DOUBLE(height);
 
-          if (isalnum(messageBytes[cnt]))
-            p2 += sprintf(p2,"<TD%s>%c</TD>",color.c_str(),messageBytes[cnt]);
-          else
-            p2 += sprintf(p2,"<TD%s>.</TD>",color.c_str());
-        }
-        else
-        {
-          p += sprintf(p,"<TD width=\"20\"%s></TD>",color.c_str());
-          p2 += sprintf(p2,"<TD%s>.</TD>",color.c_str());
-        }
+    bool reverseXDirection = false;
+    bool reverseYDirection = false;
 
-        cnt++;
-      }
-      p += sprintf(p,"%s</TR>\n",tmp2);
-      ostr << tmp;
-    }
+    if (!Identification::gridDef.getGridDirectionsByGeometryId(contentInfo.mGeometryId,reverseXDirection,reverseYDirection))
+      return HTTP::Status::ok;
 
-    ostr << "</TABLE>\n";
+    double xx = xPos * dWidth;
+    double yy = yPos * dHeight;
 
-    ostr << "</BODY></HTML>\n";
+    if (!reverseYDirection)
+      yy = dHeight - (yPos * dHeight);
+
+    if (reverseXDirection)
+      xx = dWidth - (xPos * dWidth);
+
+    // ### The nearest grid value is taken from the grid value cache if the grid has
+    // ### already been loaded. A single value is not worth loading the whole grid.
+
+    T::ParamValue value = 0;
+    GridValues_sptr grid;
+    std::string valueKey = getMessageKey(fileId,messageIndex) + ":0";
+    if (itsGridValueCache.get(valueKey,grid)  &&  grid->columns == width  &&  grid->rows == height)
+    {
+      int x = C_INT(floor(xx + 0.5));
+      int y = C_INT(floor(yy + 0.5));
+
+      if (x < 0) x = 0;
+      if (x >= C_INT(width)) x = C_INT(width) - 1;
+      if (y < 0) y = 0;
+      if (y >= C_INT(height)) y = C_INT(height) - 1;
+
+      value = grid->values[C_UINT(y)*width + C_UINT(x)];
+    }
+    else
+    {
+      double_vec modificationParameters;
+      dataServer->getGridValueByPoint(0,fileId,messageIndex,T::CoordinateTypeValue::GRID_COORDINATES,xx,yy,T::AreaInterpolationMethod::Nearest,0,modificationParameters,value);
+    }
+
+    if (value != ParamValueMissing)
+      theResponse.setContent(std::to_string(value));
+    else
+      theResponse.setContent(std::string("Not available"));
 
-    theResponse.setContent(std::string(ostr.str()));
     theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+
     return HTTP::Status::ok;
   }
   catch (...)
@@ -1637,10 +3850,13 @@ int Plugin::page_message(Spine::Reactor &theReactor,
 
 
 
+/*! \brief GridGui: Page values. Returns the values of many points as a JSON array
+ *  (null = missing value). The points are given as normalized image coordinates
+ *  "x1,y1,x2,y2,..." (pts) and/or as lat/lon coordinates "lon1,lat1,lon2,lat2,..."
+ *  (ll); the values of the image points come first. The values are read from the
+ *  same cached grid that is painted into the image. */
 
-/*! \brief GridGui: Page download. */
-
-int Plugin::page_download(Spine::Reactor &theReactor,
+int Plugin::page_values(Spine::Reactor &theReactor,
                             const HTTP::Request &theRequest,
                             HTTP::Response &theResponse,
                             Session& session)
@@ -1648,61 +3864,120 @@ int Plugin::page_download(Spine::Reactor &theReactor,
   FUNCTION_TRACE
   try
   {
-    auto dataServer = itsGridEngine->getDataServer_sptr();
+    T::FileId fileId = session.getUInt64Attribute(ATTR_FILE_ID);
+    T::MessageIndex messageIndex = session.getUIntAttribute(ATTR_MESSAGE_INDEX);
+    T::GeometryId projectionId = toInt32(session.getAttribute(ATTR_PROJECTION_ID));
+    std::string presentation = session.getAttribute(ATTR_PRESENTATION);
+    std::string areaStr = session.getAttribute(ATTR_AREA);
 
-    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
-    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+    auto getList = [&](const char *name,std::vector<double>& list)
+    {
+      std::vector<std::string> partList;
+      splitString(getRequestAttribute(theRequest,session,name),',',partList);
+      for (auto it = partList.begin(); it != partList.end(); ++it)
+        list.push_back(toDouble(*it));
+    };
 
-    std::ostringstream ostr;
+    std::vector<double> points;
+    std::vector<double> latlon;
+    getList(ATTR_POINTS,points);
+    getList(ATTR_LATLON,latlon);
 
-    std::vector<uchar> messageBytes;
-    std::vector<uint> messageSections;
-    int result = dataServer->getGridMessageBytes(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),messageBytes,messageSections);
-    if (result != 0)
-    {
-      ostr << "<HTML><BODY>\n";
-      ostr << "ERROR: getGridMessageBytes : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
-    }
+    if ((points.size() + latlon.size()) > 2*VALUES_MAX_POINTS)
+      return HTTP::Status::bad_request;
 
-    uint sz = messageBytes.size();
-    if (sz > 0)
+    T::ParamValue_vec values;
+
+    if (fileId != 0  &&  (points.size() >= 2  ||  latlon.size() >= 2))
     {
-      std::vector<char> *content = new std::vector<char>();
-      content->reserve(sz);
+      GridValues_sptr grid;
+      int result = getGridValues(fileId,messageIndex,0,grid);
+      if (result == 0  &&  projectionId > 0  &&  projectionId != grid->geometryId)
+        result = getGridValues(fileId,messageIndex,projectionId,grid);
+
+      if (result != 0)
+      {
+        Fmi::Exception exception(BCP,"Data fetching failed!");
+        exception.addParameter("Result",DataServer::getResultString(result));
+        throw exception;
+      }
 
-      std::shared_ptr<std::vector<char>> sContent;
-      sContent.reset(content);
+      T::GeometryId geometryId = grid->geometryId;
+      int width = grid->columns;
+      int height = grid->rows;
 
-      for (uint t=0; t<sz; t++)
+      if (points.size() >= 2  &&  width > 0  &&  height > 0  &&  grid->values.size() >= C_UINT(width*height))
       {
-        uchar ch = messageBytes[t];
-        char *c = (char*)&ch;
+        T::Coordinate_svec coordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(geometryId);
+
+        // ### The same row order and crop area as in the image.
+
+        bool rotate = false;
+        if (coordinates  &&  coordinates->size() > C_UINT(10*width)  &&  (*coordinates)[0].y() < (*coordinates)[10*width].y())
+          rotate = true;
+
+        int x1 = 0, y1 = 0, x2 = width, y2 = height;
+        if (!areaStr.empty()  &&  presentation != "Tiles"  &&  coordinates)
+        {
+          ImagePaintParameters params;
+          params.image_area = areaStr;
+          int status = getImageArea(params,width,height,*coordinates,x1,y1,x2,y2);
+          if (status != HTTP::Status::ok)
+            return status;
+        }
+
+        for (std::size_t t=0; t+1<points.size(); t += 2)
+        {
+          double px = points[t];
+          double py = points[t+1];
+          if (!(px >= 0  &&  px <= 1  &&  py >= 0  &&  py <= 1))
+          {
+            values.push_back(ParamValueMissing);
+            continue;
+          }
+
+          int col = std::min(x2-1,x1 + C_INT(px * (x2-x1)));
+          int row = std::min(y2-y1-1,C_INT(py * (y2-y1)));
+          int dataRow = rotate ? y2 - row - 1 : y1 + row;
 
-        content->emplace_back(*c);
+          values.push_back(grid->values[C_UINT(dataRow)*width + col]);
+        }
       }
 
-      content->emplace_back('7');
-      content->emplace_back('7');
-      content->emplace_back('7');
-      content->emplace_back('7');
+      if (latlon.size() >= 2)
+      {
+        T::Coordinate_vec coordinates;
+        for (std::size_t t=0; t+1<latlon.size(); t += 2)
+          coordinates.emplace_back(latlon[t],latlon[t+1]);
+
+        // ### The lat/lon points are interpolated linearly like in the projected images.
+
+        T::ParamValue_vec pointValues(coordinates.size(),ParamValueMissing);
+        ReprojectionTable table;
+        if (createReprojectionTable(geometryId,coordinates,table)  &&  grid->values.size() >= C_UINT(table.sourceColumns*table.sourceRows))
+          reproject(table,grid->values,0,coordinates.size(),pointValues.data());
 
-      std::string val = "attachment; filename=message_" + fileIdStr + "_" + messageIndexStr + ".grib";
-      theResponse.setHeader("Content-Disposition",val);
-      theResponse.setContent(sContent);
+        values.insert(values.end(),pointValues.begin(),pointValues.end());
+      }
     }
-    else
+
+    std::ostringstream output;
+    output << "[";
+    for (std::size_t t=0; t<values.size(); t++)
     {
-      std::ostringstream ostr;
-      ostr << "<HTML><BODY>\n";
-      ostr << "Message does not exist!\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      theResponse.setContent(std::string(ostr.str()));
+      if (t > 0)
+        output << ",";
+
+      if (values[t] != ParamValueMissing  &&  values[t] == values[t])
+        output << std::to_string(values[t]);
+      else
+        output << "null";
     }
+    output << "]";
+
+    theResponse.setContent(output.str());
+    theResponse.setHeader("Content-Type", "application/json; charset=UTF-8");
+
     return HTTP::Status::ok;
   }
   catch (...)
@@ -1717,9 +3992,15 @@ int Plugin::page_download(Spine::Reactor &theReactor,
 
 
 
-/*! \brief GridGui: Page table. */
 
-int Plugin::page_table(Spine::Reactor &theReactor,
+/*! \brief GridGui: Page raster. Returns the values of the displayed grid as a binary
+ *  value raster (see value_raster_encode()) that is aligned with the image: the same
+ *  crop area, size reduction and row order. A reduced raster contains the grid values
+ *  at the block centers (not averages). The format (rf) is "f32" (default), "f16" or
+ *  "q16". The page can read the values under the cursor from the raster without
+ *  asking them from the server. */
+
+int Plugin::page_raster(Spine::Reactor &theReactor,
                             const HTTP::Request &theRequest,
                             HTTP::Response &theResponse,
                             Session& session)
@@ -1727,144 +4008,202 @@ int Plugin::page_table(Spine::Reactor &theReactor,
   FUNCTION_TRACE
   try
   {
-    auto dataServer = itsGridEngine->getDataServer_sptr();
-
-    std::string geometryIdStr = session.getAttribute(ATTR_GEOMETRY_ID);
     std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
     std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+    std::string geometryIdStr = session.getAttribute(ATTR_GEOMETRY_ID);
+    std::string projectionIdStr = session.getAttribute(ATTR_PROJECTION_ID);
+    std::string imageWidthStr = session.getAttribute(ATTR_IMAGE_WIDTH);
+    std::string imageHeightStr = session.getAttribute(ATTR_IMAGE_HEIGHT);
+    std::string areaStr = session.getAttribute(ATTR_AREA);
 
-    char tmp[1000];
+    std::string formatStr = getRequestAttribute(theRequest,session,ATTR_RASTER_FORMAT);
 
-    if (fileIdStr.empty())
-      return HTTP::Status::ok;
+    uint format = VALUE_RASTER_FLOAT32;
+    if (strcasecmp(formatStr.c_str(),"f16") == 0)
+      format = VALUE_RASTER_FLOAT16;
+    else
+    if (strcasecmp(formatStr.c_str(),"q16") == 0)
+      format = VALUE_RASTER_QUANTIZED16;
 
-    std::ostringstream ostr;
+    if (projectionIdStr.empty())
+      projectionIdStr = geometryIdStr;
 
-    T::GridData gridData;
-    int result = dataServer->getGridData(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),gridData);
-    if (result != 0)
-    {
-      ostr << "<HTML><BODY>\n";
-      ostr << "DataServer request 'getGridData()' failed : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
-    }
+    T::FileId fileId = toUInt64(fileIdStr);
+    T::MessageIndex messageIndex = toUInt32(messageIndexStr);
+    T::GeometryId projectionId = toInt32(projectionIdStr);
 
-    T::GeometryId geometryId = gridData.mGeometryId;
-    if (geometryId == 0)
-      geometryId = toInt32(geometryIdStr);
+    if (fileId == 0)
+      return HTTP::Status::not_found;
 
+    std::string hash = "Raster:" + getMessageKey(fileId,messageIndex) + ":" + projectionIdStr + ":" +
+      imageWidthStr + ":" + imageHeightStr + ":" + areaStr + ":" + std::to_string(format);
 
-    T::Coordinate_svec coordinates = Identification::gridDef.getGridOriginalCoordinatesByGeometryId(geometryId);
+    const std::size_t seed = Fmi::hash(hash);
+    std::string seedStr = std::to_string(seed);
+    theResponse.setHeader("ETag",seedStr);
 
-    uint c = 0;
-    uint height = gridData.mRows;
-    uint width = gridData.mColumns;
+    if (auto status = conditionalResponseStatus(theRequest, seedStr))
+      return *status;
 
-    uint sz = width * height;
-    if (coordinates->size() != sz)
+    ImageData image;
+    if (itsImageMemoryCache.getImage(hash,image))
     {
-      ostr << "<HTML><BODY>\n";
-      ostr << "Cannot get the grid coordinates\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      setImageResponse(image,theResponse);
       return HTTP::Status::ok;
     }
 
-    if (width > 100)
-      width = 100;
+    GridValues_sptr grid;
+    int result = getGridValues(fileId,messageIndex,0,grid);
+    if (result == 0  &&  projectionId > 0  &&  projectionId != grid->geometryId)
+      result = getGridValues(fileId,messageIndex,projectionId,grid);
 
-    if (height > 100)
-      height = 100;
+    if (result != 0)
+    {
+      Fmi::Exception exception(BCP,"Data fetching failed!");
+      exception.addParameter("Result",DataServer::getResultString(result));
+      throw exception;
+    }
 
-    ostr << "<HTML><BODY>\n";
-    ostr << "<TABLE border=\"1\" style=\"text-align:right; font-size:10pt;\">\n";
+    int width = grid->columns;
+    int height = grid->rows;
+    if (width <= 0 || height <= 0 || grid->values.size() < C_UINT(width*height))
+      return HTTP::Status::not_found;
 
+    T::Coordinate_vec coordinates;
+    T::Coordinate_svec coords = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(grid->geometryId);
+    if (coords)
+      coordinates = *coords;
 
-    // ### Column index header:
+    // ### The same row order, crop area and size reduction as in the image.
 
-    ostr << "<TR bgColor=\"#E0E0E0\"><TD></TD><TD></TD>";
-    for (uint x=0; x<width; x++)
-    {
-      ostr << "<TD>" << x << "</TD>";
-    }
-    ostr << "</TR>\n";
+    bool rotate = (coordinates.size() > C_UINT(10*width)  &&  coordinates[0].y() < coordinates[10*width].y());
 
+    // ### The raster is probed for the value under the cursor, so it must contain the
+    // ### actual grid values. Averaging would also mix the directions of the streams
+    // ### (350 and 10 degrees give 180), so the blocks are decimated like in streams.
 
-    // ### X coordinate header:
+    ImagePaintParameters params;
+    params.stream_step = 1;
+    params.zeroIsMissing = false;
+    params.image_maxWidth = imageWidthStr.empty() ? 0 : toUInt32(imageWidthStr);
+    params.image_maxHeight = imageHeightStr.empty() ? 0 : toUInt32(imageHeightStr);
+    params.image_area = areaStr;
 
-    ostr << "<TR bgColor=\"#D0D0D0\"><TD></TD><TD></TD>";
-    for (uint x=0; x<width; x++)
+    int x1 = 0, y1 = 0, x2 = width, y2 = height;
+    if (!areaStr.empty())
     {
-      sprintf(tmp,"%.3f",(*coordinates)[x].x());
-      ostr << "<TD>" << tmp << "</TD>";
+      int status = getImageArea(params,width,height,coordinates,x1,y1,x2,y2);
+      if (status != HTTP::Status::ok)
+        return status;
     }
-    ostr << "</TR>\n";
 
+    uint factor = getDownsampleFactor(params,x2-x1,y2-y1);
+
+    // ### The size of the raster is checked before the grid is downsampled, so that an
+    // ### oversized request is rejected without allocating the downsampled grid.
 
-    T::ParamValue max = ParamValueMissing;
-    uint vcnt = gridData.mValues.size();
-    for (uint t=0; t<vcnt; t++)
+    int f = C_INT(factor);
+    int newWidth = (x2 - x1 + f - 1) / f;
+    int newHeight = (y2 - y1 + f - 1) / f;
+    if ((std::size_t)newWidth * (std::size_t)newHeight > 100000000)
+      return HTTP::Status::bad_request;
+
+    T::ParamValue_vec newValues;
+    const T::ParamValue *values = grid->values.data();
+
+    if (factor > 1  ||  newWidth != width  ||  newHeight != height)
     {
-      if (gridData.mValues[t] != ParamValueMissing  &&  (max == ParamValueMissing ||  gridData.mValues[t] > max))
-        max = gridData.mValues[t];
+      T::Coordinate_vec noCoordinates;
+      T::Coordinate_vec newCoordinates;
+      T::Coordinate_vec newLineCoordinates;
+      downsampleGrid(params,factor,width,height,x1,y1,x2,y2,grid->values,noCoordinates,nullptr,newWidth,newHeight,newValues,newCoordinates,newLineCoordinates);
+      values = newValues.data();
     }
 
-    std::string formatStr;
-    if (max < 0.00001)
-      formatStr = "%.14f";
-    else
-    if (max < 0.001)
-      formatStr = "%.12f";
-    else
-    if (max < 0.1)
-      formatStr = "%.6f";
-    else
-      formatStr = "%.3f";
+    image.content.reset(new std::vector<char>());
+    image.contentType = "application/octet-stream";
+    value_raster_encode(values,newWidth,newHeight,rotate,format,*image.content);
 
-    // ### Rows:
+    itsImageMemoryCache.addImage(hash,image);
+    setImageResponse(image,theResponse);
 
-    for (uint y=0; y<height; y++)
-    {
-      c = y*gridData.mColumns;
+    return HTTP::Status::ok;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-      // ### Row index and Y coordinate:
 
-      sprintf(tmp,"%.3f",(*coordinates)[c].y());
-      ostr << "<TR><TD bgColor=\"#E0E0E0\">" << y << "</TD><TD bgColor=\"#D0D0D0\">" << tmp << "</TD>";
 
-      // ### Columns:
 
-      for (uint x=0; x<width; x++)
-      {
-        ostr << "<TD>";
-        if (c < sz)
-        {
-          if (gridData.mValues[c] != ParamValueMissing)
-          {
-            sprintf(tmp,formatStr.c_str(),gridData.mValues[c]);
-            ostr << tmp;
-          }
-          else
-          {
-            ostr << "Null";
-          }
-        }
-        c++;
-        ostr << "</TD>";
-      }
-      ostr << "</TR>\n";
+
+
+/*! \brief GridGui: Load image. Small image files are read into the memory and large
+ *  ones are memory-mapped. The image is also stored into the in-memory image cache
+ *  under the given hash. */
+
+bool Plugin::loadImage(const char *fname,const std::string& hash,ImageData& image)
+{
+  FUNCTION_TRACE
+  try
+  {
+    // ### The cache files are replaced only by renaming, which keeps the existing
+    // ### mappings valid.
+
+    MappedFile_sptr mappedFile(new MappedFile());
+    if (!mappedFile->open(fname))
+      return false;
+
+    if (!ImageFileCache::isCompleteImage(mappedFile->getData(),mappedFile->getSize()))
+      return false;
+
+    // ### Small images are copied into the heap once and then handed to the responses
+    // ### as they are. Only large images are streamed from the mapping in chunks.
+
+    if (mappedFile->getSize() < IMAGE_MAPPING_MIN_SIZE)
+    {
+      image.content.reset(new std::vector<char>(mappedFile->getData(),mappedFile->getData() + mappedFile->getSize()));
+      image.mappedFile.reset();
     }
-    ostr << "</TABLE>\n";
-    ostr << "</BODY></HTML>\n";
+    else
+    {
+      image.content.reset();
+      image.mappedFile = mappedFile;
+    }
+    image.contentType = "image/png";
+    if (strstr(fname,".webp") != nullptr)
+      image.contentType = "image/webp";
 
-    theResponse.setContent(std::string(ostr.str()));
-    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+    itsImageMemoryCache.addImage(hash,image);
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-    return HTTP::Status::ok;
+
+
+
+
+/*! \brief GridGui: Get image file name. The image files are content-addressed, so
+ *  the same render key maps to the same file also after a restart. */
+
+std::string Plugin::getImageFileName(const std::string& hash,const char *fileExt)
+{
+  FUNCTION_TRACE
+  try
+  {
+    char tmp[32];
+    snprintf(tmp,sizeof(tmp),"%016llx",static_cast<unsigned long long>(Fmi::hash(hash)));
+    return itsImageCache_dir + "/grid-gui-image_" + tmp + fileExt;
   }
   catch (...)
   {
@@ -1878,102 +4217,136 @@ int Plugin::page_table(Spine::Reactor &theReactor,
 
 
 
-/*! \brief GridGui: Page coordinates. */
+/*! \brief GridGui: Get cached image. The in-memory cache is checked first and the
+ *  image cache directory second.  Returns false if the image is in neither. */
 
-int Plugin::page_coordinates(Spine::Reactor &theReactor,
-                            const HTTP::Request &theRequest,
-                            HTTP::Response &theResponse,
-                            Session& session)
+bool Plugin::getCachedImage(const std::string& hash,const char *fileExt,ImageData& image)
 {
   FUNCTION_TRACE
   try
   {
-    auto dataServer = itsGridEngine->getDataServer_sptr();
+    std::string fname = getImageFileName(hash,fileExt);
 
-    std::string fileIdStr = session.getAttribute(ATTR_FILE_ID);
-    std::string messageIndexStr = session.getAttribute(ATTR_MESSAGE_INDEX);
+    if (itsImageMemoryCache.getImage(hash,image))
+    {
+      itsImageFileCache.touchFile(fname);
+      return true;
+    }
+
+    if (itsImageFileCache.touchFile(fname))
+    {
+      if (loadImage(fname.c_str(),hash,image))
+        return true;
 
-    char tmp[1000];
+      // ### The file has disappeared from the cache directory (or it is corrupted).
 
-    if (fileIdStr.empty())
-      return HTTP::Status::ok;
+      itsImageFileCache.removeFile(fname);
+      return false;
+    }
 
-    std::ostringstream ostr;
+    // ### The image might have been rendered before the restart although the cache
+    // ### directory scan has not indexed it yet.
 
-    T::GridCoordinates coordinates;
-    int result = dataServer->getGridCoordinates(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),T::CoordinateTypeValue::LATLON_COORDINATES,coordinates);
-    if (result != 0)
+    if (loadImage(fname.c_str(),hash,image))
     {
-      ostr << "<HTML><BODY>\n";
-      ostr << "DataServer request 'getGridCoordinates()' failed : " << result << "\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
+      itsImageFileCache.addFile(fname,image.size());
+      return true;
     }
 
+    return false;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-    uint c = 0;
-    uint height = coordinates.mRows;
-    uint width = coordinates.mColumns;
 
-    if (width > 100)
-      width = 100;
 
-    if (height > 100)
-      height = 100;
 
-    ostr << "<HTML><BODY>\n";
-    ostr << "<TABLE border=\"1\" style=\"text-align:right; font-size:10pt;\">\n";
 
+/*! \brief GridGui: Scan the image cache directory. The image files that were rendered
+ *  before the restart (or by other processes sharing the directory) are added into
+ *  the index (newest first) so that they can be reused and evicted normally.
+ *  Incomplete files, files with unknown names, abandoned temporary and lock files
+ *  and files older than imageCache.maxAge seconds are removed. */
 
-    // ### Column index header:
+void Plugin::scanImageCache()
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::vector<std::string> filePatterns;
+    std::set<std::string> dirList;
+    std::vector<std::pair<std::string,std::string>> fileList;
 
-    ostr << "<TR bgColor=\"#E0E0E0\"><TD></TD>";
-    for (uint x=0; x<width; x++)
-    {
-      ostr << "<TD>" << x << "</TD>";
-    }
-    ostr << "</TR>\n";
+    filePatterns.emplace_back(std::string("grid-gui-image_*"));
 
+    getFileList(itsImageCache_dir.c_str(),filePatterns,false,dirList,fileList);
 
-    // ### Rows:
+    time_t now = time(nullptr);
+    std::vector<std::pair<time_t,std::string>> validFiles;
 
-    for (uint y=0; y<height; y++)
+    for (auto it = fileList.begin(); it != fileList.end() && !itsShutdownRequested; ++it)
     {
-      c = y*coordinates.mColumns;
-
-      // ### Row index and Y coordinate:
+      std::string fname = itsImageCache_dir + "/" + it->second;
+      time_t modificationTime = getFileModificationTime(fname.c_str());
 
-      ostr << "<TR><TD bgColor=\"#E0E0E0\">" << y << "</TD>";
+      if (ImageFileCache::isWorkFile(it->second))
+      {
+        // ### Temporary and lock files are removed only when their owner has obviously
+        // ### crashed.
 
-      // ### Columns:
+        if ((modificationTime + static_cast<time_t>(itsImageCache_renderTimeout + IMAGE_LOCK_STALE_MARGIN)) < now)
+          remove(fname.c_str());
+      }
+      else if (itsImageCache_maxAge > 0  &&  (modificationTime + static_cast<time_t>(itsImageCache_maxAge)) < now)
+      {
+        // ### The image is too old. It is removed even if it has been used recently.
 
-      for (uint x=0; x<width; x++)
+        itsImageFileCache.removeFile(fname);
+        remove(fname.c_str());
+        itsImageMemoryCache.removeMappedFile(fname);
+      }
+      else if ((modificationTime + 60) < now  &&  !itsImageFileCache.containsFile(fname))
       {
-        ostr << "<TD>";
-        if (c < coordinates.mCoordinateList.size())
+        // ### Files modified during the last minute might still be under construction.
+
+        // ### The name must be "grid-gui-image_<16 hex digits>.png|.webp". Other files
+        // ### are leftovers from earlier versions of the plugin.
+
+        const char *name = it->second.c_str();
+        const char *ext = name + 31;
+        bool validName = (it->second.length() > 31  &&  (strcmp(ext,".png") == 0 || strcmp(ext,".webp") == 0));
+        for (uint t=15; t<31 && validName; t++)
         {
-          sprintf(tmp,"%.8f,%.8f",coordinates.mCoordinateList[c].y(),coordinates.mCoordinateList[c].x());
-          ostr << tmp;
+          if (!isxdigit(name[t]))
+            validName = false;
         }
-        c++;
-        ostr << "</TD>";
+
+        if (validName  &&  ImageFileCache::isCompleteImageFile(fname.c_str()))
+          validFiles.emplace_back(modificationTime,fname);
+        else
+          remove(fname.c_str());
       }
-      ostr << "</TR>\n";
     }
-    ostr << "</TABLE>\n";
-    ostr << "</BODY></HTML>\n";
 
-    theResponse.setContent(std::string(ostr.str()));
-    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+    std::sort(validFiles.begin(),validFiles.end(),std::greater<std::pair<time_t,std::string>>());
 
-    return HTTP::Status::ok;
+    for (auto it = validFiles.begin(); it != validFiles.end() && !itsShutdownRequested; ++it)
+    {
+      long long sz = getFileSize(it->second.c_str());
+      if (sz > 0)
+        itsImageFileCache.registerFile(it->second,sz,it->first);
+    }
   }
   catch (...)
   {
     Fmi::Exception exception(BCP, "Operation failed!", nullptr);
     exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    exception.addParameter("Directory",itsImageCache_dir);
     throw exception;
   }
 }
@@ -1982,126 +4355,184 @@ int Plugin::page_coordinates(Spine::Reactor &theReactor,
 
 
 
-/*! \brief GridGui: Page value. */
+/*! \brief GridGui: Image cache thread. Scans the image cache directory at startup and
+ *  once an hour after that. */
 
-int Plugin::page_value(Spine::Reactor &theReactor,
-                            const HTTP::Request &theRequest,
-                            HTTP::Response &theResponse,
-                            Session& session)
+void Plugin::imageCacheThread()
 {
-  FUNCTION_TRACE
   try
   {
-    auto contentServer = itsGridEngine->getContentServer_sptr();
-    auto dataServer = itsGridEngine->getDataServer_sptr();
+    while (!itsShutdownRequested)
+    {
+      try
+      {
+        scanImageCache();
+      }
+      catch (...)
+      {
+        Fmi::Exception exception(BCP, "Image cache scan failed!", nullptr);
+        exception.printError();
+      }
 
-    T::FileId fileId = session.getUInt64Attribute(ATTR_FILE_ID);
-    T::MessageIndex messageIndex = session.getUIntAttribute(ATTR_MESSAGE_INDEX);
-    float xPos = session.getDoubleAttribute(ATTR_X);
-    float yPos = session.getDoubleAttribute(ATTR_Y);
+      for (uint t=0; t<3600 && !itsShutdownRequested; t++)
+        time_usleep(1,0);
+    }
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+  }
+}
 
-    if (fileId == 0)
-      return HTTP::Status::ok;
 
-    T::ContentInfo contentInfo;
-    if (contentServer->getContentInfo(0,fileId,messageIndex,contentInfo) != 0)
-      return HTTP::Status::ok;
 
-    if (contentInfo.mGeometryId == 0)
-      return HTTP::Status::ok;
 
-    T::GeometryId projectionId = toInt32(session.getAttribute(ATTR_PROJECTION_ID));
 
-    if (projectionId > 0  &&  projectionId != contentInfo.mGeometryId)
+/*! \brief GridGui: Set image response. */
+
+void Plugin::setImageResponse(const ImageData& image,Spine::HTTP::Response &theResponse)
+{
+  FUNCTION_TRACE
+  try
+  {
+    if (image.mappedFile)
     {
-      // Image was rendered using the projection geometry's grid layout.  Map the click
-      // to the projection cell using the same row-orientation logic as saveImage(),
-      // look up the cell's latlon, and query the data by latlon so interpolation crosses
-      // geometries correctly.
+      theResponse.setHeader("Content-Type",image.contentType);
+      theResponse.setContent(std::shared_ptr<HTTP::ContentStreamer>(new MappedFileStreamer(image.mappedFile)));
+      return;
+    }
 
-      uint cols = 0;
-      uint rows = 0;
+    if (image.content)
+    {
+      theResponse.setHeader("Content-Type",image.contentType);
+      theResponse.setContent(image.content);
+      return;
+    }
 
-      if (!Identification::gridDef.getGridDimensionsByGeometryId(projectionId,cols,rows))
-        return HTTP::Status::ok;
+    std::ostringstream ostr;
+    ostr << "<HTML><BODY>\n";
+    ostr << "Image does not exist!\n";
+    ostr << "</BODY></HTML>\n";
+    theResponse.setContent(std::string(ostr.str()));
+    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    throw exception;
+  }
+}
 
-      T::Coordinate_svec latLonCoordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(projectionId);
-      if (!latLonCoordinates  ||  latLonCoordinates->size() < static_cast<std::size_t>(cols) * rows)
-        return HTTP::Status::ok;
 
-      const auto& coords = *latLonCoordinates;
 
-      // Same rotate test as Plugin::saveImage(): if rows run south-to-north in the
-      // coordinate array, the image is flipped vertically so that north is at the top.
-      bool rotate = true;
-      if (coords.size() > C_UINT(10*cols)  &&  coords[0].y() < coords[10*cols].y())
-        rotate = true;
-      else
-        rotate = false;
 
-      int col = static_cast<int>(xPos * cols);
-      int row = static_cast<int>(yPos * rows);
-      if (col < 0) col = 0;
-      if (col >= static_cast<int>(cols)) col = static_cast<int>(cols) - 1;
-      if (row < 0) row = 0;
-      if (row >= static_cast<int>(rows)) row = static_cast<int>(rows) - 1;
 
-      int dataRow = rotate ? static_cast<int>(rows) - row - 1 : row;
-      std::size_t idx = static_cast<std::size_t>(dataRow) * cols + static_cast<std::size_t>(col);
+/*! \brief GridGui: Render image. The image is encoded into the memory, added to the
+ *  in-memory image cache and written into the image cache directory in the
+ *  background. The image cache directory can be shared by several server processes,
+ *  so the rendering is coordinated with a lock file: only the process that holds the
+ *  lock renders the image and the others wait until the final image file appears.
+ *  The lock is released by the image writer when the image file is complete. If the
+ *  lock file cannot be created at all, the image is rendered without the file. */
+
+void Plugin::renderImage(const std::string& hash,const char *fileExt,ImageData& image,const std::function<void(ImageData&)>& renderFunction)
+{
+  FUNCTION_TRACE
+  try
+  {
+    std::string fname = getImageFileName(hash,fileExt);
+    time_t endTime = time(nullptr) + itsImageCache_renderTimeout;
+
+    while (true)
+    {
+      ImageFileCache::LockResult lockResult = ImageFileCache::lockFile(fname,itsImageCache_renderTimeout + IMAGE_LOCK_STALE_MARGIN);
+
+      if (lockResult == ImageFileCache::LOCK_FAILED)
+      {
+        // ### The cache directory is not writable (or it is full). The image is rendered
+        // ### and served from the memory without the image file.
+
+        if (loadImage(fname.c_str(),hash,image))
+          break;
 
-      T::ParamValue value = 0;
-      double_vec modificationParameters;
-      const auto& p = coords[idx];
-      dataServer->getGridValueByPoint(0,fileId,messageIndex,T::CoordinateTypeValue::LATLON_COORDINATES,p.x(),p.y(),T::AreaInterpolationMethod::Linear,0,modificationParameters,value);
+        renderFunction(image);
+        if (image.empty() || image.size() == 0)
+        {
+          image = ImageData();
+          return;
+        }
 
-      if (value != ParamValueMissing)
-        theResponse.setContent(std::to_string(value));
-      else
-        theResponse.setContent(std::string("Not available"));
+        itsImageMemoryCache.addImage(hash,image);
+        return;
+      }
 
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return HTTP::Status::ok;
-    }
+      if (lockResult == ImageFileCache::LOCK_ACQUIRED)
+      {
+        // ### Another process might have completed the image just before we got the lock.
 
-    uint cols = 0;
-    uint rows = 0;
+        if (loadImage(fname.c_str(),hash,image))
+        {
+          ImageFileCache::unlockFile(fname);
+          break;
+        }
 
-    if (!Identification::gridDef.getGridDimensionsByGeometryId(contentInfo.mGeometryId,cols,rows))
-      return HTTP::Status::ok;
+        try
+        {
+          renderFunction(image);
+        }
+        catch (...)
+        {
+          ImageFileCache::unlockFile(fname);
+          throw;
+        }
 
-    uint height = rows;
-    uint width = cols;
+        if (image.empty() || image.size() == 0)
+        {
+          // ### Nothing to cache. The caller responds with "Image does not exist".
 
-    double dWidth = C_DOUBLE(width);
-    double dHeight = C_DOUBLE(height);
+          ImageFileCache::unlockFile(fname);
+          image = ImageData();
+          return;
+        }
 
-    bool reverseXDirection = false;
-    bool reverseYDirection = false;
+        itsImageMemoryCache.addImage(hash,image);
 
-    if (!Identification::gridDef.getGridDirectionsByGeometryId(contentInfo.mGeometryId,reverseXDirection,reverseYDirection))
-      return HTTP::Status::ok;
+        try
+        {
+          // ### The writer releases the lock and indexes the file when it is written.
 
-    double xx = xPos * dWidth;
-    double yy = yPos * dHeight;
+          itsImageWriter.addImage(fname,image.content);
+        }
+        catch (...)
+        {
+          // ### The image is served from the memory, so a failed write is not fatal.
 
-    if (!reverseYDirection)
-      yy = dHeight - (yPos * dHeight);
+          Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+          exception.printError();
+        }
+        return;
+      }
 
-    if (reverseXDirection)
-      xx = dWidth - (xPos * dWidth);
+      // ### Another process is rendering the image. Let's wait until it is ready.
 
-    T::ParamValue value = 0;
-    double_vec modificationParameters;
-    dataServer->getGridValueByPoint(0,fileId,messageIndex,T::CoordinateTypeValue::GRID_COORDINATES,xx,yy,T::AreaInterpolationMethod::Nearest,0,modificationParameters,value);
+      if (loadImage(fname.c_str(),hash,image))
+        break;
 
-    if (value != ParamValueMissing)
-      theResponse.setContent(std::to_string(value));
-    else
-      theResponse.setContent(std::string("Not available"));
+      if (time(nullptr) >= endTime)
+      {
+        Fmi::Exception exception(BCP, "Timeout while waiting for another process to render the image!");
+        exception.addParameter("File",fname);
+        exception.addParameter("Timeout",std::to_string(itsImageCache_renderTimeout));
+        throw exception;
+      }
 
-    theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      time_usleep(0,50000);
+    }
 
-    return HTTP::Status::ok;
+    if (!image.empty())
+      itsImageFileCache.addFile(fname,image.size());
   }
   catch (...)
   {
@@ -2115,58 +4546,67 @@ int Plugin::page_value(Spine::Reactor &theReactor,
 
 
 
-/*! \brief GridGui: Load image. */
+/*! \brief GridGui: Get image. The image is taken from the image cache if possible.
+ *  Otherwise it is rendered with the given function. Concurrent requests for the
+ *  same image are coordinated so that only one of them renders the image and the
+ *  others wait for its result (at most renderTimeout seconds). */
 
-bool Plugin::loadImage(const char *fname,Spine::HTTP::Response &theResponse)
+int Plugin::getImage(const std::string& hash,const char *fileExt,Spine::HTTP::Response &theResponse,const std::function<void(ImageData&)>& renderFunction)
 {
   FUNCTION_TRACE
   try
   {
-    long long sz = getFileSize(fname);
-    if (sz > 0)
+    ImageData image;
+
+    // ### The requested image has been generated earlier. We can use it.
+
+    if (getCachedImage(hash,fileExt,image))
     {
-      char buf[10000];
-      std::vector<char> *content = new std::vector<char>();
-      content->reserve(sz);
+      setImageResponse(image,theResponse);
+      return HTTP::Status::ok;
+    }
 
-      std::shared_ptr<std::vector<char>> sContent;
-      sContent.reset(content);
+    std::shared_future<ImageData> future;
+    if (!itsImageFlights.start(hash,future))
+    {
+      // ### Another thread is generating the requested image. Let's wait for its result.
 
-      FILE *file = fopen(fname,"re");
-      if (file != nullptr)
+      if (!SingleFlight<ImageData>::wait(future,itsImageCache_renderTimeout,image))
       {
-        int n;
-        while ((n = fread(buf,1,10000,file)) > 0)
-        {
-          for (int t=0; t<n; t++)
-          {
-            content->emplace_back(buf[t]);
-          }
-        }
-        fclose(file);
-
-        //theResponse.setHeader("Content-Type","image/jpg");
-        theResponse.setHeader("Content-Type","image/png");
-        theResponse.setContent(sContent);
-        return true;
+        Fmi::Exception exception(BCP, "Timeout while waiting for the image to be rendered!");
+        exception.addParameter("Timeout",std::to_string(itsImageCache_renderTimeout));
+        throw exception;
       }
-      return false;
+
+      setImageResponse(image,theResponse);
+      return HTTP::Status::ok;
     }
-    else
+
+    // ### We should generate the requested image by ourselves.
+
+    try
     {
-      std::ostringstream ostr;
-      ostr << "<HTML><BODY>\n";
-      ostr << "Image does not exist!\n";
-      ostr << "</BODY></HTML>\n";
-      theResponse.setContent(std::string(ostr.str()));
-      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-      return false;
+      // ### The image might have been completed just before we started the generation.
+
+      if (!getCachedImage(hash,fileExt,image))
+        renderImage(hash,fileExt,image,renderFunction);
+
+      itsImageFlights.finish(hash,image);
+    }
+    catch (...)
+    {
+      itsImageFlights.abort(hash,std::current_exception());
+      throw;
     }
+
+    setImageResponse(image,theResponse);
+    return HTTP::Status::ok;
   }
   catch (...)
   {
     Fmi::Exception exception(BCP, "Operation failed!", nullptr);
     exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    exception.addParameter("Hash",hash);
     throw exception;
   }
 }
@@ -2181,6 +4621,34 @@ int Plugin::page_image(Spine::Reactor &theReactor,
                             const HTTP::Request &theRequest,
                             HTTP::Response &theResponse,
                             Session& session)
+{
+  return page_imageImpl(theRequest, theResponse, session, /*tile=*/false);
+}
+
+
+
+
+
+/*! \brief GridGui: Page tile. */
+
+int Plugin::page_tile(Spine::Reactor &theReactor,
+                            const HTTP::Request &theRequest,
+                            HTTP::Response &theResponse,
+                            Session& session)
+{
+  return page_imageImpl(theRequest, theResponse, session, /*tile=*/true);
+}
+
+
+
+
+
+/*! \brief GridGui: Shared rendering helper for the image and tile pages. */
+
+int Plugin::page_imageImpl(const HTTP::Request &theRequest,
+                             HTTP::Response &theResponse,
+                             Session& session,
+                             bool tile)
 {
   FUNCTION_TRACE
   try
@@ -2225,10 +4693,50 @@ int Plugin::page_image(Spine::Reactor &theReactor,
     std::string seaShadingShadowStr = session.getAttribute(ATTR_SEA_SHADING_SHADOW);
     std::string seaShadingPositionStr = session.getAttribute(ATTR_SEA_SHADING_POS);
     std::string seaColorPosStr = session.getAttribute(ATTR_SEA_COLOR_POS);
+    std::string imageWidthStr = session.getAttribute(ATTR_IMAGE_WIDTH);
+    std::string imageHeightStr = session.getAttribute(ATTR_IMAGE_HEIGHT);
+    std::string areaStr = session.getAttribute(ATTR_AREA);
+    std::string tileZoomStr = session.getAttribute(ATTR_TILE_Z);
+    std::string tileXStr = session.getAttribute(ATTR_TILE_X);
+    std::string tileYStr = session.getAttribute(ATTR_TILE_Y);
 
     if (projectionIdStr.empty())
       projectionIdStr = geometryIdStr;
 
+    if (tile)
+    {
+      // ### The tiles outside of the pyramid are not rendered at all.
+
+      uint cols = 0;
+      uint rows = 0;
+      T::GeometryId geomId = toInt32(projectionIdStr);
+      if (geomId == 0)
+        geomId = toInt32(geometryIdStr);
+
+      if (tileZoomStr.empty() || tileXStr.empty() || tileYStr.empty() || !Identification::gridDef.getGridDimensionsByGeometryId(geomId,cols,rows))
+        return HTTP::Status::not_found;
+
+      uint maxZoom = getTileMaxZoom(cols,rows);
+      int zoom = toInt32(tileZoomStr);
+      if (zoom < 0  ||  C_UINT(zoom) > maxZoom)
+        return HTTP::Status::not_found;
+
+      std::size_t span = (std::size_t)IMAGE_TILE_SIZE << (maxZoom - zoom);
+      if (toUInt32(tileXStr) * span >= cols  ||  toUInt32(tileYStr) * span >= rows)
+        return HTTP::Status::not_found;
+    }
+    else
+    if (!areaStr.empty())
+    {
+      T::GeometryId geomId = toInt32(projectionIdStr);
+      if (geomId == 0)
+        geomId = toInt32(geometryIdStr);
+
+      int status = checkImageArea(areaStr,geomId);
+      if (status != HTTP::Status::ok)
+        return status;
+    }
+
     std::string colorMapFileName = "";
     std::string colorMapModificationTime = "";
     if (!colorMap.empty() &&  strcasecmp(colorMap.c_str(),"None") != 0)
@@ -2241,12 +4749,19 @@ int Plugin::page_image(Spine::Reactor &theReactor,
       }
     }
 
-    std::string hash = "Image:" + fileIdStr + ":" + messageIndexStr + ":" + hueStr + ":" + saturationStr + ":" +
+    std::string hash = "Image:" + getMessageKey(toUInt64(fileIdStr),toUInt32(messageIndexStr)) + ":" + hueStr + ":" + saturationStr + ":" +
       blurStr + ":" + coordinateLinesStr + ":" + landBorderStr + ":" + projectionIdStr + ":" +
       landMaskStr + ":" + seaMaskStr + ":" + colorMapFileName + ":" + colorMapModificationTime + ":" + missingStr + ":" +
       landShadingLightStr + ":" + landShadingShadowStr  + ":" + landShadingPositionStr  + ":" + landColorPosStr + ":" +
       seaShadingLightStr + ":" + seaShadingShadowStr  + ":" + seaShadingPositionStr  + ":" + seaColorPosStr + ":" + opacityStr + ":" + streamColorStr;
 
+    // ### Each tile is cached separately. The tiles do not depend on the image size.
+
+    if (tile)
+      hash = "Tile:" + tileZoomStr + ":" + tileXStr + ":" + tileYStr + ":" + hash;
+    else
+      hash = hash + ":" + imageWidthStr + ":" + imageHeightStr + ":" + areaStr;
+
     const std::size_t seed = Fmi::hash(hash);
     std::string seedStr = std::to_string(seed);
     theResponse.setHeader("ETag",seedStr);
@@ -2254,64 +4769,10 @@ int Plugin::page_image(Spine::Reactor &theReactor,
     if (auto status = conditionalResponseStatus(theRequest, seedStr))
       return *status;
 
-    bool found = false;
-    bool ind = true;
-
-    time_t endTime = time(0) + 30;
-
-    while (ind  &&  time(0) < endTime)
-    {
-      {
-        AutoThreadLock lock(&itsThreadLock);
-        auto it = itsImages.find(hash);
-        if (it != itsImages.end())
-        {
-          // ### The requested image has been generated earlier. We can use it.
-
-          loadImage(it->second.c_str(),theResponse);
-          return HTTP::Status::ok;
-        }
-      }
-
-      if (!found)
-      {
-        // ### Let's check if another thread is already generating the requested image
-
-        for (uint t=0; t<100; t++)
-        {
-          if (itsImagesUnderConstruction[t] == hash)
-          {
-            found = true;
-          }
-        }
-
-        if (!found)
-          ind = false;
-      }
-
-      if (found)
-      {
-        // ### Another thread is generating the requested image. Let's wait until it is ready and can be
-        // ### found from the itsImages list.
-
-        time_usleep(0,10000);
-        found = false;
-      }
-    }
-
-    // ### It seems that we should generated the requested image by ourselves.
-
-    uint idx = itsImageCounter % 100;
-    itsImagesUnderConstruction[idx] = hash;
-    itsImageCounter++;
-
-    try
+    return getImage(hash,".png",theResponse,[&](ImageData& image)
     {
-      std::string fname = itsImageCache_dir + "/grid-gui-image_" + std::to_string(getTime()) + ".png";
-
       ImagePaintParameters params;
 
-      params.imageFile = fname;
       params.fileId = toUInt64(fileIdStr);
       params.messageIndex = toUInt32(messageIndexStr);
       params.geometryId = toInt32(geometryIdStr);
@@ -2339,27 +4800,22 @@ int Plugin::page_image(Spine::Reactor &theReactor,
       params.seaShading_shadow = toInt32(seaShadingShadowStr);
       params.seaShading_position = toInt32(seaShadingPositionStr);
       params.coordinateLine_color = getColorValue(coordinateLinesStr);
-
-      saveImage(params);
-
-      if (loadImage(fname.c_str(),theResponse))
+      if (tile)
       {
-        AutoThreadLock lock(&itsThreadLock);
-        if (itsImages.find(hash) == itsImages.end())
-        {
-          itsImages.insert(std::pair<std::string,std::string>(hash,fname));
-        }
+        params.tile_zoom = toInt32(tileZoomStr);
+        params.tile_x = toUInt32(tileXStr);
+        params.tile_y = toUInt32(tileYStr);
+      }
+      else
+      {
+        params.image_maxWidth = imageWidthStr.empty() ? 0 : toUInt32(imageWidthStr);
+        params.image_maxHeight = imageHeightStr.empty() ? 0 : toUInt32(imageHeightStr);
+        params.image_area = areaStr;
       }
-      itsImagesUnderConstruction[idx] = "";
-    }
-    catch (...)
-    {
-      itsImagesUnderConstruction[idx] = "";
-      Fmi::Exception exception(BCP, "Operation failed!", nullptr);
-      throw exception;
-    }
 
-    return HTTP::Status::ok;
+      saveImage(params);
+      image = params.image;
+    });
   }
   catch (...)
   {
@@ -2450,6 +4906,9 @@ int Plugin::page_streamsImpl(const HTTP::Request &theRequest,
     std::string seaShadingShadowStr = session.getAttribute(ATTR_SEA_SHADING_SHADOW);
     std::string seaShadingPositionStr = session.getAttribute(ATTR_SEA_SHADING_POS);
     std::string seaColorPosStr = session.getAttribute(ATTR_SEA_COLOR_POS);
+    std::string imageWidthStr = session.getAttribute(ATTR_IMAGE_WIDTH);
+    std::string imageHeightStr = session.getAttribute(ATTR_IMAGE_HEIGHT);
+    std::string areaStr = session.getAttribute(ATTR_AREA);
 
     std::string colorMapFileName = "";
     std::string colorMapModificationTime = "";
@@ -2466,13 +4925,24 @@ int Plugin::page_streamsImpl(const HTTP::Request &theRequest,
     if (projectionIdStr.empty())
       projectionIdStr = geometryIdStr;
 
+    if (!areaStr.empty())
+    {
+      T::GeometryId geomId = toInt32(projectionIdStr);
+      if (geomId == 0)
+        geomId = toInt32(geometryIdStr);
+
+      int status = checkImageArea(areaStr,geomId);
+      if (status != HTTP::Status::ok)
+        return status;
+    }
+
     const char *hashPrefix = animation ? "StreamsAnimation:" : "Streams:";
-    std::string hash = std::string(hashPrefix) + fileIdStr + ":" + messageIndexStr + ":" + hueStr + ":" + saturationStr + ":" +
+    std::string hash = std::string(hashPrefix) + getMessageKey(toUInt64(fileIdStr),toUInt32(messageIndexStr)) + ":" + hueStr + ":" + saturationStr + ":" +
       blurStr + ":" + coordinateLinesStr + ":" + landBorderStr + ":" + projectionIdStr + ":" +
       landMaskStr + ":" + seaMaskStr + ":" + colorMapFileName + ":" + colorMapModificationTime + ":" + missingStr + ":" +
       minLengthStr + ":" + maxLengthStr + ":" + stepStr + ":" + streamColorStr + ":" +
       landShadingLightStr + ":" + landShadingShadowStr  + ":" + landShadingPositionStr  + ":" + landColorPosStr + ":" +
-      seaShadingLightStr + ":" + seaShadingShadowStr  + ":" + seaShadingPositionStr  + ":" + seaColorPosStr + ":" + opacityStr;
+      seaShadingLightStr + ":" + seaShadingShadowStr  + ":" + seaShadingPositionStr  + ":" + seaColorPosStr + ":" + opacityStr + ":" + imageWidthStr + ":" + imageHeightStr + ":" + areaStr;
 
     const std::size_t seed = Fmi::hash(hash);
     std::string seedStr = std::to_string(seed);
@@ -2481,50 +4951,10 @@ int Plugin::page_streamsImpl(const HTTP::Request &theRequest,
     if (auto status = conditionalResponseStatus(theRequest, seedStr))
       return *status;
 
-    bool found = false;
-    bool ind = true;
-
-    while (ind)
-    {
-      {
-        AutoThreadLock lock(&itsThreadLock);
-        auto it = itsImages.find(hash);
-        if (it != itsImages.end())
-        {
-          loadImage(it->second.c_str(),theResponse);
-          return HTTP::Status::ok;
-        }
-      }
-
-      if (!found)
-      {
-        for (uint t=0; t<100; t++)
-        {
-          if (itsImagesUnderConstruction[t] == hash)
-          {
-            found = true;
-          }
-        }
-        if (!found)
-          ind = false;
-      }
-
-      if (found)
-        time_usleep(0,10000);
-    }
-
-    uint idx = itsImageCounter % 100;
-    itsImagesUnderConstruction[idx] = hash;
-    itsImageCounter++;
-
-    try
+    return getImage(hash,animation ? ".webp" : ".png",theResponse,[&](ImageData& image)
     {
-      const char *fileExt = animation ? ".webp" : ".png";
-      std::string fname = itsImageCache_dir + "/grid-gui-image_" + std::to_string(getTime()) + fileExt;
-
       ImagePaintParameters params;
 
-      params.imageFile = fname;
       params.fileId = toUInt64(fileIdStr);
       params.messageIndex = toUInt32(messageIndexStr);
       params.geometryId = toInt32(geometryIdStr);
@@ -2552,28 +4982,13 @@ int Plugin::page_streamsImpl(const HTTP::Request &theRequest,
       params.seaShading_shadow = toInt32(seaShadingShadowStr);
       params.seaShading_position = toInt32(seaShadingPositionStr);
       params.coordinateLine_color = getColorValue(coordinateLinesStr);
+      params.image_maxWidth = imageWidthStr.empty() ? 0 : toUInt32(imageWidthStr);
+      params.image_maxHeight = imageHeightStr.empty() ? 0 : toUInt32(imageHeightStr);
+      params.image_area = areaStr;
 
       saveImage(params);
-
-      if (loadImage(fname.c_str(),theResponse))
-      {
-        AutoThreadLock lock(&itsThreadLock);
-        if (itsImages.find(hash) == itsImages.end())
-        {
-          itsImages.insert(std::pair<std::string,std::string>(hash,fname));
-        }
-      }
-
-      itsImagesUnderConstruction[idx] = "";
-    }
-    catch (...)
-    {
-      itsImagesUnderConstruction[idx] = "";
-      Fmi::Exception exception(BCP, "Operation failed!", nullptr);
-      throw exception;
-    }
-
-    return HTTP::Status::ok;
+      image = params.image;
+    });
   }
   catch (...)
   {
@@ -2641,7 +5056,9 @@ int Plugin::page_map(Spine::Reactor &theReactor,
       }
     }
 
-    std::string hash = "Map:" + fileIdStr + ":" + messageIndexStr + ":" + hueStr + ":" + saturationStr + ":" +
+    std::string messageKey = getMessageKey(toUInt64(fileIdStr),toUInt32(messageIndexStr));
+
+    std::string hash = "Map:" + messageKey + ":" + hueStr + ":" + saturationStr + ":" +
       blurStr + ":" + coordinateLinesStr + ":" + landBorderStr + ":" +
       landMaskStr + ":" + seaMaskStr + ":" + colorMapFileName + ":" + colorMapModificationTime + ":" + missingStr;
 
@@ -2652,86 +5069,52 @@ int Plugin::page_map(Spine::Reactor &theReactor,
     if (auto status = conditionalResponseStatus(theRequest, seedStr))
       return *status;
 
-    bool found = false;
-    bool ind = true;
-
-    while (ind)
-    {
-      {
-        AutoThreadLock lock(&itsThreadLock);
-        auto it = itsImages.find(hash);
-        if (it != itsImages.end())
-        {
-          loadImage(it->second.c_str(),theResponse);
-          return HTTP::Status::ok;
-        }
-      }
-
-      if (!found)
-      {
-        for (uint t=0; t<100; t++)
-        {
-          if (itsImagesUnderConstruction[t] == hash)
-          {
-            found = true;
-          }
-        }
-        if (!found)
-          ind = false;
-      }
-
-      if (found)
-        time_usleep(0,10000);
-    }
-
-    uint idx = itsImageCounter % 100;
-    itsImagesUnderConstruction[idx] = hash;
-    itsImageCounter++;
-
-    try
+    int dataResult = 0;
+    int status = getImage(hash,".png",theResponse,[&](ImageData& image)
     {
       uint columns = 1800;
       uint rows = 900;
       uint coordinateLines = getColorValue(coordinateLinesStr);
 
-      T::ParamValue_vec values;
-      double_vec modificationParameters;
-      int result = dataServer->getGridValueVectorByRectangle(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),T::CoordinateTypeValue::LATLON_COORDINATES,columns,rows,-180,90,360/C_DOUBLE(columns),-180/C_DOUBLE(rows),T::AreaInterpolationMethod::Nearest,0,modificationParameters,values);
+      std::string valueKey = messageKey + ":Map";
+
+      GridValues_sptr grid;
+      int result = getGridValues(valueKey,[&](GridValues& map)
+      {
+        map.columns = columns;
+        map.rows = rows;
+
+        double_vec modificationParameters;
+        return dataServer->getGridValueVectorByRectangle(0,toUInt64(fileIdStr),toUInt32(messageIndexStr),T::CoordinateTypeValue::LATLON_COORDINATES,columns,rows,-180,90,360/C_DOUBLE(columns),-180/C_DOUBLE(rows),T::AreaInterpolationMethod::Nearest,0,modificationParameters,map.values);
+      },grid);
+
       if (result != 0)
       {
-        std::ostringstream ostr;
-        ostr << "<HTML><BODY>\n";
-        ostr << "DataServer request 'getGridValuesByArea()' failed : " << result << "\n";
-        ostr << "</BODY></HTML>\n";
-        theResponse.setContent(std::string(ostr.str()));
-        theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
-        return HTTP::Status::ok;
+        // ### No image is rendered, so nothing is cached. The error page is written below.
+
+        dataResult = result;
+        return;
       }
 
       uint landBorder = getColorValue(landBorderStr);
 
-      std::string fname = "/" + itsImageCache_dir + "/grid-gui-image_" + std::to_string(getTime()) + ".png";
-      saveMap(fname.c_str(),columns,rows,values,toUInt8(hueStr),toUInt8(saturationStr),toUInt8(blurStr),coordinateLines,landBorder,landMaskStr,seaMaskStr,colorMap,missingStr);
+      ValueStats_sptr valueStats = getValueStats(valueKey,grid->values);
 
-      if (loadImage(fname.c_str(),theResponse))
-      {
-        AutoThreadLock lock(&itsThreadLock);
-        if (itsImages.find(hash) == itsImages.end())
-        {
-          itsImages.insert(std::pair<std::string,std::string>(hash,fname));
-        }
-      }
+      saveMap(image,columns,rows,grid->values,*valueStats,toUInt8(hueStr),toUInt8(saturationStr),toUInt8(blurStr),coordinateLines,landBorder,landMaskStr,seaMaskStr,colorMap,missingStr);
+    });
 
-      itsImagesUnderConstruction[idx] = "";
-    }
-    catch (...)
+    if (dataResult != 0)
     {
-      itsImagesUnderConstruction[idx] = "";
-      Fmi::Exception exception(BCP, "Operation failed!", nullptr);
-      throw exception;
+      std::ostringstream ostr;
+      ostr << "<HTML><BODY>\n";
+      ostr << "DataServer request 'getGridValuesByArea()' failed : " << dataResult << "\n";
+      ostr << "</BODY></HTML>\n";
+      theResponse.setContent(std::string(ostr.str()));
+      theResponse.setHeader("Content-Type", "text/html; charset=UTF-8");
+      return HTTP::Status::ok;
     }
 
-    return HTTP::Status::ok;
+    return status;
   }
   catch (...)
   {
@@ -2745,45 +5128,45 @@ int Plugin::page_map(Spine::Reactor &theReactor,
 
 
 
-/*! \brief GridGui: Get level ids. */
+/*! \brief GridGui: Get fmi key. */
 
-void Plugin::getLevelIds(T::ContentInfoList& contentInfoList,std::set<int>& levelIds)
+std::string Plugin::getFmiKey(std::string& producerName,T::ContentInfo& contentInfo)
 {
   FUNCTION_TRACE
   try
   {
-    uint len = contentInfoList.getLength();
+    char buf[200];
+    char *p = buf;
 
-    for (uint a=0; a<len; a++)
-    {
-      T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+    if (strlen(contentInfo.getFmiParameterName()) > 0)
+      p += sprintf(p,"%s",contentInfo.getFmiParameterName());
+    else
+    if (contentInfo.mFmiParameterId > 0)
+      p += sprintf(p,"FMI-%u",contentInfo.mFmiParameterId);
 
-      if (g->mFmiParameterLevelId >= 0)
-      {
-        if (levelIds.find(g->mFmiParameterLevelId) == levelIds.end())
-        {
-          levelIds.insert(g->mFmiParameterLevelId);
-        }
-      }
-      /*
-      else
-      if (g->mGrib1ParameterLevelId > 0)
-      {
-        if (levelIds.find(g->mGrib1ParameterLevelId+1000) == levelIds.end())
-        {
-          levelIds.insert(g->mGrib1ParameterLevelId+1000);
-        }
-      }
+    p += sprintf(p,":%s",producerName.c_str());
+
+    if (contentInfo.mGeometryId > 0)
+      p += sprintf(p,":%u",contentInfo.mGeometryId);
+    else
+      p += sprintf(p,":");
+
+    if (contentInfo.mFmiParameterLevelId > 0)
+      p += sprintf(p,":%u",contentInfo.mFmiParameterLevelId);
+    else
+      p += sprintf(p,":");
+
+    p += sprintf(p,":%d",contentInfo.mParameterLevel);
+
+    if (contentInfo.mForecastType >= 0)
+    {
+      if (contentInfo.mForecastNumber >= 0)
+        p += sprintf(p,":%d:%d",contentInfo.mForecastType,contentInfo.mForecastNumber);
       else
-      if (g->mGrib2ParameterLevelId > 0)
-      {
-        if (levelIds.find(g->mGrib2ParameterLevelId+2000) == levelIds.end())
-        {
-          levelIds.insert(g->mGrib2ParameterLevelId+2000);
-        }
-      }
-      */
+        p += sprintf(p,":%d",contentInfo.mForecastType);
     }
+
+    return std::string(buf);
   }
   catch (...)
   {
@@ -2797,30 +5180,20 @@ void Plugin::getLevelIds(T::ContentInfoList& contentInfoList,std::set<int>& leve
 
 
 
-/*! \brief GridGui: Get levels. */
+/*! \brief GridGui: Check the last event of the content server. The content listing
+ *  cache is cleared if the content has changed after the previous check. If the event
+ *  is not available, the listings expire by their age (contentCache.maxAge). */
 
-void Plugin::getLevels(T::ContentInfoList& contentInfoList,int levelId,std::set<int>& levels)
+void Plugin::checkContentCache()
 {
   FUNCTION_TRACE
   try
   {
-    uint len = contentInfoList.getLength();
-    int id = levelId % 1000;
-
-    for (uint a=0; a<len; a++)
-    {
-      T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+    auto contentServer = itsGridEngine->getContentServer_sptr();
 
-      if ((levelId >= 0  &&  levelId < 1000  &&  id == g->mFmiParameterLevelId)/* ||
-          (levelId >= 1000  &&  levelId < 2000  &&  id == g->mGrib1ParameterLevelId) ||
-          (levelId >= 2000  &&  id == g->mGrib2ParameterLevelId)*/)
-      {
-        if (levels.find(g->mParameterLevel) == levels.end())
-        {
-          levels.insert(g->mParameterLevel);
-        }
-      }
-    }
+    T::EventInfo eventInfo;
+    if (contentServer->getLastEventInfo(0,0,eventInfo) == 0)
+      itsContentCache.setLastEvent(eventInfo.mServerTime,eventInfo.mEventId);
   }
   catch (...)
   {
@@ -2834,33 +5207,24 @@ void Plugin::getLevels(T::ContentInfoList& contentInfoList,int levelId,std::set<
 
 
 
-/*! \brief GridGui: Get forecast types. */
+/*! \brief GridGui: Get the producer list (sorted by name) from the content listing
+ *  cache or from the content server. */
 
-void Plugin::getForecastTypes(T::ContentInfoList& contentInfoList,int levelId,int level,std::set<int>& forecastTypes)
+void Plugin::getCachedProducerInfoList(T::ProducerInfoList& producerInfoList)
 {
   FUNCTION_TRACE
   try
   {
-    uint len = contentInfoList.getLength();
-    int id = levelId % 1000;
+    if (itsContentCache.getProducerInfoList(producerInfoList))
+      return;
 
-    for (uint a=0; a<len; a++)
-    {
-      T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+    uint version = itsContentCache.getVersion();
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    if (contentServer->getProducerInfoList(0,producerInfoList) != 0)
+      return;
 
-      if ((levelId >= 0  &&  levelId < 1000  &&  id == g->mFmiParameterLevelId)/* ||
-          (levelId >= 1000  &&  levelId < 2000  &&  id == g->mGrib1ParameterLevelId) ||
-          (levelId >= 2000  &&  id == g->mGrib2ParameterLevelId)*/)
-      {
-        if (level == g->mParameterLevel)
-        {
-          if (forecastTypes.find(g->mForecastType) == forecastTypes.end())
-          {
-            forecastTypes.insert(g->mForecastType);
-          }
-        }
-      }
-    }
+    producerInfoList.sortByName();
+    itsContentCache.addProducerInfoList(version,producerInfoList);
   }
   catch (...)
   {
@@ -2874,41 +5238,29 @@ void Plugin::getForecastTypes(T::ContentInfoList& contentInfoList,int levelId,in
 
 
 
-/*! \brief GridGui: Get forecast numbers. */
+/*! \brief GridGui: Get the generations of the producer from the content listing cache
+ *  or from the content server. */
 
-void Plugin::getForecastNumbers(T::ContentInfoList& contentInfoList,int levelId,int level,int forecastType,std::set<int>& forecastNumbers)
+void Plugin::getCachedGenerationInfoList(T::ProducerId producerId,T::GenerationInfoList& generationInfoList)
 {
   FUNCTION_TRACE
   try
   {
-    uint len = contentInfoList.getLength();
-    int id = levelId % 1000;
+    if (itsContentCache.getGenerationInfoList(producerId,generationInfoList))
+      return;
 
-    for (uint a=0; a<len; a++)
-    {
-      T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+    uint version = itsContentCache.getVersion();
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    if (contentServer->getGenerationInfoListByProducerId(0,producerId,generationInfoList) != 0)
+      return;
 
-      if ((levelId >= 0  &&  levelId < 1000  &&  id == g->mFmiParameterLevelId)/* ||
-          (levelId >= 1000  &&  levelId < 2000  &&  id == g->mGrib1ParameterLevelId) ||
-          (levelId >= 2000  &&  id == g->mGrib2ParameterLevelId)*/)
-      {
-        if (level == g->mParameterLevel)
-        {
-          if (forecastType == g->mForecastType)
-          {
-            if (forecastNumbers.find(g->mForecastNumber) == forecastNumbers.end())
-            {
-              forecastNumbers.insert(g->mForecastNumber);
-            }
-          }
-        }
-      }
-    }
+    itsContentCache.addGenerationInfoList(version,producerId,generationInfoList);
   }
   catch (...)
   {
     Fmi::Exception exception(BCP, "Operation failed!", nullptr);
     exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    exception.addParameter("ProducerId",std::to_string(producerId));
     throw exception;
   }
 }
@@ -2917,44 +5269,29 @@ void Plugin::getForecastNumbers(T::ContentInfoList& contentInfoList,int levelId,
 
 
 
-/*! \brief GridGui: Get geometries. */
+/*! \brief GridGui: Get the parameters (FMI names) of the generation from the content
+ *  listing cache or from the content server. */
 
-void Plugin::getGeometries(T::ContentInfoList& contentInfoList,int levelId,int level,int forecastType,int forecastNumber,std::set<int>& geometries)
+void Plugin::getCachedParamKeyList(T::GenerationId generationId,std::set<std::string>& paramKeyList)
 {
   FUNCTION_TRACE
   try
   {
-    uint len = contentInfoList.getLength();
-    int id = levelId % 1000;
+    if (itsContentCache.getParamKeyList(generationId,paramKeyList))
+      return;
 
-    for (uint a=0; a<len; a++)
-    {
-      T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+    uint version = itsContentCache.getVersion();
+    auto contentServer = itsGridEngine->getContentServer_sptr();
+    if (contentServer->getContentParamKeyListByGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,paramKeyList) != 0)
+      return;
 
-      if ((levelId >= 0  &&  levelId < 1000  &&  id == g->mFmiParameterLevelId) /*||
-          (levelId >= 1000  &&  levelId < 2000  &&  id == g->mGrib1ParameterLevelId) ||
-          (levelId >= 2000  &&  id == g->mGrib2ParameterLevelId)*/)
-      {
-        if (level == g->mParameterLevel)
-        {
-          if (forecastType == g->mForecastType)
-          {
-            if (forecastNumber == g->mForecastNumber)
-            {
-              if (geometries.find(g->mGeometryId) == geometries.end())
-              {
-                geometries.insert(g->mGeometryId);
-              }
-            }
-          }
-        }
-      }
-    }
+    itsContentCache.addParamKeyList(version,generationId,paramKeyList);
   }
   catch (...)
   {
     Fmi::Exception exception(BCP, "Operation failed!", nullptr);
     exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    exception.addParameter("GenerationId",std::to_string(generationId));
     throw exception;
   }
 }
@@ -2963,50 +5300,36 @@ void Plugin::getGeometries(T::ContentInfoList& contentInfoList,int levelId,int l
 
 
 
-/*! \brief GridGui: Get fmi key. */
+/*! \brief GridGui: Get the facet index of the contents of the parameter in the
+ *  generation from the content listing cache. If it is not cached, all the contents
+ *  of the parameter are fetched from the content server in one query and indexed. */
 
-std::string Plugin::getFmiKey(std::string& producerName,T::ContentInfo& contentInfo)
+ContentIndex_sptr Plugin::getContentIndex(T::GenerationId generationId,const std::string& parameterId)
 {
   FUNCTION_TRACE
   try
   {
-    char buf[200];
-    char *p = buf;
-
-    if (strlen(contentInfo.getFmiParameterName()) > 0)
-      p += sprintf(p,"%s",contentInfo.getFmiParameterName());
-    else
-    if (contentInfo.mFmiParameterId > 0)
-      p += sprintf(p,"FMI-%u",contentInfo.mFmiParameterId);
-
-    p += sprintf(p,":%s",producerName.c_str());
-
-    if (contentInfo.mGeometryId > 0)
-      p += sprintf(p,":%u",contentInfo.mGeometryId);
-    else
-      p += sprintf(p,":");
-
-    if (contentInfo.mFmiParameterLevelId > 0)
-      p += sprintf(p,":%u",contentInfo.mFmiParameterLevelId);
-    else
-      p += sprintf(p,":");
+    ContentIndex_sptr contentIndex;
+    if (itsContentCache.getContentIndex(generationId,parameterId,contentIndex))
+      return contentIndex;
 
-    p += sprintf(p,":%d",contentInfo.mParameterLevel);
+    uint version = itsContentCache.getVersion();
+    auto contentServer = itsGridEngine->getContentServer_sptr();
 
-    if (contentInfo.mForecastType >= 0)
-    {
-      if (contentInfo.mForecastNumber >= 0)
-        p += sprintf(p,":%d:%d",contentInfo.mForecastType,contentInfo.mForecastNumber);
-      else
-        p += sprintf(p,":%d",contentInfo.mForecastType);
-    }
+    std::shared_ptr<ContentIndex> index(new ContentIndex());
+    if (contentServer->getContentListByParameterAndGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,parameterId,-1,-0x7FFFFFFF,0x7FFFFFFF,-2,-2,-2,"14000101T000000","30000101T000000",0,index->contentInfoList) != 0)
+      return index;
 
-    return std::string(buf);
+    createContentIndex(*index);
+    itsContentCache.addContentIndex(version,generationId,parameterId,index);
+    return index;
   }
   catch (...)
   {
     Fmi::Exception exception(BCP, "Operation failed!", nullptr);
     exception.addParameter("Configuration file",itsConfigurationFile.getFilename());
+    exception.addParameter("GenerationId",std::to_string(generationId));
+    exception.addParameter("ParameterId",parameterId);
     throw exception;
   }
 }
@@ -3089,6 +5412,12 @@ void Plugin::initSession(Session& session)
     session.setAttribute(ATTR_X,"");
     session.setAttribute(ATTR_Y,"");
     session.setAttribute(ATTR_PROJECTION_LOCK,"");
+    session.setAttribute(ATTR_IMAGE_WIDTH,"1800");
+    session.setAttribute(ATTR_IMAGE_HEIGHT,"1000");
+    session.setAttribute(ATTR_AREA,"");
+    session.setAttribute(ATTR_TILE_Z,"0");
+    session.setAttribute(ATTR_TILE_X,"0");
+    session.setAttribute(ATTR_TILE_Y,"0");
     session.setAttribute(ATTR_LAND_SHADING_LIGHT,"128");
     session.setAttribute(ATTR_LAND_SHADING_SHADOW,"384");
     session.setAttribute(ATTR_LAND_SHADING_POS,"2");
@@ -3161,23 +5490,234 @@ void Plugin::page_main_writeJavascript(std::ostringstream& output)
   output << "  document.getElementById(id).innerHTML = txt;\n";
   output << "}\n";
 
-  output << "function httpGet(theUrl)\n";
+  // ### The grid values are requested asynchronously from page=values. Only the latest
+  // ### request is kept alive and the hover requests are sent when the mouse stops.
+
+  output << "var valueRequest = null;\n";
+  output << "var valueTimer = null;\n";
+
+  output << "function getValues(url,points,callback)\n";
+  output << "{\n";
+  output << "  if (valueRequest)\n";
+  output << "    valueRequest.abort();\n";
+  output << "  var xmlHttp = new XMLHttpRequest();\n";
+  output << "  valueRequest = xmlHttp;\n";
+  output << "  xmlHttp.onreadystatechange = function()\n";
+  output << "  {\n";
+  output << "    if (xmlHttp.readyState == 4  &&  xmlHttp.status == 200)\n";
+  output << "    {\n";
+  output << "      if (valueRequest == xmlHttp)\n";
+  output << "        valueRequest = null;\n";
+  output << "      callback(JSON.parse(xmlHttp.responseText));\n";
+  output << "    }\n";
+  output << "  };\n";
+  output << "  xmlHttp.open(\"GET\", url + ';" << ATTR_POINTS << "=' + points.join(','), true);\n";
+  output << "  xmlHttp.send(null);\n";
+  output << "}\n";
+
+  output << "function showValue(url,prosX,prosY)\n";
+  output << "{\n";
+  output << "  getValues(url,[prosX,prosY],function(values)\n";
+  output << "  {\n";
+  output << "    var v = (values.length > 0) ? values[0] : null;\n";
+  output << "    document.getElementById('gridValue').value = (v === null) ? 'Not available' : v;\n";
+  output << "  });\n";
+  output << "}\n";
+
+  output << "function hoverValue(url,prosX,prosY)\n";
+  output << "{\n";
+  output << "  if (valueTimer)\n";
+  output << "    clearTimeout(valueTimer);\n";
+  output << "  valueTimer = setTimeout(function() { valueTimer = null; showValue(url,prosX,prosY); },150);\n";
+  output << "}\n";
+
+  // ### The image pages also load the values of the image as a binary value raster
+  // ### (page=raster), so the values under the cursor are read without requests.
+
+  output << "var valueRaster = null;\n";
+
+  output << "function loadRaster(url)\n";
   output << "{\n";
   output << "  var xmlHttp = new XMLHttpRequest();\n";
-  output << "  xmlHttp.open(\"GET\", theUrl, false );\n";
-  output << "  xmlHttp.send( null );\n";
-  output << "  return xmlHttp.responseText;\n";
+  output << "  xmlHttp.responseType = 'arraybuffer';\n";
+  output << "  xmlHttp.onreadystatechange = function()\n";
+  output << "  {\n";
+  output << "    if (xmlHttp.readyState == 4  &&  xmlHttp.status == 200  &&  xmlHttp.response.byteLength >= " << VALUE_RASTER_HEADER_SIZE << ")\n";
+  output << "    {\n";
+  output << "      var view = new DataView(xmlHttp.response);\n";
+  output << "      var r = {view:view, width:view.getUint32(4,true), height:view.getUint32(8,true), format:view.getUint32(12,true), scale:view.getFloat32(16,true), offset:view.getFloat32(20,true)};\n";
+  output << "      var valueSize = (r.format == " << VALUE_RASTER_FLOAT32 << ") ? 4 : 2;\n";
+  output << "      if (view.byteLength >= " << VALUE_RASTER_HEADER_SIZE << " + r.width*r.height*valueSize)\n";
+  output << "        valueRaster = r;\n";
+  output << "    }\n";
+  output << "  };\n";
+  output << "  xmlHttp.open(\"GET\", url, true);\n";
+  output << "  xmlHttp.send(null);\n";
+  output << "}\n";
+
+  output << "function halfToFloat(h)\n";
+  output << "{\n";
+  output << "  var s = (h & 0x8000) ? -1 : 1;\n";
+  output << "  var e = (h >> 10) & 0x1F;\n";
+  output << "  var f = h & 0x3FF;\n";
+  output << "  if (e == 0)\n";
+  output << "    return s * Math.pow(2,-24) * f;\n";
+  output << "  if (e == 31)\n";
+  output << "    return f ? null : s * Infinity;\n";
+  output << "  return s * Math.pow(2,e-15) * (1 + f/1024);\n";
+  output << "}\n";
+
+  output << "function rasterValue(r,prosX,prosY)\n";
+  output << "{\n";
+  output << "  if (!(prosX >= 0 && prosX <= 1 && prosY >= 0 && prosY <= 1))\n";
+  output << "    return null;\n";
+  output << "  var x = Math.min(r.width-1,Math.floor(prosX*r.width));\n";
+  output << "  var y = Math.min(r.height-1,Math.floor(prosY*r.height));\n";
+  output << "  var i = y*r.width + x;\n";
+  output << "  if (r.format == " << VALUE_RASTER_FLOAT32 << ")\n";
+  output << "  {\n";
+  output << "    var v = r.view.getFloat32(" << VALUE_RASTER_HEADER_SIZE << " + 4*i,true);\n";
+  output << "    return isNaN(v) ? null : v;\n";
+  output << "  }\n";
+  output << "  var h = r.view.getUint16(" << VALUE_RASTER_HEADER_SIZE << " + 2*i,true);\n";
+  output << "  if (r.format == " << VALUE_RASTER_FLOAT16 << ")\n";
+  output << "    return halfToFloat(h);\n";
+  output << "  if (h == " << VALUE_RASTER_MISSING16 << ")\n";
+  output << "    return null;\n";
+  output << "  var d = (r.scale < 1) ? Math.min(6,Math.ceil(-Math.log10(r.scale))) : 0;\n";
+  output << "  return Number((r.offset + r.scale*h).toFixed(d));\n";
   output << "}\n";
 
-  output << "function getImageCoords(event,img,fileId,messageIndex,presentation,sessionParam) {\n";
+  output << "function getImageCoords(event,img,fileId,messageIndex,presentation,sessionParam,hover) {\n";
   output << "  var posX = event.offsetX?(event.offsetX):event.pageX-img.offsetLeft;\n";
   output << "  var posY = event.offsetY?(event.offsetY):event.pageY-img.offsetTop;\n";
   output << "  var prosX = posX / img.width;\n";
   output << "  var prosY = posY / img.height;\n";
-  output << "  var url = \"/grid-gui?session=\" + sessionParam + \";" << ATTR_PAGE << "=value;" << ATTR_PRESENTATION << "=\" + presentation + \";" << ATTR_FILE_ID << "=\" + fileId + \";" << ATTR_MESSAGE_INDEX << "=\" + messageIndex + \";" << ATTR_X << "=\" + prosX + \";" << ATTR_Y << "=\" + prosY;\n";
-  output << "  var txt = httpGet(url);\n";
-  output << "  document.getElementById('gridValue').value = txt;\n";
+  output << "  if (valueRaster)\n";
+  output << "  {\n";
+  output << "    var v = rasterValue(valueRaster,prosX,prosY);\n";
+  output << "    document.getElementById('gridValue').value = (v === null) ? 'Not available' : v;\n";
+  output << "    return;\n";
+  output << "  }\n";
+  output << "  var url = \"/grid-gui?session=\" + sessionParam + \";" << ATTR_PAGE << "=values;" << ATTR_PRESENTATION << "=\" + presentation + \";" << ATTR_FILE_ID << "=\" + fileId + \";" << ATTR_MESSAGE_INDEX << "=\" + messageIndex;\n";
+  output << "  if (hover)\n";
+  output << "    hoverValue(url,prosX,prosY);\n";
+  output << "  else\n";
+  output << "    showValue(url,prosX,prosY);\n";
+
+  output << "}\n";
 
+  output << "function tileViewer(id,url,width,height,maxZoom,valueUrl)\n";
+  output << "{\n";
+  output << "  var view = document.getElementById(id);\n";
+  output << "  var tileSize = 256;\n";
+  output << "  var tiles = {};\n";
+  output << "  var drag = null;\n";
+  output << "  var ox = 0;\n";
+  output << "  var oy = 0;\n";
+  output << "  var z = 0;\n";
+  output << "  function levelSize(zoom)\n";
+  output << "  {\n";
+  output << "    var f = Math.pow(2,maxZoom-zoom);\n";
+  output << "    return [Math.ceil(width/f),Math.ceil(height/f)];\n";
+  output << "  }\n";
+  output << "  while (z < maxZoom && levelSize(z+1)[0] <= view.clientWidth && levelSize(z+1)[1] <= view.clientHeight)\n";
+  output << "    z++;\n";
+  output << "  function draw()\n";
+  output << "  {\n";
+  output << "    var s = levelSize(z);\n";
+  output << "    var tx1 = Math.max(0,Math.floor(ox/tileSize));\n";
+  output << "    var ty1 = Math.max(0,Math.floor(oy/tileSize));\n";
+  output << "    var tx2 = Math.min(Math.ceil(s[0]/tileSize),Math.ceil((ox+view.clientWidth)/tileSize));\n";
+  output << "    var ty2 = Math.min(Math.ceil(s[1]/tileSize),Math.ceil((oy+view.clientHeight)/tileSize));\n";
+  output << "    var used = {};\n";
+  output << "    for (var ty=ty1; ty<ty2; ty++)\n";
+  output << "    {\n";
+  output << "      for (var tx=tx1; tx<tx2; tx++)\n";
+  output << "      {\n";
+  output << "        var key = z + '/' + tx + '/' + ty;\n";
+  output << "        var img = tiles[key];\n";
+  output << "        if (!img)\n";
+  output << "        {\n";
+  output << "          img = document.createElement('img');\n";
+  output << "          img.style.position = 'absolute';\n";
+  output << "          img.draggable = false;\n";
+  output << "          img.src = url + '&tz=' + z + '&tx=' + tx + '&ty=' + ty;\n";
+  output << "          view.appendChild(img);\n";
+  output << "          tiles[key] = img;\n";
+  output << "        }\n";
+  output << "        img.style.left = (tx*tileSize - ox) + 'px';\n";
+  output << "        img.style.top = (ty*tileSize - oy) + 'px';\n";
+  output << "        used[key] = true;\n";
+  output << "      }\n";
+  output << "    }\n";
+  output << "    for (var k in tiles)\n";
+  output << "    {\n";
+  output << "      if (!used[k])\n";
+  output << "      {\n";
+  output << "        view.removeChild(tiles[k]);\n";
+  output << "        delete tiles[k];\n";
+  output << "      }\n";
+  output << "    }\n";
+  output << "  }\n";
+  output << "  function zoom(dz,cx,cy)\n";
+  output << "  {\n";
+  output << "    if (z+dz < 0 || z+dz > maxZoom)\n";
+  output << "      return;\n";
+  output << "    var s1 = levelSize(z);\n";
+  output << "    var s2 = levelSize(z+dz);\n";
+  output << "    ox = (ox+cx)*s2[0]/s1[0] - cx;\n";
+  output << "    oy = (oy+cy)*s2[1]/s1[1] - cy;\n";
+  output << "    z = z+dz;\n";
+  output << "    draw();\n";
+  output << "  }\n";
+  output << "  view.onmousedown = function(e)\n";
+  output << "  {\n";
+  output << "    drag = {x:e.clientX, y:e.clientY, ox:ox, oy:oy, moved:false};\n";
+  output << "    e.preventDefault();\n";
+  output << "  };\n";
+  output << "  function valuePosition(e)\n";
+  output << "  {\n";
+  output << "    var r = view.getBoundingClientRect();\n";
+  output << "    var s = levelSize(z);\n";
+  output << "    var p = [(ox + e.clientX - r.left) / s[0],(oy + e.clientY - r.top) / s[1]];\n";
+  output << "    if (p[0] >= 0 && p[0] < 1 && p[1] >= 0 && p[1] < 1)\n";
+  output << "      return p;\n";
+  output << "    return null;\n";
+  output << "  }\n";
+  output << "  view.addEventListener('mousemove',function(e)\n";
+  output << "  {\n";
+  output << "    var p = valuePosition(e);\n";
+  output << "    if (!drag && p && valueUrl)\n";
+  output << "      hoverValue(valueUrl,p[0],p[1]);\n";
+  output << "  });\n";
+  output << "  window.addEventListener('mousemove',function(e)\n";
+  output << "  {\n";
+  output << "    if (!drag)\n";
+  output << "      return;\n";
+  output << "    if (Math.abs(e.clientX-drag.x) + Math.abs(e.clientY-drag.y) > 3)\n";
+  output << "      drag.moved = true;\n";
+  output << "    ox = drag.ox - (e.clientX-drag.x);\n";
+  output << "    oy = drag.oy - (e.clientY-drag.y);\n";
+  output << "    draw();\n";
+  output << "  });\n";
+  output << "  window.addEventListener('mouseup',function(e)\n";
+  output << "  {\n";
+  output << "    if (drag && !drag.moved && valueUrl)\n";
+  output << "    {\n";
+  output << "      var p = valuePosition(e);\n";
+  output << "      if (p)\n";
+  output << "        showValue(valueUrl,p[0],p[1]);\n";
+  output << "    }\n";
+  output << "    drag = null;\n";
+  output << "  });\n";
+  output << "  view.onwheel = function(e)\n";
+  output << "  {\n";
+  output << "    var r = view.getBoundingClientRect();\n";
+  output << "    zoom(e.deltaY < 0 ? 1 : -1,e.clientX-r.left,e.clientY-r.top);\n";
+  output << "    e.preventDefault();\n";
+  output << "  };\n";
+  output << "  draw();\n";
   output << "}\n";
   output << "</SCRIPT>\n";
 }
@@ -3199,7 +5739,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     //session.print(std::cout,0,0);
 
-    auto contentServer = itsGridEngine->getContentServer_sptr();
+    checkContentCache();
 
     std::string producerIdStr = session.getAttribute(ATTR_PRODUCER_ID);
     std::string generationIdStr = session.getAttribute(ATTR_GENERATION_ID);
@@ -3349,9 +5889,8 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     // ### Producers:
 
     T::ProducerInfoList producerInfoList;
-    contentServer->getProducerInfoList(0,producerInfoList);
+    getCachedProducerInfoList(producerInfoList);
     uint len = producerInfoList.getLength();
-    producerInfoList.sortByName();
     T::ProducerId producerId = toUInt32(producerIdStr);
 
     ostr1 << "<TR height=\"15\" style=\"font-size:12;\"><TD>Producer:</TD></TR>\n";
@@ -3392,7 +5931,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     T::GenerationInfoList generationInfoList;
     T::GenerationInfoList generationInfoList2;
-    contentServer->getGenerationInfoListByProducerId(0,producerId,generationInfoList2);
+    getCachedGenerationInfoList(producerId,generationInfoList2);
     generationInfoList2.getGenerationInfoListByProducerId(producerId,generationInfoList);
     //generationInfoList2.getGenerationInfoListByProducerIdAndStatus(producerId,generationInfoList,T::GenerationInfo::Status::Ready);
 
@@ -3462,7 +6001,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     std::string paramDescription;
     std::set<std::string> paramKeyList;
-    contentServer->getContentParamKeyListByGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,paramKeyList);
+    getCachedParamKeyList(generationId,paramKeyList);
 
     ostr1 << "<TR height=\"15\" style=\"font-size:12;\"><TD>Parameter:</TD></TR>\n";
     ostr1 << "<TR height=\"30\"><TD>\n";
@@ -3547,16 +6086,14 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     // ### Level identifiers:
 
-    T::ContentInfoList contentInfoList;
-    contentServer->getContentListByParameterAndGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,parameterIdStr,-1,0,0,-2,-2,-2,"14000101T000000","30000101T000000",0,contentInfoList);
-    len = contentInfoList.getLength();
+    ContentIndex_sptr contentIndex = getContentIndex(generationId,parameterIdStr);
     int levelId = toInt32(levelIdStr);
 
     ostr1 << "<TR height=\"15\" style=\"font-size:12;\"><TD>Level type and value:</TD></TR>\n";
     ostr1 << "<TR height=\"30\"><TD>\n";
 
     std::set<int> levelIds;
-    getLevelIds(contentInfoList,levelIds);
+    getContentFacetKeys(&contentIndex->levelIds,levelIds);
 
     if (levelIds.find(levelId) == levelIds.end())
       levelId = -1;
@@ -3601,13 +6138,11 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     // ### Levels:
 
-    contentInfoList.clear();
-    contentServer->getContentListByParameterAndGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,parameterIdStr,levelId,0,0x7FFFFFFF,-2,-2,-2,"14000101T000000","30000101T000000",0,contentInfoList);
-    len = contentInfoList.getLength();
+    const ContentLevel_map *levelMap = findContentFacet(&contentIndex->levelIds,levelId);
     T::ParamLevel level = toInt32(levelStr);
 
     std::set<int> levels;
-    getLevels(contentInfoList,levelId,levels);
+    getContentFacetKeys(levelMap,levels);
 
     if (levels.find(level) == levels.end())
       level = 0;
@@ -3650,8 +6185,10 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     ostr1 << "<TR height=\"15\" style=\"font-size:12;\"><TD>Forecast type and number:</TD></TR>\n";
     ostr1 << "<TR height=\"30\"><TD>\n";
 
+    const ContentForecastType_map *forecastTypeMap = findContentFacet(levelMap,level);
+
     std::set<int> forecastTypes;
-    getForecastTypes(contentInfoList,levelId,level,forecastTypes);
+    getContentFacetKeys(forecastTypeMap,forecastTypes);
 
     if (forecastTypes.find(forecastType) == forecastTypes.end())
       forecastType = 0;
@@ -3696,8 +6233,10 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     short forecastNumber = toInt16(forecastNumberStr);
 
+    const ContentForecastNumber_map *forecastNumberMap = findContentFacet(forecastTypeMap,forecastType);
+
     std::set<int> forecastNumbers;
-    getForecastNumbers(contentInfoList,levelId,level,forecastType,forecastNumbers);
+    getContentFacetKeys(forecastNumberMap,forecastNumbers);
 
     if (forecastNumbers.find(forecastNumber) == forecastNumbers.end())
       forecastNumber = 0;
@@ -3739,8 +6278,10 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     ostr1 << "<TR height=\"15\" style=\"font-size:12;\"><TD>Geometry:</TD></TR>\n";
     ostr1 << "<TR height=\"30\"><TD>\n";
 
+    const ContentGeometry_map *geometryMap = findContentFacet(forecastNumberMap,forecastNumber);
+
     std::set<int> geometries;
-    getGeometries(contentInfoList,levelId,level,forecastType,forecastNumber,geometries);
+    getContentFacetKeys(geometryMap,geometries);
 
     if (geometries.find(geometryId) == geometries.end())
       geometryId = 0;
@@ -3808,9 +6349,8 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     // ### Times:
 
-    contentInfoList.clear();
-    contentServer->getContentListByParameterAndGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,parameterIdStr,levelId,level,level,-2,-2,-2,"14000101T000000","30000101T000000",0,contentInfoList);
-    len = contentInfoList.getLength();
+    const ContentInfoPtr_vec *times = findContentFacet(geometryMap,geometryId);
+    len = (times != nullptr) ? times->size() : 0;
 
     std::string pTime = timeStr;
     std::set<std::string> timeGroupStrList;
@@ -3846,7 +6386,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     if (timeStr.empty() &&  len > 0)
     {
-      T::ContentInfo *g = contentInfoList.getContentInfoByIndex(0);
+      T::ContentInfo *g = (*times)[0];
       std::string ft = g->getForecastTime();
       if (timeGroupStr.empty())
         timeGroupStr = ft.substr(0,timeGroupLen[timeGroupType]);
@@ -3859,22 +6399,13 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     {
       for (uint a=0; a<len; a++)
       {
-        T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+        T::ContentInfo *g = (*times)[a];
 
-        if (g->mGeometryId == geometryId)
+        if (prevTime < g->getForecastTime())
         {
-          if (prevTime < g->getForecastTime())
-          {
-            if (forecastType == g->mForecastType)
-            {
-              if (forecastNumber == g->mForecastNumber)
-              {
-                std::string ft = g->getForecastTime();
-                timeGroupStrList.insert(ft.substr(0,timeGroupLen[timeGroupType]));
-                tCount++;
-              }
-            }
-          }
+          std::string ft = g->getForecastTime();
+          timeGroupStrList.insert(ft.substr(0,timeGroupLen[timeGroupType]));
+          tCount++;
         }
       }
     }
@@ -3922,8 +6453,6 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     if (len > 0)
     {
-      contentInfoList.sort(T::ContentInfo::ComparisonMethod::fmiName_producer_generation_level_time);
-
       ostr1 << "<SELECT id=\"timeselect\" onchange=\"getPage(this,parent,'/grid-gui?session=" << session.getUrlParameter() + "' + this.options[this.selectedIndex].value)\">\n";
 
       std::string u;
@@ -3936,94 +6465,85 @@ int Plugin::page_main(Spine::Reactor &theReactor,
       uint cc = 0;
       for (uint a=0; a<len; a++)
       {
-        T::ContentInfo *g = contentInfoList.getContentInfoByIndex(a);
+        T::ContentInfo *g = (*times)[a];
 
         //printf("**** TIME %s (%s)  geom=%u %u  ft=%u %u   fn=%d %d \n",g->getForecastTime(),prevTime.c_str(),g->mGeometryId,geometryId,forecastType,g->mForecastType,forecastNumber,g->mForecastNumber);
 
-        if (g->mGeometryId == geometryId)
+        std::string ft = g->getForecastTime();
+        if (prevTime < ft  &&  (!useTimeGroup  || (useTimeGroup  &&  ft.substr(0,timeGroupLen[timeGroupType]) == timeGroupStr)))
         {
-          std::string ft = g->getForecastTime();
-          if (prevTime < ft  &&  (!useTimeGroup  || (useTimeGroup  &&  ft.substr(0,timeGroupLen[timeGroupType]) == timeGroupStr)))
-          {
-            if (forecastType == g->mForecastType)
-            {
-              if (forecastNumber == g->mForecastNumber)
-              {
-                std::ostringstream out;
-                out << "&" << ATTR_TIME << "=" << g->getForecastTime() << "&" << ATTR_FILE_ID << "=" << g->mFileId << "&" << ATTR_MESSAGE_INDEX << "=" << g->mMessageIndex << "&" << ATTR_FORECAST_TYPE << "=" << forecastTypeStr << "&" << ATTR_FORECAST_NUMBER << "=" << forecastNumberStr;
-                std::string url = out.str();
-                std::string uu = url;
-
-                if (currentCont != nullptr  &&  nextCont == nullptr)
-                  nextCont = g;
+          std::ostringstream out;
+          out << "&" << ATTR_TIME << "=" << g->getForecastTime() << "&" << ATTR_FILE_ID << "=" << g->mFileId << "&" << ATTR_MESSAGE_INDEX << "=" << g->mMessageIndex << "&" << ATTR_FORECAST_TYPE << "=" << forecastTypeStr << "&" << ATTR_FORECAST_NUMBER << "=" << forecastNumberStr;
+          std::string url = out.str();
+          std::string uu = url;
 
-                if (timeStr.empty())
-                {
-                  timeStr = g->getForecastTime();
-                  prevTime = timeStr;
-                  //printf("EMPTY => TIME %s\n",timeStr.c_str());
-                }
+          if (currentCont != nullptr  &&  nextCont == nullptr)
+            nextCont = g;
 
-                std::string bg = "#E0E0E0";
+          if (timeStr.empty())
+          {
+            timeStr = g->getForecastTime();
+            prevTime = timeStr;
+            //printf("EMPTY => TIME %s\n",timeStr.c_str());
+          }
 
-                if (strncmp(g->getForecastTime(),pTime.c_str(),8) != 0)
-                  daySwitch++;
+          std::string bg = "#E0E0E0";
 
-                if ((daySwitch % 2) == 1)
-                  bg = "#D0D0D0";
+          if (strncmp(g->getForecastTime(),pTime.c_str(),8) != 0)
+            daySwitch++;
 
-                if (timeStr == g->getForecastTime())
-                  bg = "#0000FF";
+          if ((daySwitch % 2) == 1)
+            bg = "#D0D0D0";
 
-                if (tCount < 124  ||  (g->getForecastTime() >= timeStr  &&  cc < 124))
-                {
-                  if (cc == 0)
-                  {
-                    ostr3 << "<TD style=\"text-align:center; font-size:12;width:30;background:#000000;color:#FFFFFF;\">UTC</TD>\n";
-                    ostr3 << "<TD style=\"text-align:center; font-size:12;width:120;background:#F0F0F0;\" id=\"ftime\">" + timeStr + "</TD><TD style=\"width:1;\"> </TD>\n";
-                  }
-
-                  if (u > " ")
-                  {
-                    ostr3 << "<TD style=\"width:5; background:" << bg << ";\" ";
-                    ostr3 << " onmouseout=\"this.style='width:5;background:"<< bg << ";'\"";
-                    ostr3 << " onmouseover=\"this.style='width:5;height:30;background:#FF0000;'; setText('ftime','" << g->getForecastTime() << "');setText('flevel','" << g->mParameterLevel << "');setImage(document.getElementById('myimage'),'" << u << uu << "');\"";
-                    ostr3 << " onClick=\"getPage(this,parent,'/grid-gui?session=" << session.getUrlParameter() << ";" << ATTR_TIME << "=" << g->getForecastTime() << ";" << ATTR_FILE_ID << "=" << g->mFileId << ";" << ATTR_MESSAGE_INDEX << "=" << g->mMessageIndex << ";" << ATTR_FORECAST_TYPE << "=" << g->mForecastType << ";" << ATTR_FORECAST_NUMBER << "=" << g->mForecastNumber << "');\" > </TD>\n";
-
-                  }
-                  else
-                    ostr3 << "<TD style=\"width:5; background:"+bg+";\"> </TD>\n";
-
-                  prevTime = g->getForecastTime();
-                  cc++;
-                }
+          if (timeStr == g->getForecastTime())
+            bg = "#0000FF";
 
-                if (timeStr == g->getForecastTime())
-                {
-                  //printf("## SELECTED TIME  [%s][%s]\n",timeStr.c_str(),g->getForecastTime());
-                  ostr1 << "<OPTION selected value=\"" <<  url << "\">" <<  g->getForecastTime() << "</OPTION>\n";
-                  currentCont = g;
-                  fmiKeyStr = getFmiKey(producerNameStr,*g);
-                  fileIdStr = std::to_string(g->mFileId);
-                  messageIndexStr = std::to_string(g->mMessageIndex);
-
-                  session.setAttribute(ATTR_FMI_KEY,fmiKeyStr);
-                  session.setAttribute(ATTR_FILE_ID,g->mFileId);
-                  session.setAttribute(ATTR_MESSAGE_INDEX,g->mMessageIndex);
-                  session.setAttribute(ATTR_TIME,g->getForecastTime());
-                }
-                else
-                {
-                  ostr1 << "<OPTION value=\"" <<  url << "\">" <<  g->getForecastTime() << "</OPTION>\n";
-                }
+          if (tCount < 124  ||  (g->getForecastTime() >= timeStr  &&  cc < 124))
+          {
+            if (cc == 0)
+            {
+              ostr3 << "<TD style=\"text-align:center; font-size:12;width:30;background:#000000;color:#FFFFFF;\">UTC</TD>\n";
+              ostr3 << "<TD style=\"text-align:center; font-size:12;width:120;background:#F0F0F0;\" id=\"ftime\">" + timeStr + "</TD><TD style=\"width:1;\"> </TD>\n";
+            }
 
-                if (currentCont == nullptr)
-                  prevCont = g;
+            if (u > " ")
+            {
+              ostr3 << "<TD style=\"width:5; background:" << bg << ";\" ";
+              ostr3 << " onmouseout=\"this.style='width:5;background:"<< bg << ";'\"";
+              ostr3 << " onmouseover=\"this.style='width:5;height:30;background:#FF0000;'; setText('ftime','" << g->getForecastTime() << "');setText('flevel','" << g->mParameterLevel << "');setImage(document.getElementById('myimage'),'" << u << uu << "');\"";
+              ostr3 << " onClick=\"getPage(this,parent,'/grid-gui?session=" << session.getUrlParameter() << ";" << ATTR_TIME << "=" << g->getForecastTime() << ";" << ATTR_FILE_ID << "=" << g->mFileId << ";" << ATTR_MESSAGE_INDEX << "=" << g->mMessageIndex << ";" << ATTR_FORECAST_TYPE << "=" << g->mForecastType << ";" << ATTR_FORECAST_NUMBER << "=" << g->mForecastNumber << "');\" > </TD>\n";
 
-                pTime = g->getForecastTime();
-              }
             }
+            else
+              ostr3 << "<TD style=\"width:5; background:"+bg+";\"> </TD>\n";
+
+            prevTime = g->getForecastTime();
+            cc++;
           }
+
+          if (timeStr == g->getForecastTime())
+          {
+            //printf("## SELECTED TIME  [%s][%s]\n",timeStr.c_str(),g->getForecastTime());
+            ostr1 << "<OPTION selected value=\"" <<  url << "\">" <<  g->getForecastTime() << "</OPTION>\n";
+            currentCont = g;
+            fmiKeyStr = getFmiKey(producerNameStr,*g);
+            fileIdStr = std::to_string(g->mFileId);
+            messageIndexStr = std::to_string(g->mMessageIndex);
+
+            session.setAttribute(ATTR_FMI_KEY,fmiKeyStr);
+            session.setAttribute(ATTR_FILE_ID,g->mFileId);
+            session.setAttribute(ATTR_MESSAGE_INDEX,g->mMessageIndex);
+            session.setAttribute(ATTR_TIME,g->getForecastTime());
+          }
+          else
+          {
+            ostr1 << "<OPTION value=\"" <<  url << "\">" <<  g->getForecastTime() << "</OPTION>\n";
+          }
+
+          if (currentCont == nullptr)
+            prevCont = g;
+
+          pTime = g->getForecastTime();
         }
       }
       ostr1 << "</SELECT>\n";
@@ -4046,11 +6566,11 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
 
 
-    T::ContentInfoList contentInfoListByLevels;
+    ContentInfoPtr_vec contentsByLevels;
     if (!timeStr.empty())
-      contentServer->getContentListByParameterAndGenerationId(0,generationId,T::ParamKeyTypeValue::FMI_NAME,parameterIdStr,levelId,0,1000000000,forecastType,forecastNumber,geometryId,timeStr,timeStr,0,contentInfoListByLevels);
+      getContentsByTime(levelMap,forecastType,forecastNumber,geometryId,timeStr,0,1000000000,contentsByLevels);
 
-    uint lCount = contentInfoListByLevels.getLength();
+    uint lCount = contentsByLevels.size();
 
     std::string u;
     if (presentation == "Image" ||  presentation == "Map" ||  presentation == "Streams")
@@ -4067,7 +6587,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
       for (uint a=0; a<lCount; a++)
       {
-        T::ContentInfo *g = contentInfoListByLevels.getContentInfoByIndex(a);
+        T::ContentInfo *g = contentsByLevels[a];
 
         std::ostringstream out;
         out << "&" << ATTR_TIME << "=" << timeStr << "&" << ATTR_FILE_ID << "=" << g->mFileId << "&" << ATTR_MESSAGE_INDEX << "=" << g->mMessageIndex << "&" << ATTR_FORECAST_TYPE << "=" << forecastTypeStr << "&" << ATTR_FORECAST_NUMBER << "=" << forecastNumberStr;
@@ -4098,7 +6618,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     // ### Presentation:
 
-    const char *modes[] = {"Image","Map","Streams","StreamsAnimation","Info","Table(sample)","Coordinates(sample)","Message",nullptr};
+    const char *modes[] = {"Image","Tiles","Map","Streams","StreamsAnimation","Info","Table(sample)","Coordinates(sample)","Message",nullptr};
 
     ostr1 << "<TR height=\"15\"><TD><HR/></TD></TR>\n";
     ostr1 << "<TR height=\"15\" style=\"font-size:12;\"><TD>Presentation:</TD></TR>\n";
@@ -4133,7 +6653,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
 
 
-    if (presentation == "Image" || presentation == "Streams" || presentation == "StreamsAnimation")
+    if (presentation == "Image" || presentation == "Tiles" || presentation == "Streams" || presentation == "StreamsAnimation")
     {
       // ### Projections:
 
@@ -4219,7 +6739,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     }
 
 
-    if (presentation == "Image" ||  presentation == "Map")
+    if (presentation == "Image" ||  presentation == "Tiles" ||  presentation == "Map")
     {
       // ### Color maps:
 
@@ -4282,7 +6802,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
 
 
-    if (presentation == "Image" || presentation == "Map" || presentation == "Streams" || presentation == "StreamsAnimation")
+    if (presentation == "Image" || presentation == "Tiles" || presentation == "Map" || presentation == "Streams" || presentation == "StreamsAnimation")
     {
       if ((colorMap.empty() || colorMap == "None") &&  presentation != "Streams" && presentation != "StreamsAnimation")
       {
@@ -4740,6 +7260,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     // ## Download
     ostr1 << "<TR height=\"30\" style=\"font-size:16; font-weight:bold; width:280px; color:#000000; background:#D0D0D0; vertical-align:middle; text-align:center; \"><TD><a href=\"grid-gui?" << ATTR_PAGE << "=download&" << ATTR_FILE_ID << "=" << fileIdStr << "&" << ATTR_MESSAGE_INDEX << "=" << messageIndexStr << "\">Download</a></TD></TR>\n";
+    ostr1 << "<TR height=\"30\" style=\"font-size:16; font-weight:bold; width:280px; color:#000000; background:#D0D0D0; vertical-align:middle; text-align:center; \"><TD><a href=\"grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=subset\">Download all times</a></TD></TR>\n";
     ostr1 << "</TABLE>\n";
 
 
@@ -4756,7 +7277,32 @@ int Plugin::page_main(Spine::Reactor &theReactor,
 
     if (presentation == "Image")
     {
-      ostr2 << "<TR><TD style=\"vertical-align:top;\"><IMG id=\"myimage\" style=\"background:#000000; max-width:1800; height:100%; max-height:1000;\" src=\"/grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=" << presentation << "\" onclick=\"getImageCoords(event,this," << fileIdStr << "," << messageIndexStr << ",'" << presentation << "','" << session.getUrlParameter() << "');\"/></TD></TR>";
+      ostr2 << "<TR><TD style=\"vertical-align:top;\"><IMG id=\"myimage\" style=\"background:#000000; max-width:1800; height:100%; max-height:1000;\" src=\"/grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=" << presentation << "\" onclick=\"getImageCoords(event,this," << fileIdStr << "," << messageIndexStr << ",'" << presentation << "','" << session.getUrlParameter() << "',false);\" onmousemove=\"getImageCoords(event,this," << fileIdStr << "," << messageIndexStr << ",'" << presentation << "','" << session.getUrlParameter() << "',true);\"/></TD></TR>";
+      ostr2 << "<SCRIPT>loadRaster('/grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=raster');</SCRIPT>\n";
+    }
+    else
+    if (presentation == "Tiles")
+    {
+      // ### The tiles are rendered and cached separately, so only the visible part of
+      // ### the grid is painted at each zoom level.
+
+      T::GeometryId tileGeometryId = toInt32(projectionIdStr);
+      if (tileGeometryId == 0)
+        tileGeometryId = toInt32(geometryIdStr);
+
+      uint cols = 0;
+      uint rows = 0;
+      Identification::gridDef.getGridDimensionsByGeometryId(tileGeometryId,cols,rows);
+
+      session.setAttribute(ATTR_TILE_Z,"0");
+      session.setAttribute(ATTR_TILE_X,"0");
+      session.setAttribute(ATTR_TILE_Y,"0");
+
+      std::string tileUrl = "/grid-gui?session=" + session.getUrlParameter() + "&" + ATTR_PAGE + "=tile";
+      std::string valueUrl = "/grid-gui?session=" + session.getUrlParameter() + ";" + ATTR_PAGE + "=values;" + ATTR_PRESENTATION + "=Tiles;" + ATTR_FILE_ID + "=" + fileIdStr + ";" + ATTR_MESSAGE_INDEX + "=" + messageIndexStr;
+
+      ostr2 << "<TR><TD style=\"vertical-align:top;\"><DIV id=\"tileview\" style=\"position:relative; overflow:hidden; background:#000000; width:1800px; height:1000px; cursor:move;\"></DIV></TD></TR>\n";
+      ostr2 << "<SCRIPT>tileViewer('tileview','" << tileUrl << "'," << cols << "," << rows << "," << getTileMaxZoom(cols,rows) << ",'" << valueUrl << "');</SCRIPT>\n";
     }
     else
     if (presentation == "Map")
@@ -4787,7 +7333,8 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     else
     if (presentation == "Streams" || presentation == "StreamsAnimation")
     {
-      ostr2 << "<TR><TD><IMG id=\"myimage\" style=\"background:#000000; max-width:1800; height:100%; max-height:1000;\" src=\"/grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=" << presentation << "\" onclick=\"getImageCoords(event,this," << fileIdStr << "," << messageIndexStr << ",'" << presentation << "','" << session.getUrlParameter() << "');\"/></TD></TR>";
+      ostr2 << "<TR><TD><IMG id=\"myimage\" style=\"background:#000000; max-width:1800; height:100%; max-height:1000;\" src=\"/grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=" << presentation << "\" onclick=\"getImageCoords(event,this," << fileIdStr << "," << messageIndexStr << ",'" << presentation << "','" << session.getUrlParameter() << "',false);\" onmousemove=\"getImageCoords(event,this," << fileIdStr << "," << messageIndexStr << ",'" << presentation << "','" << session.getUrlParameter() << "',true);\"/></TD></TR>";
+      ostr2 << "<SCRIPT>loadRaster('/grid-gui?session=" << session.getUrlParameter() << "&" << ATTR_PAGE << "=raster');</SCRIPT>\n";
     }
     else
     if (presentation == "Message")
@@ -4839,7 +7386,7 @@ int Plugin::page_main(Spine::Reactor &theReactor,
     ostr2 << "</TABLE>\n";
 
 
-    if (presentation == "Image" || presentation == "Map" || presentation == "Streams")
+    if (presentation == "Image" || presentation == "Tiles" || presentation == "Map" || presentation == "Streams")
     {
       output << "<TABLE height=\"100%\">\n";
     }
@@ -4953,6 +7500,12 @@ int Plugin::request(Spine::Reactor &theReactor,
       expires_seconds = 600;
     }
     else
+    if (strcasecmp(page.c_str(),"tile") == 0)
+    {
+      result = page_tile(theReactor,theRequest,theResponse,session);
+      expires_seconds = 600;
+    }
+    else
     if (strcasecmp(page.c_str(),"streams") == 0)
     {
       result = page_streams(theReactor,theRequest,theResponse,session);
@@ -4986,6 +7539,11 @@ int Plugin::request(Spine::Reactor &theReactor,
       result = page_download(theReactor,theRequest,theResponse,session);
     }
     else
+    if (strcasecmp(page.c_str(),"subset") == 0)
+    {
+      result = page_subset(theReactor,theRequest,theResponse,session);
+    }
+    else
     if (strcasecmp(page.c_str(),"table") == 0)
     {
       result = page_table(theReactor,theRequest,theResponse,session);
@@ -5002,6 +7560,17 @@ int Plugin::request(Spine::Reactor &theReactor,
     {
       result = page_value(theReactor,theRequest,theResponse,session);
     }
+    else
+    if (strcasecmp(page.c_str(),"values") == 0)
+    {
+      result = page_values(theReactor,theRequest,theResponse,session);
+    }
+    else
+    if (strcasecmp(page.c_str(),"raster") == 0)
+    {
+      result = page_raster(theReactor,theRequest,theResponse,session);
+      expires_seconds = 600;
+    }
 
     Fmi::DateTime t_now = Fmi::SecondClock::universal_time();
     Fmi::DateTime t_expires = t_now + Fmi::Seconds(expires_seconds);
@@ -1,6 +1,16 @@
 #pragma once
 
 #include "ColorMapFile.h"
+#include "ContentCache.h"
+#include "GridValueCache.h"
+#include "ImageCache.h"
+#include "ImageFileCache.h"
+#include "ImageWriter.h"
+#include "Reprojection.h"
+#include "SingleFlight.h"
+#include "StaticLayerCache.h"
+#include "ValueStats.h"
+#include "WorkerPool.h"
 #include <spine/SmartMetPlugin.h>
 #include <spine/Reactor.h>
 #include <spine/HTTP.h>
@@ -8,6 +18,9 @@
 #include <grid-files/common/ImageFunctions.h>
 #include <grid-files/common/BitLine.h>
 #include <grid-files/common/Session.h>
+#include <atomic>
+#include <functional>
+#include <thread>
 
 
 namespace SmartMet
@@ -25,7 +38,7 @@ typedef std::vector<std::pair<std::string,unsigned int>> Colors;  //!< Named col
  *  shading, coordinate lines) are bundled together rather than spread across many arguments. */
 struct ImagePaintParameters
 {
-  std::string imageFile;                        //!< Output image file path.
+  ImageData image;                              //!< Output: the encoded image (filled by saveImage()).
   T::FileId fileId = 0;                         //!< Grid file identifier.
   T::MessageIndex messageIndex = 0;             //!< Message index within the grid file.
   T::GeometryId geometryId = 0;                 //!< Source geometry identifier.
@@ -53,6 +66,14 @@ struct ImagePaintParameters
   uint seaShading_shadow = 160;                 //!< Shadow intensity for sea depth shading.
   uint seaShading_position = 2;                 //!< Z-order position for the sea shading layer.
   uint coordinateLine_color = 0xFFC0C0C0;       //!< Packed ARGB color for latitude/longitude grid lines.
+  uint image_maxWidth = 0;                      //!< Maximum image width; wider grids are downsampled (0 = no limit).
+  uint image_maxHeight = 0;                     //!< Maximum image height; taller grids are downsampled (0 = no limit).
+  std::string image_area;                       //!< Crop area "lon1,lat1,lon2,lat2" or "grid:x1,y1,x2,y2" (empty = the whole grid).
+  int  image_rotate = -1;                       //!< Flip the rows (1), keep them (0) or decide by the coordinates (-1).
+  int  tile_zoom = -1;                          //!< Zoom level of the requested tile (-1 = the whole grid).
+  uint tile_x = 0;                              //!< Column of the requested tile.
+  uint tile_y = 0;                              //!< Row of the requested tile.
+  ValueStats_sptr valueStats;                   //!< Statistics of the whole message (nullptr = computed from the painted values).
 };
 
 
@@ -118,6 +139,21 @@ class Plugin : public SmartMetPlugin
                       Spine::HTTP::Response& theResponse,
                       Session& session);
 
+    int page_values(Spine::Reactor& theReactor,
+                      const Spine::HTTP::Request& theRequest,
+                      Spine::HTTP::Response& theResponse,
+                      Session& session);
+
+    int page_raster(Spine::Reactor& theReactor,
+                      const Spine::HTTP::Request& theRequest,
+                      Spine::HTTP::Response& theResponse,
+                      Session& session);
+
+    int page_subset(Spine::Reactor& theReactor,
+                      const Spine::HTTP::Request& theRequest,
+                      Spine::HTTP::Response& theResponse,
+                      Session& session);
+
     int page_table(Spine::Reactor& theReactor,
                       const Spine::HTTP::Request& theRequest,
                       Spine::HTTP::Response& theResponse,
@@ -133,6 +169,19 @@ class Plugin : public SmartMetPlugin
                       Spine::HTTP::Response& theResponse,
                       Session& session);
 
+    int page_tile(Spine::Reactor& theReactor,
+                      const Spine::HTTP::Request& theRequest,
+                      Spine::HTTP::Response& theResponse,
+                      Session& session);
+
+    /*! \brief Shared implementation for the image and tile page handlers.
+     *  When tile is false: emits a PNG of the whole grid.
+     *  When tile is true: emits a 256 x 256 PNG tile of the image pyramid. */
+    int page_imageImpl(const Spine::HTTP::Request& theRequest,
+                         Spine::HTTP::Response& theResponse,
+                         Session& session,
+                         bool tile);
+
     int page_streams(Spine::Reactor& theReactor,
                       const Spine::HTTP::Request& theRequest,
                       Spine::HTTP::Response& theResponse,
@@ -156,11 +205,12 @@ class Plugin : public SmartMetPlugin
      *  etc.).  Writes directly to the given output stream. */
     void page_main_writeJavascript(std::ostringstream& output);
 
-    /*! \brief Scan a parameter-value vector and compute the minimum, maximum and a
-     *  per-class step size used by saveMap()'s implicit colour scaling when no explicit
-     *  colour map file is configured.  The step is clamped so that an asymmetric
-     *  distribution (max >> avg) doesn't compress most of the range into one bucket. */
-    void computeValueRangeForMap(const T::ParamValue_vec& values,
+    /*! \brief Compute the minimum, maximum and a per-class step size from the value
+     *  statistics for the implicit HSV colour scaling used by saveImage() and saveMap()
+     *  when no explicit colour map file is configured.  The step is clamped so that an
+     *  asymmetric distribution (max >> avg) doesn't compress most of the range into one
+     *  bucket. */
+    void computeValueRangeForMap(const ValueStats& stats,
                                  double& minValue,
                                  double& maxValue,
                                  double& step);
@@ -177,16 +227,56 @@ class Plugin : public SmartMetPlugin
 
 
     void saveImage(ImagePaintParameters& params,int width,int height,
-                      T::ParamValue_vec& values,
+                      const T::ParamValue_vec& values,
                       T::Coordinate_vec& coordinates,
                       T::Coordinate_vec *lineCoordinates);
 
     void saveImage(ImagePaintParameters& params);
 
-    void saveMap(const char *imageFile,
+    std::string getMessageKey(T::FileId fileId,T::MessageIndex messageIndex);
+    int getGridValues(T::FileId fileId,T::MessageIndex messageIndex,T::GeometryId geometryId,GridValues_sptr& values);
+    int getGridValues(const std::string& key,const std::function<int(GridValues&)>& load,GridValues_sptr& values);
+    ReprojectionTable_sptr getReprojectionTable(T::GeometryId sourceGeometryId,T::GeometryId targetGeometryId);
+    ValueStats_sptr getValueStats(const std::string& key,const T::ParamValue_vec& values);
+    StaticLayers_sptr getStaticLayers(ImagePaintParameters& params,int width,int height,T::Coordinate_vec& coordinates,bool rotate);
+    StaticLayers_sptr createStaticLayers(ImagePaintParameters& params,int width,int height,T::Coordinate_vec& coordinates,bool rotate);
+    void processRowBands(int height,std::size_t pixels,const std::function<void(int,int)>& func);
+    uint getDownsampleFactor(ImagePaintParameters& params,int width,int height);
+    uint getTileMaxZoom(int width,int height);
+    std::string getRequestAttribute(const Spine::HTTP::Request& theRequest,Session& session,const char *name);
+    int getByteRange(const Spine::HTTP::Request& theRequest,const std::string& etag,std::size_t size,std::size_t& start,std::size_t& end);
+    bool getLocalMessage(T::FileId fileId,T::MessageIndex messageIndex,std::string& fileName,std::size_t& position,std::size_t& size,std::string& trailer);
+    void getTableWindow(const Spine::HTTP::Request& theRequest,Session& session,uint width,uint height,uint& x,uint& y,uint& columns,uint& rows,uint& step);
+    std::string getTableNavigation(Session& session,const char *page,uint width,uint height,uint x,uint y,uint columns,uint rows,uint step);
+    int getImageArea(ImagePaintParameters& params,int width,int height,T::Coordinate_vec& coordinates,int& x1,int& y1,int& x2,int& y2);
+    int checkImageArea(const std::string& area,T::GeometryId geometryId);
+    void saveGridImage(ImagePaintParameters& params,int width,int height,
+                      const T::ParamValue_vec& values,
+                      T::Coordinate_vec& coordinates,
+                      T::Coordinate_vec *lineCoordinates);
+    void saveArea(ImagePaintParameters& params,int width,int height,
+                      const T::ParamValue_vec& values,
+                      T::Coordinate_vec& coordinates,
+                      T::Coordinate_vec *lineCoordinates);
+    void saveTile(ImagePaintParameters& params,int width,int height,
+                      const T::ParamValue_vec& values,
+                      T::Coordinate_vec& coordinates,
+                      T::Coordinate_vec *lineCoordinates);
+    void downsampleGrid(ImagePaintParameters& params,uint factor,int width,int height,int x1,int y1,int x2,int y2,
+                      const T::ParamValue_vec& values,
+                      T::Coordinate_vec& coordinates,
+                      T::Coordinate_vec *lineCoordinates,
+                      int& newWidth,
+                      int& newHeight,
+                      T::ParamValue_vec& newValues,
+                      T::Coordinate_vec& newCoordinates,
+                      T::Coordinate_vec& newLineCoordinates);
+
+    void saveMap(ImageData& mapImage,
                       uint columns,
                       uint rows,
-                      T::ParamValue_vec& values,
+                      const T::ParamValue_vec& values,
+                      const ValueStats& valueStats,
                       unsigned char hue,
                       unsigned char saturation,
                       unsigned char blur,
@@ -200,19 +290,25 @@ class Plugin : public SmartMetPlugin
 
     T::ColorMapFile*  getColorMapFile(std::string colorMapName);
 
-    void checkImageCache();
+    void checkContentCache();
+    void getCachedProducerInfoList(T::ProducerInfoList& producerInfoList);
+    void getCachedGenerationInfoList(T::ProducerId producerId,T::GenerationInfoList& generationInfoList);
+    void getCachedParamKeyList(T::GenerationId generationId,std::set<std::string>& paramKeyList);
+    ContentIndex_sptr getContentIndex(T::GenerationId generationId,const std::string& parameterId);
     void getGenerations(T::GenerationInfoList& generationInfoList,std::set<std::string>& generations);
-    void getLevelIds(T::ContentInfoList& contentInfoList,std::set<int>& levelIds);
-    void getLevels(T::ContentInfoList& contentInfoList,int levelId,std::set<int>& levels);
     std::string getFmiKey(std::string& producerName,T::ContentInfo& contentInfo);
-    void getForecastTypes(T::ContentInfoList& contentInfoList,int levelId,int level,std::set<int>& forecastTypes);
-    void getForecastNumbers(T::ContentInfoList& contentInfoList,int levelId,int level,int forecastType,std::set<int>& forecastNumbers);
-    void getGeometries(T::ContentInfoList& contentInfoList,int levelId,int level,int forecastType,int forecastNumber,std::set<int>& geometries);
     uint getColorValue(std::string& colorName);
     void initSession(Session& session);
     void loadColorFile();
     void loadProducerFile();
-    bool loadImage(const char *fname,Spine::HTTP::Response &theResponse);
+    bool loadImage(const char *fname,const std::string& hash,ImageData& image);
+    std::string getImageFileName(const std::string& hash,const char *fileExt);
+    bool getCachedImage(const std::string& hash,const char *fileExt,ImageData& image);
+    void scanImageCache();
+    void imageCacheThread();
+    void renderImage(const std::string& hash,const char *fileExt,ImageData& image,const std::function<void(ImageData&)>& renderFunction);
+    void setImageResponse(const ImageData& image,Spine::HTTP::Response &theResponse);
+    int  getImage(const std::string& hash,const char *fileExt,Spine::HTTP::Response &theResponse,const std::function<void(ImageData&)>& renderFunction);
 
   private:
 
@@ -228,9 +324,23 @@ class Plugin : public SmartMetPlugin
     std::string               itsImageCache_dir;                //!< Directory where rendered image files are cached.
     uint                      itsImageCache_maxImages;          //!< Maximum number of images to keep in the cache before pruning.
     uint                      itsImageCache_minImages;          //!< Minimum number of images to retain after a prune pass.
+    uint                      itsImageCache_maxSize;            //!< Byte budget (in megabytes) of the image cache directory; 0 = no byte limit.
+    uint                      itsImageCache_memorySize;         //!< Byte budget (in megabytes) of the in-memory image cache.
+    uint                      itsImageCache_layerMemorySize;    //!< Byte budget (in megabytes) of the static layer cache.
+    uint                      itsImageCache_renderTimeout;      //!< Seconds to wait for an image that another thread is rendering.
+    uint                      itsImageCache_maxAge;             //!< Image files older than this (in seconds) are removed; 0 = no age limit.
+    uint                      itsImageCache_writeQueueSize;     //!< Maximum number of images waiting to be written into the cache directory.
+    uint                      itsRendering_threads;             //!< Size of the render thread pool; 0 = number of hardware threads.
+    uint                      itsRendering_minPixelsPerThread;  //!< Images smaller than this (per thread) are not split into row bands.
+    uint                      itsValueCache_memorySize;         //!< Byte budget (in megabytes) of the decoded grid value cache.
+    uint                      itsValueCache_statsCount;         //!< Maximum number of messages in the value statistics cache.
+    uint                      itsValueCache_reprojectionMemorySize; //!< Byte budget (in megabytes) of the reprojection table cache.
+    uint                      itsContentCache_maxAge;           //!< Content listings older than this (in seconds) are fetched again; 0 = no age limit.
+    uint                      itsContentCache_maxEntries;       //!< Maximum number of content listings in the content listing cache.
+    std::thread               itsImageCacheThread;              //!< Background thread that indexes and cleans the image cache directory.
+    std::atomic<bool>         itsShutdownRequested;             //!< Tells the background threads to stop.
     bool                      itsAnimationEnabled;              //!< Whether WebP animation rendering is enabled.
-    std::string               itsImagesUnderConstruction[100];  //!< Slot array tracking image files currently being rendered (prevents duplicate work).
-    uint                      itsImageCounter;                  //!< Rolling counter used to generate unique image file names.
+    SingleFlight<ImageData>   itsImageFlights;                  //!< Image renders in progress (only one render per image hash).
     ThreadLock                itsThreadLock;                    //!< Lock serialising concurrent access to image cache state.
     std::string               itsProducerFile;                  //!< Path to the producer filter file listing visible producers.
     time_t                    itsProducerFile_modificationTime; //!< Last-modified time of itsProducerFile; used to detect reload need.
@@ -238,7 +348,19 @@ class Plugin : public SmartMetPlugin
     std::set<int>             itsBlockedProjections;            //!< Geometry IDs excluded from the projection selector (too large to display).
 
     std::shared_ptr<Engine::Grid::Engine> itsGridEngine;        //!< Grid engine used for content and data server access.
-    std::map<std::string,std::string>      itsImages;           //!< Maps image hash keys to cached image file paths.
+    ImageFileCache                         itsImageFileCache;   //!< Index of the cached image files (size, last access, hit count).
+    ImageCache                             itsImageMemoryCache; //!< In-memory tier of the image cache, checked before itsImageFileCache.
+    StaticLayerCache                       itsStaticLayerCache; //!< Land and sea layers by geometry and layer parameters.
+    ImageWriter                            itsImageWriter;      //!< Writes the rendered images into the cache directory in the background.
+    SingleFlight<StaticLayers_sptr>        itsStaticLayerFlights;  //!< Static layer computations in progress.
+    WorkerPool                             itsWorkerPool;       //!< Threads rendering the row bands of large images.
+    WorkerPool                             itsFetchPool;        //!< Threads fetching the remote messages of the subset downloads.
+    ValueStatsCache                        itsValueStatsCache;  //!< Value statistics by file, message and geometry.
+    GridValueCache                         itsGridValueCache;   //!< Decoded grid values by file, message and geometry.
+    SingleFlight<GridValues_sptr>          itsGridValueFlights; //!< Grid value loads in progress.
+    ReprojectionCache                      itsReprojectionCache;   //!< Reprojection tables by source and target geometry.
+    SingleFlight<ReprojectionTable_sptr>   itsReprojectionFlights; //!< Reprojection table computations in progress.
+    ContentCache                           itsContentCache;     //!< Content server listings of the main page.
 };  // class Plugin
 
 }  // namespace GridGui
@@ -0,0 +1,212 @@
+#include "Reprojection.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <grid-files/identification/GridDef.h>
+#include <cmath>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Compute the bilinear interpolation table from the source geometry
+ *  to the target geometry. Returns false if the geometries are not known. */
+
+bool createReprojectionTable(T::GeometryId sourceGeometryId,T::GeometryId targetGeometryId,ReprojectionTable& table)
+{
+  try
+  {
+    uint columns = 0;
+    uint rows = 0;
+    if (!Identification::gridDef.getGridDimensionsByGeometryId(targetGeometryId,columns,rows))
+      return false;
+
+    T::Coordinate_svec targetCoordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(targetGeometryId);
+    if (!targetCoordinates  ||  targetCoordinates->size() != static_cast<std::size_t>(columns) * rows)
+      return false;
+
+    if (!createReprojectionTable(sourceGeometryId,*targetCoordinates,table))
+      return false;
+
+    table.columns = columns;
+    table.rows = rows;
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Source geometry",std::to_string(sourceGeometryId));
+    exception.addParameter("Target geometry",std::to_string(targetGeometryId));
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Compute the bilinear interpolation table from the source geometry
+ *  to the given lat/lon points. The table has one row. Returns false if the source
+ *  geometry is not known. */
+
+bool createReprojectionTable(T::GeometryId sourceGeometryId,const T::Coordinate_vec& coordinates,ReprojectionTable& table)
+{
+  try
+  {
+    if (!Identification::gridDef.getGridDimensionsByGeometryId(sourceGeometryId,table.sourceColumns,table.sourceRows))
+      return false;
+
+    uint sourceColumns = table.sourceColumns;
+    uint sourceRows = table.sourceRows;
+    if (sourceColumns < 2 || sourceRows < 2)
+      return false;
+
+    std::size_t size = coordinates.size();
+    table.columns = size;
+    table.rows = 1;
+
+    // ### A global source grid wraps around in the longitude direction, so the points
+    // ### after the last column are interpolated between the last and the first column.
+
+    bool wrap = false;
+    T::Coordinate_svec sourceCoordinates = Identification::gridDef.getGridLatLonCoordinatesByGeometryId(sourceGeometryId);
+    if (sourceCoordinates  &&  sourceCoordinates->size() == static_cast<std::size_t>(sourceColumns) * sourceRows)
+    {
+      double dx = fabs((*sourceCoordinates)[1].x() - (*sourceCoordinates)[0].x());
+      double width = fabs((*sourceCoordinates)[sourceColumns-1].x() - (*sourceCoordinates)[0].x()) + dx;
+      wrap = (dx > 0  &&  fabs(width - 360.0) < dx/2);
+    }
+
+    double maxX = wrap ? C_DOUBLE(sourceColumns) : C_DOUBLE(sourceColumns - 1);
+    double maxY = C_DOUBLE(sourceRows - 1);
+
+    table.points.resize(size);
+
+    for (std::size_t t=0; t<size; t++)
+    {
+      ReprojectionPoint& point = table.points[t];
+      point.index = REPROJECTION_OUTSIDE;
+      point.right = 1;
+      point.fx = 0;
+      point.fy = 0;
+
+      const T::Coordinate& coordinate = coordinates[t];
+      double x = 0;
+      double y = 0;
+      if (!Identification::gridDef.getGridPointByGeometryIdAndLatLonCoordinates(sourceGeometryId,coordinate.y(),coordinate.x(),x,y))
+        continue;
+
+      if (wrap)
+      {
+        if (x < 0)
+          x += sourceColumns;
+        if (x >= sourceColumns)
+          x -= sourceColumns;
+      }
+
+      // ### A small tolerance for the points that are exactly on the border.
+
+      if (x < -0.001 || y < -0.001 || x > maxX + 0.001 || y > maxY + 0.001)
+        continue;
+
+      x = std::max(0.0,std::min(x,maxX));
+      y = std::max(0.0,std::min(y,maxY));
+
+      // ### The last column and row are interpolated from the previous cell, so all
+      // ### four neighbours are always inside the grid.
+
+      uint i = C_UINT(x);
+      uint j = C_UINT(y);
+
+      if (i >= sourceColumns - 1)
+      {
+        if (wrap)
+        {
+          i = sourceColumns - 1;
+          point.right = 1 - C_INT(sourceColumns);
+        }
+        else
+        {
+          i = sourceColumns - 2;
+        }
+      }
+
+      if (j >= sourceRows - 1)
+        j = sourceRows - 2;
+
+      point.index = j*sourceColumns + i;
+      point.fx = static_cast<float>(x - i);
+      point.fy = static_cast<float>(y - j);
+    }
+
+    return true;
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.addParameter("Source geometry",std::to_string(sourceGeometryId));
+    throw exception;
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Interpolate the target values start..end-1 from the source values.
+ *  If one of the four neighbours is missing, the nearest neighbour is used instead. */
+
+void reproject(const ReprojectionTable& table,const T::ParamValue_vec& sourceValues,std::size_t start,std::size_t end,T::ParamValue *values)
+{
+  try
+  {
+    if (sourceValues.size() < static_cast<std::size_t>(table.sourceColumns) * table.sourceRows)
+      throw Fmi::Exception(BCP,"The source grid does not match to the reprojection table!");
+
+    const T::ParamValue *src = sourceValues.data();
+    const ReprojectionPoint *points = table.points.data();
+    uint columns = table.sourceColumns;
+
+    for (std::size_t t=start; t<end; t++)
+    {
+      const ReprojectionPoint& point = points[t];
+      if (point.index == REPROJECTION_OUTSIDE)
+      {
+        values[t] = ParamValueMissing;
+        continue;
+      }
+
+      const T::ParamValue *p = src + point.index;
+      float v00 = p[0];
+      float v10 = p[point.right];
+      float v01 = p[columns];
+      float v11 = p[columns + point.right];
+
+      if (v00 == ParamValueMissing || v10 == ParamValueMissing || v01 == ParamValueMissing || v11 == ParamValueMissing)
+      {
+        if (point.fy < 0.5f)
+          values[t] = (point.fx < 0.5f) ? v00 : v10;
+        else
+          values[t] = (point.fx < 0.5f) ? v01 : v11;
+        continue;
+      }
+
+      float bottom = v00 + point.fx * (v10 - v00);
+      float top = v01 + point.fx * (v11 - v01);
+      values[t] = bottom + point.fy * (top - bottom);
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "LruCache.h"
+#include <grid-files/common/Typedefs.h>
+#include <memory>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+/*! \brief Bilinear interpolation point of a reprojection table. The point is
+ *  interpolated from the source cells index, index+right, index+columns and
+ *  index+columns+right. */
+
+struct ReprojectionPoint
+{
+  uint              index;                      //!< Source cell below and left of the point (REPROJECTION_OUTSIDE = outside of the source grid).
+  int               right;                      //!< Offset to the right neighbour (1, or 1-columns when the source grid wraps around the globe).
+  float             fx;                         //!< Horizontal weight of the right neighbours (0..1).
+  float             fy;                         //!< Vertical weight of the upper neighbours (0..1).
+};
+
+#define REPROJECTION_OUTSIDE 0xFFFFFFFF
+
+
+
+/*! \brief Interpolation table from a source geometry to a target geometry. The table
+ *  depends only on the geometries, so it is shared by all the messages of the source
+ *  geometry. */
+
+struct ReprojectionTable
+{
+  uint              sourceColumns = 0;          //!< Number of columns in the source grid.
+  uint              sourceRows = 0;             //!< Number of rows in the source grid.
+  uint              columns = 0;                //!< Number of columns in the target grid.
+  uint              rows = 0;                   //!< Number of rows in the target grid.
+  std::vector<ReprojectionPoint> points;        //!< Interpolation points (rows * columns).
+
+  std::size_t       getSize() const
+  {
+    return points.size() * sizeof(ReprojectionPoint) + sizeof(ReprojectionTable);
+  }
+};
+
+typedef std::shared_ptr<const ReprojectionTable> ReprojectionTable_sptr;
+
+
+bool createReprojectionTable(T::GeometryId sourceGeometryId,T::GeometryId targetGeometryId,ReprojectionTable& table);
+bool createReprojectionTable(T::GeometryId sourceGeometryId,const T::Coordinate_vec& coordinates,ReprojectionTable& table);
+void reproject(const ReprojectionTable& table,const T::ParamValue_vec& sourceValues,std::size_t start,std::size_t end,T::ParamValue *values);
+
+
+
+// ====================================================================================
+/*! \brief Byte-budgeted in-memory cache of the reprojection tables.
+ *
+ *  Computing the position of each target cell in the source grid is much more
+ *  expensive than the interpolation itself, so the tables are computed once per
+ *  (source geometry, target geometry, interpolation method) key. */
+// ====================================================================================
+
+typedef LruCache<ReprojectionTable_sptr,LruObjectSize> ReprojectionCache;
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <chrono>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ====================================================================================
+/*! \brief Single-flight coordination of expensive operations (renders, data loads).
+ *
+ *  The first caller of start() for a key becomes the leader and must eventually call
+ *  finish() or abort().  Later callers receive a shared future of the leader's result
+ *  and block on it with wait() until the leader is ready, instead of polling.  The
+ *  leader's exception is delivered to every waiter. */
+// ====================================================================================
+
+template <class RESULT>
+class SingleFlight
+{
+  public:
+
+    /*! \brief Start or join a flight.  Returns true if the caller is the leader;
+     *  otherwise the future of the running flight is returned. */
+    bool start(const std::string& key,std::shared_future<RESULT>& future)
+    {
+      try
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mFlights.find(key);
+        if (it != mFlights.end())
+        {
+          future = it->second.future;
+          return false;
+        }
+
+        Flight flight;
+        flight.promise = std::make_shared<std::promise<RESULT>>();
+        flight.future = flight.promise->get_future().share();
+        future = flight.future;
+        mFlights.insert(std::make_pair(key,flight));
+        return true;
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Complete the flight and wake up all waiters. */
+    void finish(const std::string& key,const RESULT& result)
+    {
+      try
+      {
+        std::shared_ptr<std::promise<RESULT>> promise = release(key);
+        if (promise)
+          promise->set_value(result);
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Fail the flight. The exception is rethrown to all waiters. */
+    void abort(const std::string& key,std::exception_ptr exception)
+    {
+      try
+      {
+        std::shared_ptr<std::promise<RESULT>> promise = release(key);
+        if (promise)
+          promise->set_exception(exception);
+      }
+      catch (...)
+      {
+        throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+      }
+    }
+
+
+    /*! \brief Wait for the result of a flight at most timeout seconds. Returns false
+     *  on timeout; rethrows the leader's exception. */
+    static bool wait(std::shared_future<RESULT>& future,uint timeout,RESULT& result)
+    {
+      if (future.wait_for(std::chrono::seconds(timeout)) != std::future_status::ready)
+        return false;
+
+      result = future.get();
+      return true;
+    }
+
+  private:
+
+    struct Flight
+    {
+      std::shared_ptr<std::promise<RESULT>> promise;  //!< Fulfilled by the leader.
+      std::shared_future<RESULT>            future;   //!< Shared with the waiters.
+    };
+
+    std::shared_ptr<std::promise<RESULT>> release(const std::string& key)
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      auto it = mFlights.find(key);
+      if (it == mFlights.end())
+        return nullptr;
+
+      std::shared_ptr<std::promise<RESULT>> promise = it->second.promise;
+      mFlights.erase(it);
+      return promise;
+    }
+
+    std::mutex                                mMutex;     //!< Lock protecting mFlights.
+    std::unordered_map<std::string,Flight>    mFlights;   //!< Flights in progress by key.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "LruCache.h"
+#include <grid-files/common/Typedefs.h>
+#include <memory>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+/*! \brief The static (data independent) layers of an image: land and sea colors,
+ *  shadings and land borders. The layers painted below the data are composited into
+ *  bottomImage; the other layers are painted above the data. A layer is empty if it
+ *  is not painted. */
+
+struct StaticLayers
+{
+  std::vector<uint> bottomImage;                //!< Composite of the layers below the data.
+  std::vector<uint> seaImage;                   //!< Sea color layer.
+  std::vector<uint> seaShadingImage;            //!< Sea depth shading layer.
+  std::vector<uint> landImage;                  //!< Land color layer.
+  std::vector<uint> landShadingImage;           //!< Land topography shading layer.
+  std::vector<uint> landBorderImage;            //!< Land border (coast line) layer.
+
+  std::size_t       getSize() const
+  {
+    return (bottomImage.size() + seaImage.size() + seaShadingImage.size() + landImage.size() + landShadingImage.size() + landBorderImage.size()) * sizeof(uint);
+  }
+};
+
+typedef std::shared_ptr<const StaticLayers> StaticLayers_sptr;
+
+
+
+// ====================================================================================
+/*! \brief Byte-budgeted in-memory cache of the static image layers.
+ *
+ *  The land and sea layers depend only on the geometry and on the land/sea paint
+ *  parameters, so they are computed once per (geometry, layer parameters) key and
+ *  shared by all the images of that geometry. */
+// ====================================================================================
+
+typedef LruCache<StaticLayers_sptr,LruObjectSize> StaticLayerCache;
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
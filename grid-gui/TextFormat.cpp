@@ -0,0 +1,148 @@
+#include "TextFormat.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Append a floating point number with the given number of decimals
+ *  (like "%.*f"). Uses std::to_chars when the standard library supports it for the
+ *  floating point numbers. */
+
+void appendNumber(std::string& output,double value,int precision)
+{
+  try
+  {
+    char buffer[512];
+
+#if defined(__cpp_lib_to_chars)
+    auto res = std::to_chars(buffer,buffer + sizeof(buffer),value,std::chars_format::fixed,precision);
+    if (res.ec == std::errc())
+    {
+      output.append(buffer,res.ptr - buffer);
+      return;
+    }
+#endif
+
+    int len = snprintf(buffer,sizeof(buffer),"%.*f",precision,value);
+    if (len > 0)
+      output.append(buffer,std::min(C_UINT(len),C_UINT(sizeof(buffer) - 1)));
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Append an unsigned integer. */
+
+void appendNumber(std::string& output,std::size_t value)
+{
+  try
+  {
+    char buffer[32];
+    auto res = std::to_chars(buffer,buffer + sizeof(buffer),value);
+    output.append(buffer,res.ptr - buffer);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Hex digit pairs of all the byte values ("000102...FF"). */
+
+static const char *getHexTable()
+{
+  static const std::string table = []()
+  {
+    const char *digits = "0123456789ABCDEF";
+    std::string t(512,'0');
+    for (uint v=0; v<256; v++)
+    {
+      t[2*v] = digits[v >> 4];
+      t[2*v+1] = digits[v & 0x0F];
+    }
+    return t;
+  }();
+
+  return table.c_str();
+}
+
+
+
+
+
+/*! \brief GridGui: Append an unsigned integer as a hex number with the given number
+ *  of digits (like "%0*X"). Each byte is taken from a table. */
+
+void appendHex(std::string& output,std::size_t value,uint digits)
+{
+  try
+  {
+    const char *table = getHexTable();
+    char buffer[32];
+    if (digits > sizeof(buffer))
+      digits = sizeof(buffer);
+
+    char *p = buffer + digits;
+    for (uint d=0; d<digits; d += 2)
+    {
+      const char *hex = table + 2*(value & 0xFF);
+      value >>= 8;
+      *--p = hex[1];
+      if (d + 1 < digits)
+        *--p = hex[0];
+    }
+
+    output.append(buffer,digits);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the character shown for a byte in the ASCII columns: letters
+ *  and digits as they are, other bytes as '.'. */
+
+char getPrintableChar(uchar value)
+{
+  static const std::string table = []()
+  {
+    std::string t(256,'.');
+    for (uint v=0; v<256; v++)
+    {
+      if ((v >= '0' && v <= '9') || (v >= 'A' && v <= 'Z') || (v >= 'a' && v <= 'z'))
+        t[v] = static_cast<char>(v);
+    }
+    return t;
+  }();
+
+  return table[value];
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
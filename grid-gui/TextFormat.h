@@ -0,0 +1,25 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <string>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+// ### Number formatting for the large text pages. The numbers are appended straight
+// ### into the output string without any temporary strings or streams.
+
+void appendNumber(std::string& output,double value,int precision);
+void appendNumber(std::string& output,std::size_t value);
+void appendHex(std::string& output,std::size_t value,uint digits);
+char getPrintableChar(uchar value);
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,136 @@
+#include "ValueStats.h"
+#include <grid-files/common/GeneralFunctions.h>
+#include <algorithm>
+#include <cfloat>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ### Number of independent accumulators in the value reduction. The lanes have no
+// ### dependencies on each other, so the compiler can keep them in vector registers.
+
+#define VALUE_STATS_LANES 8
+#define VALUE_STATS_CHUNK 1024
+
+
+
+/*! \brief GridGui: Compute the value statistics in a single pass. The loop body has
+ *  no branches: a missing value is replaced by a neutral value in each accumulator. */
+
+void computeValueStats(const T::ParamValue *values,std::size_t size,ValueStats& stats)
+{
+  try
+  {
+    float minValue[VALUE_STATS_LANES];
+    float maxValue[VALUE_STATS_LANES];
+    float sum[VALUE_STATS_LANES];
+    uint cnt[VALUE_STATS_LANES];
+    double total[VALUE_STATS_LANES];
+    std::size_t count[VALUE_STATS_LANES];
+
+    for (uint l=0; l<VALUE_STATS_LANES; l++)
+    {
+      minValue[l] = FLT_MAX;
+      maxValue[l] = -FLT_MAX;
+      total[l] = 0;
+      count[l] = 0;
+    }
+
+    const float missing = ParamValueMissing;
+    std::size_t blocks = size / VALUE_STATS_LANES;
+
+    // ### The sums are collected in floats (which keeps the whole block in vector
+    // ### registers) and moved into doubles after every chunk of blocks, so the
+    // ### float sums never grow large enough to lose precision.
+
+    for (std::size_t chunk=0; chunk<blocks; chunk += VALUE_STATS_CHUNK)
+    {
+      std::size_t chunkEnd = std::min(blocks,chunk + VALUE_STATS_CHUNK);
+
+      for (uint l=0; l<VALUE_STATS_LANES; l++)
+      {
+        sum[l] = 0;
+        cnt[l] = 0;
+      }
+
+      for (std::size_t b=chunk; b<chunkEnd; b++)
+      {
+        const T::ParamValue *p = values + b*VALUE_STATS_LANES;
+        for (uint l=0; l<VALUE_STATS_LANES; l++)
+        {
+          float val = p[l];
+          bool valid = (val != missing) & (val == val);
+          float lo = valid ? val : FLT_MAX;
+          float hi = valid ? val : -FLT_MAX;
+          minValue[l] = (lo < minValue[l]) ? lo : minValue[l];
+          maxValue[l] = (hi > maxValue[l]) ? hi : maxValue[l];
+          sum[l] += valid ? val : 0.0f;
+          cnt[l] += valid;
+        }
+      }
+
+      for (uint l=0; l<VALUE_STATS_LANES; l++)
+      {
+        total[l] += sum[l];
+        count[l] += cnt[l];
+      }
+    }
+
+    // ### The values that do not fill a whole block.
+
+    for (std::size_t t=blocks*VALUE_STATS_LANES; t<size; t++)
+    {
+      float val = values[t];
+      if (val != missing  &&  val == val)
+      {
+        if (val < minValue[0])
+          minValue[0] = val;
+        if (val > maxValue[0])
+          maxValue[0] = val;
+        total[0] += val;
+        count[0]++;
+      }
+    }
+
+    for (uint l=1; l<VALUE_STATS_LANES; l++)
+    {
+      if (minValue[l] < minValue[0])
+        minValue[0] = minValue[l];
+      if (maxValue[l] > maxValue[0])
+        maxValue[0] = maxValue[l];
+      total[0] += total[l];
+      count[0] += count[l];
+    }
+
+    stats.count = count[0];
+    stats.missingCount = size - count[0];
+
+    if (stats.count > 0)
+    {
+      stats.minValue = minValue[0];
+      stats.maxValue = maxValue[0];
+      stats.mean = total[0] / C_DOUBLE(stats.count);
+    }
+    else
+    {
+      stats.minValue = ParamValueMissing;
+      stats.maxValue = ParamValueMissing;
+      stats.mean = ParamValueMissing;
+    }
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
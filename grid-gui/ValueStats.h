@@ -0,0 +1,48 @@
+#pragma once
+
+#include "LruCache.h"
+#include <grid-files/common/Typedefs.h>
+#include <memory>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+/*! \brief Value statistics of a grid message. The missing values are not counted
+ *  in the minimum, maximum and mean. */
+
+struct ValueStats
+{
+  std::size_t       count = 0;                  //!< Number of valid values.
+  std::size_t       missingCount = 0;           //!< Number of missing values.
+  double            minValue = 0;               //!< Smallest valid value.
+  double            maxValue = 0;               //!< Largest valid value.
+  double            mean = 0;                   //!< Mean of the valid values.
+};
+
+typedef std::shared_ptr<const ValueStats> ValueStats_sptr;
+
+
+void computeValueStats(const T::ParamValue *values,std::size_t size,ValueStats& stats);
+
+
+
+// ====================================================================================
+/*! \brief In-memory cache of the value statistics of the grid messages.
+ *
+ *  The statistics are computed once per key (message and the geometry of the
+ *  values) and shared by all the pages that need the value range of the message.
+ *  The entries are small, so the cache is limited by the number of entries. */
+// ====================================================================================
+
+typedef LruCache<ValueStats_sptr,LruEntryCount> ValueStatsCache;
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
@@ -0,0 +1,312 @@
+#include "WorkerPool.h"
+#include <grid-files/common/GeneralFunctions.h>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+
+/*! \brief GridGui: Constructor. */
+
+WorkerPool::WorkerPool()
+{
+  try
+  {
+    mShutdown = false;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Constructor failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Destructor. */
+
+WorkerPool::~WorkerPool()
+{
+  try
+  {
+    shutdown();
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP,"Destructor failed",nullptr);
+    exception.printError();
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Start the worker threads. The calling thread of run() is counted
+ *  as one of the threads. */
+
+void WorkerPool::init(uint threadCount)
+{
+  try
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (!mThreads.empty())
+      return;
+
+    mShutdown = false;
+    for (uint t=1; t<threadCount; t++)
+      mThreads.emplace_back(&WorkerPool::workerThread,this);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Stop the worker threads. */
+
+void WorkerPool::shutdown()
+{
+  try
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mShutdown = true;
+    }
+    mJobAvailable.notify_all();
+
+    for (auto it = mThreads.begin(); it != mThreads.end(); ++it)
+    {
+      if (it->joinable())
+        it->join();
+    }
+    mThreads.clear();
+
+    // ### The callers of run() execute their own jobs, so only the posted tasks that
+    // ### have not been started are lost here.
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJobs.clear();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Get the number of threads (including the calling thread). */
+
+uint WorkerPool::getThreadCount()
+{
+  try
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mThreads.size() + 1;
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Run the tasks 0..taskCount-1 and wait until all of them are done. */
+
+void WorkerPool::run(uint taskCount,const std::function<void(uint)>& task)
+{
+  try
+  {
+    if (taskCount == 0)
+      return;
+
+    bool parallel = false;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      parallel = (taskCount > 1  &&  !mThreads.empty()  &&  !mShutdown);
+    }
+
+    if (!parallel)
+    {
+      for (uint t=0; t<taskCount; t++)
+        task(t);
+      return;
+    }
+
+    Job_sptr job(new Job());
+    job->task = &task;
+    job->taskCount = taskCount;
+    job->nextTask = 0;
+    job->doneCount = 0;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mJobs.emplace_back(job);
+    }
+    mJobAvailable.notify_all();
+
+    // The calling thread executes tasks too, so the job completes even if all the
+    // workers are busy with other jobs.
+
+    while (execute(*job))
+    {
+    }
+
+    std::unique_lock<std::mutex> lock(job->mutex);
+    job->done.wait(lock,[&job]{ return job->doneCount == job->taskCount; });
+
+    if (job->exception)
+      std::rethrow_exception(job->exception);
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Queue a task for the workers and return without waiting for it.
+ *  The task is executed in the calling thread if the pool has no workers, and it is
+ *  dropped if the pool has been shut down. The exceptions of the task are printed. */
+
+void WorkerPool::post(const std::function<void()>& task)
+{
+  try
+  {
+    Job_sptr job(new Job());
+    job->postedTask = [task](uint)
+    {
+      try
+      {
+        task();
+      }
+      catch (...)
+      {
+        Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+        exception.printError();
+      }
+    };
+    job->task = &job->postedTask;
+    job->taskCount = 1;
+    job->nextTask = 0;
+    job->doneCount = 0;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mShutdown)
+        return;
+
+      if (!mThreads.empty())
+      {
+        mJobs.emplace_back(job);
+        job.reset();
+      }
+    }
+
+    if (job)
+    {
+      execute(*job);
+      return;
+    }
+
+    mJobAvailable.notify_one();
+  }
+  catch (...)
+  {
+    throw Fmi::Exception(BCP, "Operation failed!", nullptr);
+  }
+}
+
+
+
+
+
+/*! \brief GridGui: Execute the next task of the job. Returns false if all the tasks of
+ *  the job have already been started. */
+
+bool WorkerPool::execute(Job& job)
+{
+  uint t = job.nextTask++;
+  if (t >= job.taskCount)
+    return false;
+
+  try
+  {
+    (*job.task)(t);
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (!job.exception)
+      job.exception = std::current_exception();
+  }
+
+  if (++job.doneCount == job.taskCount)
+  {
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.done.notify_all();
+  }
+  return true;
+}
+
+
+
+
+
+/*! \brief GridGui: Worker thread. */
+
+void WorkerPool::workerThread()
+{
+  try
+  {
+    while (true)
+    {
+      Job_sptr job;
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mJobAvailable.wait(lock,[this]{ return mShutdown || !mJobs.empty(); });
+
+        if (mShutdown)
+          return;
+
+        job = mJobs.front();
+
+        // The job is removed from the queue when its last task has been started.
+        if (job->nextTask + 1 >= job->taskCount)
+          mJobs.pop_front();
+      }
+
+      execute(*job);
+    }
+  }
+  catch (...)
+  {
+    Fmi::Exception exception(BCP, "Operation failed!", nullptr);
+    exception.printError();
+  }
+}
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
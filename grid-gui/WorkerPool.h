@@ -0,0 +1,79 @@
+#pragma once
+
+#include <grid-files/common/Typedefs.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace SmartMet
+{
+namespace Plugin
+{
+namespace GridGui
+{
+
+
+// ====================================================================================
+/*! \brief Bounded pool of worker threads for splitting a render into parallel tasks.
+ *
+ *  run() executes the tasks 0..taskCount-1 and returns when all of them are done.
+ *  The calling thread executes tasks too, so a pool of N threads uses N-1 workers.
+ *  The pool is shared by all concurrent requests: their tasks are queued, so the
+ *  total number of render threads never exceeds the pool size (plus the request
+ *  threads themselves).  The first exception thrown by a task is rethrown by run().
+ *
+ *  post() queues a single task without waiting for it; only the workers execute the
+ *  posted tasks.  The tasks that have not been started when the pool is shut down
+ *  are dropped (destroyed without being executed). */
+// ====================================================================================
+
+class WorkerPool
+{
+  public:
+                      WorkerPool();
+    virtual           ~WorkerPool();
+
+    void              init(uint threadCount);
+    void              shutdown();
+    uint              getThreadCount();
+
+    void              run(uint taskCount,const std::function<void(uint)>& task);
+    void              post(const std::function<void()>& task);
+
+  protected:
+
+    struct Job
+    {
+      const std::function<void(uint)>*  task;         //!< Task function (owned by the caller of run() or by postedTask).
+      std::function<void(uint)>         postedTask;   //!< Task function of a posted job.
+      uint                              taskCount;    //!< Number of tasks.
+      std::atomic<uint>                 nextTask;     //!< Next task to be started.
+      std::atomic<uint>                 doneCount;    //!< Number of finished tasks.
+      std::exception_ptr                exception;    //!< First exception thrown by a task.
+      std::mutex                        mutex;        //!< Lock protecting exception and the completion signal.
+      std::condition_variable           done;         //!< Signaled when all the tasks are finished.
+    };
+
+    typedef std::shared_ptr<Job> Job_sptr;
+
+    bool              execute(Job& job);
+    void              workerThread();
+
+    std::vector<std::thread> mThreads;  //!< Worker threads.
+    std::deque<Job_sptr> mJobs;         //!< Jobs that still have tasks to start.
+    std::mutex        mMutex;           //!< Lock protecting mJobs and mShutdown.
+    std::condition_variable mJobAvailable; //!< Signaled when a job is added or the pool is shut down.
+    bool              mShutdown;        //!< True when the workers should exit.
+};
+
+
+}  // namespace GridGui
+}  // namespace Plugin
+}  // namespace SmartMet
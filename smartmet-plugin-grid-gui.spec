@@ -26,6 +26,7 @@ BuildRequires: make
 BuildRequires: %{smartmet_boost}-devel
 BuildRequires: libconfig17-devel
 BuildRequires: libwebp13-devel
+BuildRequires: libpng-devel
 BuildRequires: smartmet-utils-devel >= 26.6.17
 BuildRequires: smartmet-library-macgyver-devel >= 26.6.15
 BuildRequires: smartmet-library-spine-devel >= 26.7.7